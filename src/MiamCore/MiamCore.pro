@@ -1,4 +1,4 @@
-QT       += widgets multimedia sql
+QT       += widgets multimedia sql concurrent
 
 3rdpartyDir  = $$PWD/3rdparty
 
@@ -66,20 +66,30 @@ macx {
 SOURCES += library/jumptowidget.cpp \
     model/albumdao.cpp \
     model/artistdao.cpp \
+    model/databasewriter.cpp \
+    model/fieldnormalizer.cpp \
     model/genericdao.cpp \
+    model/libraryloader.cpp \
+    model/librarynode.cpp \
+    model/librarysnapshot.cpp \
+    model/librarywriter.cpp \
+    model/nodestore.cpp \
     model/playlistdao.cpp \
     model/selectedtracksmodel.cpp \
     model/sqldatabase.cpp \
+    model/stringpool.cpp \
     model/trackdao.cpp \
     model/yeardao.cpp \
     cover.cpp \
     filehelper.cpp \
+    filesystemmonitor.cpp \
     flowlayout.cpp \
     mediabutton.cpp \
     mediaplayer.cpp \
     mediaplaylist.cpp \
     musicsearchengine.cpp \
     quickstartsearchengine.cpp \
+    readonlyfilestream.cpp \
     settings.cpp \
     settingsprivate.cpp \
     stopbutton.cpp \
@@ -88,6 +98,7 @@ SOURCES += library/jumptowidget.cpp \
     styling/imageutils.cpp \
     styling/lineedit.cpp \
     starrating.cpp \
+    tagreader.cpp \
     miamsortfilterproxymodel.cpp \
     plugininfo.cpp
 
@@ -99,15 +110,24 @@ HEADERS += interfaces/basicplugin.h \
     library/jumptowidget.h \
     model/albumdao.h \
     model/artistdao.h \
+    model/databasewriter.h \
+    model/fieldnormalizer.h \
     model/genericdao.h \
+    model/libraryloader.h \
+    model/librarynode.h \
+    model/librarysnapshot.h \
+    model/librarywriter.h \
+    model/nodestore.h \
     model/playlistdao.h \
     model/selectedtracksmodel.h \
     model/sqldatabase.h \
+    model/stringpool.h \
     model/trackdao.h \
     model/yeardao.h \
     abstractsearchdialog.h \
     cover.h \
     filehelper.h \
+    filesystemmonitor.h \
     flowlayout.h \
     imediaplayer.h \
     mediabutton.h \
@@ -116,6 +136,7 @@ HEADERS += interfaces/basicplugin.h \
     miamcore_global.h \
     musicsearchengine.h \
     quickstartsearchengine.h \
+    readonlyfilestream.h \
     settings.h \
     settingsprivate.h \
     stopbutton.h \
@@ -125,5 +146,6 @@ HEADERS += interfaces/basicplugin.h \
     styling/lineedit.h \
     starrating.h \
     searchbar.h \
+    tagreader.h \
     miamsortfilterproxymodel.h \
     plugininfo.h
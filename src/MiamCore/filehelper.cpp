@@ -1,5 +1,6 @@
 #include "filehelper.h"
 #include "cover.h"
+#include "readonlyfilestream.h"
 
 #include <algorithm>
 #include <map>
@@ -24,6 +25,7 @@
 
 #include <taglib/id3v2tag.h>
 #include <taglib/id3v2frame.h>
+#include <taglib/id3v2framefactory.h>
 
 #include <taglib/attachedpictureframe.h>
 #include <taglib/popularimeterframe.h>
@@ -40,7 +42,7 @@
 #include <QtDebug>
 
 FileHelper::FileHelper(const QMediaContent &track)
-	: _file(nullptr), _fileType(UNKNOWN), _isValid(false)
+	: _file(nullptr), _stream(nullptr), _fileType(UNKNOWN), _isValid(false), _readMode(ReadAll), _ioMode(DefaultIO)
 {
 	bool b = init(QDir::fromNativeSeparators(track.canonicalUrl().toLocalFile()));
 	if (!b) {
@@ -55,8 +57,8 @@ FileHelper::FileHelper(const QMediaContent &track)
 	}
 }
 
-FileHelper::FileHelper(const QString &filePath)
-	: _file(nullptr), _fileType(UNKNOWN), _isValid(false)
+FileHelper::FileHelper(const QString &filePath, ReadMode readMode, IOMode ioMode)
+	: _file(nullptr), _stream(nullptr), _fileType(UNKNOWN), _isValid(false), _readMode(readMode), _ioMode(ioMode)
 {
 	bool b = init(filePath);
 	if (!b) {
@@ -111,29 +113,36 @@ bool FileHelper::init(const QString &filePath)
 	TagLib::String s(QDir::toNativeSeparators(fileName).toUtf8().constData(), TagLib::String::UTF8);
 	TagLib::FileName fp(s.toCString(true));
 #endif
+	bool readProperties = (_readMode != ReadTagsOnly);
+	TagLib::AudioProperties::ReadStyle style = (_readMode == ReadFast) ? TagLib::AudioProperties::Fast : TagLib::AudioProperties::Average;
+	if (_ioMode != DefaultIO && _stream == nullptr && this->suffixes(Standard).contains(suffix)) {
+		ReadOnlyFileStream::Strategy strategy = (_ioMode == MappedIO) ? ReadOnlyFileStream::MemoryMapped : ReadOnlyFileStream::Prefetched;
+		_stream = new ReadOnlyFileStream(fileName, strategy);
+	}
+	TagLib::ID3v2::FrameFactory *frameFactory = TagLib::ID3v2::FrameFactory::instance();
 	if (suffix == "ape") {
-		_file = new TagLib::APE::File(fp);
+		_file = _stream ? new TagLib::APE::File(_stream, readProperties, style) : new TagLib::APE::File(fp, readProperties, style);
 		_fileType = APE;
 	} else if (suffix == "asf") {
-		_file = new TagLib::ASF::File(fp);
+		_file = _stream ? new TagLib::ASF::File(_stream, readProperties, style) : new TagLib::ASF::File(fp, readProperties, style);
 		_fileType = ASF;
 	} else if (suffix == "flac") {
-		_file = new TagLib::FLAC::File(fp);
+		_file = _stream ? new TagLib::FLAC::File(_stream, frameFactory, readProperties, style) : new TagLib::FLAC::File(fp, readProperties, style);
 		_fileType = FLAC;
 	} else if (suffix == "m4a" || suffix == "mp4") {
-		_file = new TagLib::MP4::File(fp);
+		_file = _stream ? new TagLib::MP4::File(_stream, readProperties, style) : new TagLib::MP4::File(fp, readProperties, style);
 		_fileType = MP4;
 	} else if (suffix == "mpc") {
-		_file = new TagLib::MPC::File(fp);
+		_file = _stream ? new TagLib::MPC::File(_stream, readProperties, style) : new TagLib::MPC::File(fp, readProperties, style);
 		_fileType = MPC;
 	} else if (suffix == "mp3") {
-		_file = new TagLib::MPEG::File(fp);
+		_file = _stream ? new TagLib::MPEG::File(_stream, frameFactory, readProperties, style) : new TagLib::MPEG::File(fp, readProperties, style);
 		_fileType = MP3;
 	} else if (suffix == "ogg" || suffix == "oga") {
-		_file = new TagLib::Vorbis::File(fp);
+		_file = _stream ? new TagLib::Vorbis::File(_stream, readProperties, style) : new TagLib::Vorbis::File(fp, readProperties, style);
 		_fileType = OGG;
 	} else if (suffix == "opus") {
-		_file = new TagLib::Ogg::Opus::File(fp);
+		_file = _stream ? new TagLib::Ogg::Opus::File(_stream, readProperties, style) : new TagLib::Ogg::Opus::File(fp, readProperties, style);
 		_fileType = OGG;
 	} else {
 		_file = nullptr;
@@ -156,6 +165,11 @@ FileHelper::~FileHelper()
 		delete _file;
 		_file = nullptr;
 	}
+	// TagLib doesn't own streams it was given
+	if (_stream != nullptr) {
+		delete _stream;
+		_stream = nullptr;
+	}
 }
 
 const QStringList FileHelper::suffixes(ExtensionType et, bool withPrefix)
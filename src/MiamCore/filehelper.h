@@ -14,6 +14,7 @@ class Cover;
 /// Forward declaration
 namespace TagLib {
 	class File;
+	class IOStream;
 
 	namespace ID3v2 {
 		class Tag;
@@ -34,8 +35,13 @@ class MIAMCORE_LIBRARY FileHelper
 private:
 	TagLib::File *_file;
 
+	/** Custom stream used to read the file, owned by this helper. Null for the default TagLib stream. */
+	TagLib::IOStream *_stream;
+
 	int _fileType;
 	bool _isValid;
+	int _readMode;
+	int _ioMode;
 
 	QFileInfo _fileInfo;
 
@@ -61,6 +67,20 @@ public:
 		All				= Standard | GameMusicEmu
 	};
 
+	/** Audio properties, like the length, may require to read far into the stream (VBR files for example). */
+	enum ReadMode {
+		ReadAll			= 0,	// Tags and audio properties with an average accuracy
+		ReadFast		= 1,	// Tags and audio properties guessed from headers only, like an approximate length
+		ReadTagsOnly	= 2		// Tags without any audio property
+	};
+
+	/** Scans can avoid many small reads per file, but tags cannot be saved in these modes. */
+	enum IOMode {
+		DefaultIO		= 0,	// Regular TagLib stream
+		PrefetchedIO	= 1,	// Header and trailer are read at once
+		MappedIO		= 2		// The whole file is mapped in memory
+	};
+
 	enum TagKey {
 		Artist
 	};
@@ -82,7 +102,7 @@ public:
 
 	FileHelper(const QMediaContent &track);
 
-	FileHelper(const QString &filePath);
+	FileHelper(const QString &filePath, ReadMode readMode = ReadAll, IOMode ioMode = DefaultIO);
 
 	static std::string keyToStdString(Field f);
 
@@ -0,0 +1,242 @@
+#include "filesystemmonitor.h"
+
+#include "filehelper.h"
+#include "settingsprivate.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QQueue>
+#include <QSocketNotifier>
+
+#include <QtDebug>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define MIAM_INOTIFY_MASK (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#endif
+
+FileSystemMonitor::FileSystemMonitor(QObject *parent)
+	: QObject(parent)
+	, _delay(new QTimer(this))
+	, _rescanTimer(new QTimer(this))
+	, _needsRescan(false)
+	, _suffixes(FileHelper::suffixes(FileHelper::All))
+#ifdef Q_OS_LINUX
+	, _inotifyFd(-1)
+	, _notifier(nullptr)
+#else
+	, _watcher(nullptr)
+#endif
+{
+	_delay->setSingleShot(true);
+	_delay->setInterval(2000);
+	connect(_delay, &QTimer::timeout, this, &FileSystemMonitor::flush);
+
+	// Directories which can't be watched are compared with the library every 10 minutes
+	_rescanTimer->setInterval(10 * 60 * 1000);
+	connect(_rescanTimer, &QTimer::timeout, this, [=]() {
+		_needsRescan = true;
+		this->flush();
+	});
+}
+
+FileSystemMonitor::~FileSystemMonitor()
+{
+	this->stop();
+}
+
+/** Watches a directory and all its subdirectories. Audio files which were found are appended to the list, if any.
+ * Returns false if some directories can't be watched. */
+bool FileSystemMonitor::addWatches(const QString &directory, QStringList *files)
+{
+	QQueue<QString> directories;
+	directories.enqueue(directory);
+	while (!directories.isEmpty()) {
+		QString dir = directories.dequeue();
+#ifdef Q_OS_LINUX
+		int wd = inotify_add_watch(_inotifyFd, QFile::encodeName(dir).constData(), MIAM_INOTIFY_MASK);
+		if (wd < 0) {
+			if (errno == ENOSPC) {
+				qWarning() << Q_FUNC_INFO << "Cannot watch more directories, please increase fs.inotify.max_user_watches";
+				return false;
+			}
+			continue;
+		}
+		_watches.insert(wd, dir);
+#else
+		_watcher->addPath(dir);
+#endif
+		QDirIterator it(dir, QDir::AllDirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+		while (it.hasNext()) {
+			it.next();
+			QFileInfo fileInfo = it.fileInfo();
+			if (fileInfo.isDir()) {
+				if (!fileInfo.isSymLink()) {
+					directories.enqueue(fileInfo.absoluteFilePath());
+				}
+			} else if (files && _suffixes.contains(fileInfo.suffix())) {
+				files->append(fileInfo.absoluteFilePath());
+			}
+		}
+	}
+	return true;
+}
+
+/** Stops to watch a directory and all its subdirectories. */
+void FileSystemMonitor::removeWatches(const QString &directory)
+{
+#ifdef Q_OS_LINUX
+	QString subDirectories = directory + "/";
+	QMutableHashIterator<int, QString> it(_watches);
+	while (it.hasNext()) {
+		it.next();
+		if (it.value() == directory || it.value().startsWith(subDirectories)) {
+			inotify_rm_watch(_inotifyFd, it.key());
+			it.remove();
+		}
+	}
+#else
+	Q_UNUSED(directory)
+#endif
+}
+
+/** Watches all music locations. */
+void FileSystemMonitor::start()
+{
+	this->stop();
+#ifdef Q_OS_LINUX
+	_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotifyFd < 0) {
+		qWarning() << Q_FUNC_INFO << "inotify is not available";
+		return;
+	}
+	_notifier = new QSocketNotifier(_inotifyFd, QSocketNotifier::Read, this);
+	connect(_notifier, &QSocketNotifier::activated, this, &FileSystemMonitor::readEvents);
+#else
+	_watcher = new QFileSystemWatcher(this);
+	connect(_watcher, &QFileSystemWatcher::directoryChanged, this, [=]() {
+		_needsRescan = true;
+		_delay->start();
+	});
+#endif
+	for (QString musicLocation : SettingsPrivate::instance()->musicLocations()) {
+		QString location = QDir(musicLocation).absolutePath();
+		_locations.append(location);
+		// Changes in a location which is missing, or in directories beyond the limit of watches, would be missed
+		if (!this->addWatches(location) || !QFileInfo(location).isDir()) {
+			_rescanTimer->start();
+		}
+	}
+}
+
+void FileSystemMonitor::stop()
+{
+	_delay->stop();
+	_rescanTimer->stop();
+	_locations.clear();
+	_changedFiles.clear();
+	_removedPaths.clear();
+	_needsRescan = false;
+#ifdef Q_OS_LINUX
+	if (_notifier) {
+		delete _notifier;
+		_notifier = nullptr;
+	}
+	if (_inotifyFd >= 0) {
+		// Closing the descriptor removes all watches at once
+		::close(_inotifyFd);
+		_inotifyFd = -1;
+	}
+	_watches.clear();
+#else
+	if (_watcher) {
+		delete _watcher;
+		_watcher = nullptr;
+	}
+#endif
+}
+
+void FileSystemMonitor::flush()
+{
+	if (_needsRescan) {
+		// Some directories may have been created without being watched
+		this->start();
+		emit rescanNeeded();
+	} else if (!_changedFiles.isEmpty() || !_removedPaths.isEmpty()) {
+		emit filesChanged(_changedFiles.toList(), _removedPaths.toList());
+		_changedFiles.clear();
+		_removedPaths.clear();
+	}
+}
+
+#ifdef Q_OS_LINUX
+void FileSystemMonitor::readEvents()
+{
+	alignas(struct inotify_event) char buffer[16 * 1024];
+	ssize_t length;
+	while ((length = ::read(_inotifyFd, buffer, sizeof(buffer))) > 0) {
+		const char *ptr = buffer;
+		while (ptr < buffer + length) {
+			const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				_needsRescan = true;
+				continue;
+			}
+			if (event->mask & IN_IGNORED) {
+				_watches.remove(event->wd);
+				continue;
+			}
+			QString directory = _watches.value(event->wd);
+			if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)) {
+				// Other directories are reported by their parent. A location which was moved would still be watched at its new
+				// path, and one which was unmounted isn't watched anymore: both are watched again if they come back
+				if (_locations.contains(directory)) {
+					this->removeWatches(directory);
+					if (!(event->mask & IN_UNMOUNT)) {
+						_removedPaths.insert(directory);
+					}
+					_rescanTimer->start();
+				}
+				continue;
+			}
+			if (directory.isEmpty() || event->len == 0) {
+				continue;
+			}
+			QString path = directory + "/" + QFile::decodeName(event->name);
+
+			if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					// Files may have been copied before the new directory was watched
+					QStringList files;
+					if (!this->addWatches(path, &files)) {
+						_rescanTimer->start();
+					}
+					for (QString file : files) {
+						_changedFiles.insert(file);
+					}
+				} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+					this->removeWatches(path);
+					_removedPaths.insert(path);
+				}
+			} else if (_suffixes.contains(QFileInfo(path).suffix())) {
+				// Created files are read when they are closed, not before
+				if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+					_changedFiles.insert(path);
+					_removedPaths.remove(path);
+				} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+					_removedPaths.insert(path);
+					_changedFiles.remove(path);
+				}
+			}
+		}
+	}
+	_delay->start();
+}
+#endif
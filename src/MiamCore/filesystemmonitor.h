@@ -0,0 +1,88 @@
+#ifndef FILESYSTEMMONITOR_H
+#define FILESYSTEMMONITOR_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "miamcore_global.h"
+
+/// Forward declarations
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+/**
+ * \brief		The FileSystemMonitor class reports changes in music locations, without polling them.
+ * \details		On Linux, every directory is watched with inotify: new directories are watched as soon as they are created,
+ *				and only paths which were modified are sent to the database. When the kernel queue has overflowed,
+ *				events are lost and an incremental rescan is requested instead. When some directories can't be watched, because
+ *				the limit of watches was reached or a music location was deleted, rescans are requested periodically until they
+ *				can be watched again. On other systems, any change requests a rescan.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY FileSystemMonitor : public QObject
+{
+	Q_OBJECT
+private:
+	/** Events are not sent immediately, to group them when many files are copied at once. */
+	QTimer *_delay;
+
+	/** Restarts watches and requests a rescan, while some directories can't be watched. */
+	QTimer *_rescanTimer;
+
+	/** Music locations, which are the roots of watches. */
+	QStringList _locations;
+
+	QSet<QString> _changedFiles;
+	QSet<QString> _removedPaths;
+	bool _needsRescan;
+
+	QStringList _suffixes;
+
+#ifdef Q_OS_LINUX
+	int _inotifyFd;
+	QSocketNotifier *_notifier;
+
+	/** Watch descriptors and their directories. */
+	QHash<int, QString> _watches;
+#else
+	QFileSystemWatcher *_watcher;
+#endif
+
+public:
+	explicit FileSystemMonitor(QObject *parent = nullptr);
+
+	virtual ~FileSystemMonitor();
+
+private:
+	/** Watches a directory and all its subdirectories. Audio files which were found are appended to the list, if any.
+	 * Returns false if some directories can't be watched. */
+	bool addWatches(const QString &directory, QStringList *files = nullptr);
+
+	/** Stops to watch a directory and all its subdirectories. */
+	void removeWatches(const QString &directory);
+
+public slots:
+	/** Watches all music locations. */
+	void start();
+
+	void stop();
+
+private slots:
+	void flush();
+
+#ifdef Q_OS_LINUX
+	void readEvents();
+#endif
+
+signals:
+	/** Audio files were added or modified, files or directories were removed. */
+	void filesChanged(const QStringList &changedFiles, const QStringList &removedPaths);
+
+	/** Some events are unknown, the library has to be compared with the FileSystem. */
+	void rescanNeeded();
+};
+
+#endif // FILESYSTEMMONITOR_H
@@ -45,13 +45,15 @@ MediaPlayer::MediaPlayer(QObject *parent)
 	});
 
 	connect(this, &MediaPlayer::currentMediaChanged, this, [=] (const QString &uri) {
-		QWindow *w = QGuiApplication::topLevelWindows().first();
-		TrackDAO t = SqlDatabase::instance()->selectTrackByURI(uri);
-		if (t.artist().isEmpty()) {
-			w->setTitle(t.title() + " - Miam Player");
-		} else {
-			w->setTitle(t.title() + " (" + t.artist() + ") - Miam Player");
-		}
+		// Results are delivered in the same order than requests, so the title is always the one of the last track
+		SqlDatabase::instance()->selectTrackByURI(uri, this, [] (const TrackDAO &t) {
+			QWindow *w = QGuiApplication::topLevelWindows().first();
+			if (t.artist().isEmpty()) {
+				w->setTitle(t.title() + " - Miam Player");
+			} else {
+				w->setTitle(t.title() + " (" + t.artist() + ") - Miam Player");
+			}
+		});
 	});
 
 	// Link core multimedia actions
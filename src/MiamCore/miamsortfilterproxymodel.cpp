@@ -1,19 +1,20 @@
 #include "miamsortfilterproxymodel.h"
 #include "settingsprivate.h"
 
-#include <functional>
-#include <QSet>
-#include <QStandardItem>
+#include <QStack>
+#include <QStandardItemModel>
 
 #include <QtDebug>
 
 MiamSortFilterProxyModel::MiamSortFilterProxyModel(QObject *parent)
 	: QSortFilterProxyModel(parent)
+	, _standardModel(nullptr)
 {
 	this->setSortCaseSensitivity(Qt::CaseInsensitive);
 	this->setSortRole(Miam::DF_NormalizedString);
 	this->setDynamicSortFilter(false);
 	this->sort(0, Qt::AscendingOrder);
+	this->setFilterRole(Qt::DisplayRole);
 }
 
 void MiamSortFilterProxyModel::findMusic(const QString &text)
@@ -87,61 +88,94 @@ void MiamSortFilterProxyModel::filterLibrary(const QString &filter)
 	}
 }
 
+/** Redefined to forget highlighted items when the source model deletes some of its items. */
+void MiamSortFilterProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+	for (const QMetaObject::Connection &connection : _sourceConnections) {
+		disconnect(connection);
+	}
+	_sourceConnections.clear();
+	_highlightedItems.clear();
+	_standardModel = qobject_cast<QStandardItemModel*>(sourceModel);
+	QSortFilterProxyModel::setSourceModel(sourceModel);
+	if (sourceModel) {
+		// A deleted item can't be compared anymore: its address may be reused by a new one
+		auto clearHighlightedItems = [=]() {
+			_highlightedItems.clear();
+		};
+		_sourceConnections << connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this, clearHighlightedItems);
+		_sourceConnections << connect(sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, clearHighlightedItems);
+	}
+}
+
 /** Highlight items in the Tree when one has activated this option in settings. */
 void MiamSortFilterProxyModel::highlightMatchingText(const QString &text)
 {
-	// Clear highlight on every call
-	std::function<void(QStandardItem *item)> recursiveClearHighlight;
-	recursiveClearHighlight = [&recursiveClearHighlight] (QStandardItem *item) -> void {
-		if (item->hasChildren()) {
-			item->setData(false, Miam::DF_Highlighted);
-			for (int i = 0; i < item->rowCount(); i++) {
-				recursiveClearHighlight(item->child(i, 0));
-			}
-		} else {
-			item->setData(false, Miam::DF_Highlighted);
-		}
-	};
-
-	QStandardItemModel *_libraryModel = qobject_cast<QStandardItemModel*>(this->sourceModel());
-	for (int i = 0; i < _libraryModel->rowCount(); i++) {
-		recursiveClearHighlight(_libraryModel->item(i, 0));
-	}
+	_highlightedItems.clear();
 
-	// Adapt filter if one is typing '*'
-	QString filter;
-	Qt::MatchFlags flags;
+	// Adapt filter if one is typing '*'. The filter role isn't changed: it would filter every row again
+	QRegExp regExp;
+	int role;
 	if (text.contains(QRegExp("^(\\*){1,5}$"))) {
-		this->setFilterRole(Miam::DF_Rating);
-		filter = "[" + QString::number(text.size()) + "-5]";
-		flags = Qt::MatchRecursive | Qt::MatchRegExp;
+		role = Miam::DF_Rating;
+		regExp = QRegExp("[" + QString::number(text.size()) + "-5]", Qt::CaseInsensitive, QRegExp::RegExp);
 	} else {
-		this->setFilterRole(Qt::DisplayRole);
-		filter = text;
-		flags = Qt::MatchRecursive | Qt::MatchContains;
+		role = Qt::DisplayRole;
+		regExp = QRegExp(text, Qt::CaseInsensitive, QRegExp::FixedString);
 	}
 
-	// Mark items with a bold font
+	// Mark items with a bold font. Items are visited once, without building any index
 	QSet<QChar> lettersToHighlight;
-	if (!text.isEmpty()) {
-		QModelIndexList indexes = _libraryModel->match(_libraryModel->index(0, 0, QModelIndex()), this->filterRole(), filter, -1, flags);
-		QList<QStandardItem*> items;
-		for (int i = 0; i < indexes.size(); ++i) {
-			items.append(_libraryModel->itemFromIndex(indexes.at(i)));
+	if (_standardModel && !text.isEmpty()) {
+		QStack<QStandardItem*> items;
+		QStandardItem *root = _standardModel->invisibleRootItem();
+		for (int i = root->rowCount() - 1; i >= 0; i--) {
+			items.push(root->child(i));
 		}
-		for (QStandardItem *item : items) {
-			item->setData(true, Miam::DF_Highlighted);
-			QStandardItem *parent = item->parent();
-			// For every item marked, mark also the top level item
-			while (parent != nullptr) {
-				parent->setData(true, Miam::DF_Highlighted);
-				if (parent->parent() == nullptr) {
-					lettersToHighlight << parent->data(Miam::DF_NormalizedString).toString().toUpper().at(0);
+		while (!items.isEmpty()) {
+			QStandardItem *item = items.pop();
+			if (!item) {
+				continue;
+			}
+			for (int i = item->rowCount() - 1; i >= 0; i--) {
+				items.push(item->child(i));
+			}
+			if (!item->data(role).toString().contains(regExp)) {
+				continue;
+			}
+
+			// For every item marked, mark also its parents until one was already marked
+			while (item != nullptr && !_highlightedItems.contains(item)) {
+				_highlightedItems.insert(item);
+				if (item->parent() == nullptr) {
+					QString normalizedText = item->data(Miam::DF_NormalizedString).toString();
+					if (!normalizedText.isEmpty()) {
+						lettersToHighlight << normalizedText.toUpper().at(0);
+					}
 				}
-				parent = parent->parent();
+				item = item->parent();
 			}
 		}
 	}
-	qDebug() << Q_FUNC_INFO << lettersToHighlight;
+	this->updateHighlightedItems();
 	emit aboutToHighlightLetters(lettersToHighlight);
 }
+
+/** Returns true if an item of the source model was marked by the last call to highlightMatchingText(). */
+bool MiamSortFilterProxyModel::isHighlighted(const QModelIndex &sourceIndex) const
+{
+	if (_highlightedItems.isEmpty()) {
+		return false;
+	}
+	return _standardModel && _highlightedItems.contains(_standardModel->itemFromIndex(sourceIndex));
+}
+
+/** Tells views to paint highlighted items again, with a single notification. */
+void MiamSortFilterProxyModel::updateHighlightedItems()
+{
+	// Views are painting their whole viewport again when a range of indexes has changed
+	int rows = this->rowCount();
+	if (rows > 0) {
+		emit dataChanged(this->index(0, 0), this->index(rows - 1, 0), QVector<int>() << Miam::DF_Highlighted);
+	}
+}
@@ -1,40 +1,55 @@
 #ifndef MIAMSORTFILTERPROXYMODEL_H
 #define MIAMSORTFILTERPROXYMODEL_H
 
+#include <QSet>
 #include <QSortFilterProxyModel>
 #include "miamcore_global.h"
 
-/// Forward declaration
-class SeparatorItem;
+/// Forward declarations
+class QStandardItem;
+class QStandardItemModel;
 
 /**
  * \brief		The MiamSortFilterProxyModel class
+ * \details		Items matching the text in LSM_HighlightOnly mode are kept in a set owned by this proxy, and the source model is
+ *				never modified: delegates ask isHighlighted() when painting.
  * \author      Matthieu Bachelier
  * \copyright   GNU General Public License v3
  */
 class MIAMCORE_LIBRARY MiamSortFilterProxyModel : public QSortFilterProxyModel
 {
 	Q_OBJECT
-protected:
-	/** Top levels items are specific items, like letters 'A', 'B', ... in the library. Each letter has a reference to all items beginning with this letter. */
-	QMultiHash<SeparatorItem*, QModelIndex> _topLevelItems;
-
 public:
 	MiamSortFilterProxyModel(QObject *parent = 0);
 
-	inline void setTopLevelItems(const QMultiHash<SeparatorItem*, QModelIndex> &topLevelItems) { _topLevelItems = topLevelItems; }
-
 	void findMusic(const QString &text);
 
 	/** Highlight items in the Tree when one has activated this option in settings. */
-	void highlightMatchingText(const QString &text);
+	virtual void highlightMatchingText(const QString &text);
+
+	/** Returns true if an item of the source model was marked by the last call to highlightMatchingText(). */
+	virtual bool isHighlighted(const QModelIndex &sourceIndex) const;
+
+	/** Redefined to forget highlighted items when the source model deletes some of its items. */
+	virtual void setSourceModel(QAbstractItemModel *sourceModel) override;
 
 protected:
 	virtual bool filterAcceptsColumn(int sourceColumn, const QModelIndex &sourceParent) const override;
 
-private:
+	/** Tells views to paint highlighted items again, with a single notification. */
+	void updateHighlightedItems();
+
 	/** Reduce the size of the library when the user is typing text. */
-	void filterLibrary(const QString &filter);
+	virtual void filterLibrary(const QString &filter);
+
+private:
+	/** Source model, if it's a QStandardItemModel: it's only cast once, when it's set. */
+	QStandardItemModel *_standardModel;
+
+	/** Items marked in LSM_HighlightOnly mode. They're only compared, never dereferenced, and cleared before deletions. */
+	QSet<const QStandardItem*> _highlightedItems;
+
+	QList<QMetaObject::Connection> _sourceConnections;
 
 signals:
 	void aboutToHighlightLetters(const QSet<QChar> &letters);
@@ -1,4 +1,5 @@
 #include "albumdao.h"
+#include "stringpool.h"
 
 AlbumDAO::AlbumDAO(QObject *parent)
 	: GenericDAO(Miam::IT_Album, parent)
@@ -31,7 +32,7 @@ AlbumDAO& AlbumDAO::operator=(const AlbumDAO& other)
 AlbumDAO::~AlbumDAO() {}
 
 QString AlbumDAO::artist() const { return _artist; }
-void AlbumDAO::setArtist(const QString &artist) { _artist = artist; }
+void AlbumDAO::setArtist(const QString &artist) { _artist = StringPool::instance()->intern(artist); }
 
 QString AlbumDAO::disc() const { return _disc; }
 void AlbumDAO::setDisc(const QString &disc) { _disc = disc; }
@@ -43,13 +44,13 @@ QString AlbumDAO::length() const { return _length; }
 void AlbumDAO::setLength(const QString &length) { _length = length; }
 
 QString AlbumDAO::source() const { return _source; }
-void AlbumDAO::setSource(const QString &source) { _source = source; }
+void AlbumDAO::setSource(const QString &source) { _source = StringPool::instance()->intern(source); }
 
 QString AlbumDAO::uri() const { return _uri; }
 void AlbumDAO::setUri(const QString &uri) { _uri = uri; }
 
 QString AlbumDAO::year() const { return _year; }
-void AlbumDAO::setYear(const QString &year) { _year = year; }
+void AlbumDAO::setYear(const QString &year) { _year = StringPool::instance()->intern(year); }
 
 #include <QHash>
 
@@ -0,0 +1,91 @@
+#include "databasewriter.h"
+
+#include <QMutexLocker>
+#include <QSemaphore>
+
+DatabaseWriter::DatabaseWriter(QObject *parent)
+	: QThread(parent)
+	, _isStopping(false)
+{}
+
+/** Starts the thread, which creates its connection to this database. */
+void DatabaseWriter::start(const QString &databaseName)
+{
+	_databaseName = databaseName;
+	QThread::start();
+}
+
+/** Runs writes which are still queued, then closes the connection and waits for the thread to exit. */
+void DatabaseWriter::stop()
+{
+	{
+		QMutexLocker locker(&_mutex);
+		_isStopping = true;
+		_hasWrites.wakeOne();
+	}
+	this->wait();
+}
+
+/** Returns the connection of this thread, which can only be used by writes. */
+QSqlDatabase &DatabaseWriter::connection()
+{
+	Q_ASSERT(this->isCurrentThread());
+	return _connection;
+}
+
+/** Queues a write, and returns immediately. Returns false if the thread was stopped. */
+bool DatabaseWriter::post(const std::function<void()> &write)
+{
+	QMutexLocker locker(&_mutex);
+	if (_isStopping) {
+		return false;
+	}
+	_writes.enqueue(write);
+	_hasWrites.wakeOne();
+	return true;
+}
+
+/** Queues a write, and waits until it has been run. In this thread, the write is run immediately. */
+void DatabaseWriter::exec(const std::function<void()> &write)
+{
+	if (this->isCurrentThread()) {
+		write();
+		return;
+	}
+	QSemaphore done;
+	bool isQueued = this->post([&write, &done]() {
+		write();
+		done.release();
+	});
+	if (isQueued) {
+		done.acquire();
+	}
+}
+
+void DatabaseWriter::run()
+{
+	// A connection can only be used in the thread which has created it
+	QString connectionName = QString("writer_%1").arg(reinterpret_cast<quintptr>(this));
+	_connection = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+	_connection.setDatabaseName(_databaseName);
+
+	forever {
+		std::function<void()> write;
+		{
+			QMutexLocker locker(&_mutex);
+			while (_writes.isEmpty() && !_isStopping) {
+				_hasWrites.wait(&_mutex);
+			}
+			if (_writes.isEmpty()) {
+				break;
+			}
+			write = _writes.dequeue();
+		}
+		write();
+	}
+
+	// A transaction which is still pending is rolled back: an interrupted scan is resumed from its last checkpoint
+	_connection.close();
+	_connection = QSqlDatabase();
+	QSqlDatabase::removeDatabase(connectionName);
+}
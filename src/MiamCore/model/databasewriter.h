@@ -0,0 +1,62 @@
+#ifndef DATABASEWRITER_H
+#define DATABASEWRITER_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QSqlDatabase>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <functional>
+
+#include "../miamcore_global.h"
+
+/**
+ * \brief		The DatabaseWriter class is the thread which owns the only connection allowed to write in the database.
+ * \details		The connection is created by this thread, and is never used by another one. Writes can be queued from any thread,
+ *				and they are run one after the other, in the order they were queued. Tracks of a scan are queued without waiting,
+ *				whereas edits from the UI wait for their result: that's short, since tracks are written by small batches.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY DatabaseWriter : public QThread
+{
+	Q_OBJECT
+private:
+	QString _databaseName;
+
+	/** Only used by writes, in this thread. */
+	QSqlDatabase _connection;
+
+	QMutex _mutex;
+	QWaitCondition _hasWrites;
+	QQueue<std::function<void()>> _writes;
+	bool _isStopping;
+
+public:
+	explicit DatabaseWriter(QObject *parent = nullptr);
+
+	/** Starts the thread, which creates its connection to this database. */
+	void start(const QString &databaseName);
+
+	/** Runs writes which are still queued, then closes the connection and waits for the thread to exit. */
+	void stop();
+
+	inline const QString &databaseName() const { return _databaseName; }
+
+	/** Returns the connection of this thread, which can only be used by writes. */
+	QSqlDatabase &connection();
+
+	inline bool isCurrentThread() const { return QThread::currentThread() == this; }
+
+	/** Queues a write, and returns immediately. Returns false if the thread was stopped. */
+	bool post(const std::function<void()> &write);
+
+	/** Queues a write, and waits until it has been run. In this thread, the write is run immediately. */
+	void exec(const std::function<void()> &write);
+
+protected:
+	virtual void run() override;
+};
+
+#endif // DATABASEWRITER_H
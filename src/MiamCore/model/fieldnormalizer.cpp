@@ -0,0 +1,112 @@
+#include "fieldnormalizer.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+QAtomicPointer<FieldNormalizer::Block> FieldNormalizer::_blocks[256];
+
+const int FieldNormalizer::CACHE_SIZE = 4096;
+
+static QMutex cacheMutex;
+static QCache<QString, QString> cache(FieldNormalizer::CACHE_SIZE);
+
+/** ASCII characters matched by \w, without Unicode properties. */
+static inline bool isAsciiWord(ushort u)
+{
+	return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_';
+}
+
+static inline ushort asciiToLower(ushort u)
+{
+	return (u >= 'A' && u <= 'Z') ? u + ('a' - 'A') : u;
+}
+
+/** Appends the ASCII letters, digits and '_' of a lowered and decomposed character. */
+void FieldNormalizer::appendFolded(QString &folded, const QString &character)
+{
+	// Decomposed characters are not lowered again, like when the whole string is lowered first
+	for (QChar c : character.toLower().normalized(QString::NormalizationForm_KD)) {
+		if (isAsciiWord(c.unicode())) {
+			folded.append(c);
+		}
+	}
+}
+
+const FieldNormalizer::Block *FieldNormalizer::block(int index)
+{
+	Block *b = _blocks[index].loadAcquire();
+	if (b) {
+		return b;
+	}
+	b = new Block;
+	QString folded;
+	for (int k = 0; k < 256; k++) {
+		b->offsets[k] = folded.size();
+		ushort u = (index << 8) | k;
+		if (!QChar::isSurrogate(u)) {
+			appendFolded(folded, QString(QChar(u)));
+		}
+	}
+	b->offsets[256] = folded.size();
+	b->chars = folded.toLatin1();
+
+	// Another thread may have built the same block meanwhile
+	if (!_blocks[index].testAndSetOrdered(nullptr, b)) {
+		delete b;
+		b = _blocks[index].loadAcquire();
+	}
+	return b;
+}
+
+QString FieldNormalizer::normalize(const QString &s)
+{
+	const ushort *u = s.utf16();
+	const int size = s.size();
+	QString folded;
+	folded.reserve(size);
+
+	int i = 0;
+	for (; i < size && u[i] < 0x80; i++) {
+		if (isAsciiWord(u[i])) {
+			folded.append(QChar(asciiToLower(u[i])));
+		}
+	}
+
+	if (i < size) {
+		{
+			QMutexLocker locker(&cacheMutex);
+			if (QString *result = cache.object(s)) {
+				return *result;
+			}
+		}
+		for (; i < size; i++) {
+			if (u[i] < 0x80) {
+				if (isAsciiWord(u[i])) {
+					folded.append(QChar(asciiToLower(u[i])));
+				}
+			} else if (QChar::isHighSurrogate(u[i]) && i + 1 < size && QChar::isLowSurrogate(u[i + 1])) {
+				// Characters outside of the BMP are rare: mathematical letters, emojis, etc.
+				appendFolded(folded, s.mid(i, 2));
+				i++;
+			} else if (!QChar::isSurrogate(u[i])) {
+				const Block *b = block(u[i] >> 8);
+				int k = u[i] & 0xff;
+				for (int j = b->offsets[k]; j < b->offsets[k + 1]; j++) {
+					folded.append(QLatin1Char(b->chars.at(j)));
+				}
+			}
+		}
+		if (folded.isEmpty()) {
+			folded = s.toLower().remove(" ").trimmed();
+		}
+		QMutexLocker locker(&cacheMutex);
+		cache.insert(s, new QString(folded));
+		return folded;
+	}
+
+	if (folded.isEmpty()) {
+		return s.toLower().remove(" ").trimmed();
+	}
+	return folded;
+}
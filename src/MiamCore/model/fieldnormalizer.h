@@ -0,0 +1,48 @@
+#ifndef FIELDNORMALIZER_H
+#define FIELDNORMALIZER_H
+
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QString>
+
+#include "../miamcore_global.h"
+
+/**
+ * \brief		The FieldNormalizer class builds the normalized names which identify artists and albums, and sort items.
+ * \details		A name is lowered, decomposed with NFKD, then only ASCII letters, digits and '_' are kept. If nothing is left,
+ *				the name is only lowered without its spaces.
+ *				ASCII characters are folded directly. Other characters are folded with tables of 256 characters, which are
+ *				built with Qt the first time one of them is needed, so the result is the same as lowering and decomposing the
+ *				whole string. Results of names which aren't pure ASCII are kept in a small cache. This class can be used from
+ *				any thread.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY FieldNormalizer
+{
+private:
+	/** Folded characters of a block: ASCII output of character k is chars[offsets[k]] to chars[offsets[k + 1]]. */
+	struct Block
+	{
+		quint16 offsets[257];
+		QByteArray chars;
+	};
+
+	/** Blocks of the Basic Multilingual Plane, built on demand. */
+	static QAtomicPointer<Block> _blocks[256];
+
+	FieldNormalizer() {}
+
+	static const Block *block(int index);
+
+	/** Appends the ASCII letters, digits and '_' of a lowered and decomposed character. */
+	static void appendFolded(QString &folded, const QString &character);
+
+public:
+	/** Number of results of non-ASCII names which are cached. */
+	static const int CACHE_SIZE;
+
+	static QString normalize(const QString &s);
+};
+
+#endif // FIELDNORMALIZER_H
@@ -1,4 +1,5 @@
 #include "genericdao.h"
+#include "stringpool.h"
 
 GenericDAO::GenericDAO(Miam::ItemType itemType, QObject *parent)
 	: QObject(parent)
@@ -38,10 +39,10 @@ QString GenericDAO::checksum() const { return _checksum; }
 void GenericDAO::setChecksum(const QString &checksum) { _checksum = checksum; }
 
 QString GenericDAO::host() const { return _host; }
-void GenericDAO::setHost(const QString &host) { _host = host; }
+void GenericDAO::setHost(const QString &host) { _host = StringPool::instance()->intern(host); }
 
 QString GenericDAO::icon() const { return _icon; }
-void GenericDAO::setIcon(const QString &icon) { _icon = icon; }
+void GenericDAO::setIcon(const QString &icon) { _icon = StringPool::instance()->intern(icon); }
 
 QString GenericDAO::id() const { return _id; }
 void GenericDAO::setId(const QString &id) { _id = id; }
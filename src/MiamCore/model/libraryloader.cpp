@@ -0,0 +1,239 @@
+#include "libraryloader.h"
+
+#include "fieldnormalizer.h"
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <QtDebug>
+
+const int LibraryLoader::NODES_PER_BATCH = 1024;
+
+LibraryLoader::LibraryLoader(const QString &databaseName, const QSharedPointer<NodeStore> &store, QObject *parent)
+	: QObject(parent)
+	, QRunnable()
+	, _databaseName(databaseName)
+	, _store(store)
+	, _sentNodes(0)
+	, _snapshot(LibrarySnapshot::filePathForDatabase(databaseName))
+{
+	// Deleted by its owner, in the thread of the views
+	setAutoDelete(false);
+
+	auto settings = SettingsPrivate::instance();
+	_insertPolicy = settings->insertPolicy();
+	if (settings->isLibraryFilteredByArticles()) {
+		_articles = settings->libraryFilteredByArticles();
+	}
+}
+
+/** Builds the query which returns the whole library for an insert policy, ordered like nodes have to be sent. */
+QString LibraryLoader::librarySql() const
+{
+	// Every insert policy is loaded with a single query, ordered such that all rows of a node are contiguous, and such
+	// that indexes can be walked without any temporary sort. Parent nodes are built when their id changes, and nodes
+	// without children are kept thanks to LEFT JOINs.
+	// Columns are always: artist (0-2), album (3-9), track (10-21)
+	static const QString trackColumns = "t.uri, t.trackNumber, t.title, tart.name, alb.name, t.artistAlbum, t.length, t.rating, " \
+		"t.disc, t.internalCover, ht.name, t.icon";
+	static const QString trackJoins = "LEFT JOIN hosts ha ON alb.hostId = ha.id " \
+		"LEFT JOIN (tracks t INNER JOIN artists tart ON t.artistId = tart.id LEFT JOIN hosts ht ON t.hostId = ht.id) ";
+
+	switch (_insertPolicy) {
+	case SettingsPrivate::IP_Artists:
+		// Level 1: Artists, Level 2: Albums, Level 3: Tracks
+		return "SELECT art.id, art.name, art.normalizedName, alb.id, alb.name, alb.normalizedName, alb.year, alb.cover, ha.name, alb.icon, " +
+			trackColumns + " FROM artists art LEFT JOIN albums alb ON alb.artistId = art.id " + trackJoins +
+			"ON t.albumId = alb.id AND t.artistId = art.id ORDER BY art.id, alb.id";
+	case SettingsPrivate::IP_Albums:
+		// Level 1: Albums, Level 2: Tracks
+		return "SELECT NULL, NULL, NULL, alb.id, alb.name, alb.normalizedName, alb.year, alb.cover, ha.name, alb.icon, " +
+			trackColumns + " FROM albums alb " + trackJoins + "ON t.albumId = alb.id ORDER BY alb.id";
+	case SettingsPrivate::IP_ArtistsAlbums:
+		// Level 1: Artist - Album, Level 2: Tracks
+		return "SELECT art.id, art.name, art.normalizedName, alb.id, art.name || ' – ' || alb.name, art.normalizedName || alb.normalizedName, " \
+			"alb.year, alb.cover, ha.name, alb.icon, " + trackColumns + " FROM albums alb INNER JOIN artists art ON alb.artistId = art.id " +
+			trackJoins + "ON t.albumId = alb.id ORDER BY alb.id";
+	case SettingsPrivate::IP_Years:
+		// Level 1: Years, Level 2: Artist - Album, Level 3: Tracks. Years without any valid album are displayed too
+		return "SELECT art.id, art.name, art.normalizedName, alb.id, art.name || ' – ' || alb.name, art.normalizedName || alb.normalizedName, " \
+			"alb.year, alb.cover, ha.name, alb.icon, " + trackColumns + " FROM albums alb LEFT JOIN artists art ON alb.artistId = art.id " +
+			trackJoins + "ON t.albumId = alb.id AND t.artistId = art.id ORDER BY alb.year, alb.artistId, alb.id";
+	}
+	return QString();
+}
+
+void LibraryLoader::run()
+{
+	// A connection can only be used in the thread which has created it
+	QString connectionName = QString("libraryLoader_%1").arg(reinterpret_cast<quintptr>(this));
+	{
+		QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+		db.setDatabaseName(_databaseName);
+		db.setConnectOptions("QSQLITE_OPEN_READONLY");
+		if (db.open()) {
+			// The version is read before nodes: if the library changes meanwhile, the new snapshot will be stale
+			LibrarySnapshot::Key key;
+			key.insertPolicy = _insertPolicy;
+			key.settingsHash = qHash(_articles.join('\n'));
+			QSqlQuery qVersion(db);
+			if (qVersion.exec("SELECT value FROM properties WHERE key = 'libraryVersion'") && qVersion.next()) {
+				key.libraryVersion = qVersion.value(0).toLongLong();
+			}
+			qVersion.finish();
+
+			if (!_snapshot.read(key, _store.data())) {
+				this->loadFromDatabase(db);
+				if (_isCancelled.load() == 0 && key.libraryVersion >= 0) {
+					_snapshot.save(key, *_store);
+				}
+			}
+		} else {
+			qWarning() << Q_FUNC_INFO << db.lastError();
+		}
+	}
+	QSqlDatabase::removeDatabase(connectionName);
+
+	if (_isCancelled.load() == 0) {
+		this->sendNodes(true);
+	}
+	emit finished();
+}
+
+/** Reads every node from the database. */
+void LibraryLoader::loadFromDatabase(QSqlDatabase &db)
+{
+	qint32 yearIndex = -1;
+	qint32 artistIndex = -1;
+	qint32 albumIndex = -1;
+	QVariant currentYear;
+	uint currentArtistId = 0;
+	uint currentAlbumId = 0;
+	bool internalCover = false;
+
+	// Albums are sent with all their tracks, when the cover is known: views don't have to update them afterwards
+	auto closeAlbum = [this, &albumIndex, &internalCover] () -> void {
+		albumIndex = -1;
+		internalCover = false;
+		this->sendNodes(false);
+	};
+	auto string = [this] (const QVariant &v) -> quint32 {
+		return _store->stringIndex(v.toString());
+	};
+
+	QSqlQuery qLibrary(db);
+	qLibrary.setForwardOnly(true);
+	if (!qLibrary.exec(this->librarySql())) {
+		qDebug() << Q_FUNC_INFO << qLibrary.lastError();
+	}
+	while (_isCancelled.load() == 0 && qLibrary.next()) {
+		// A row adds at most three records: the library is loaded until the store is full, instead of writing past its blocks
+		if (!_store->canAppend(3)) {
+			qWarning() << Q_FUNC_INFO << "the library has too many nodes, the last ones are not loaded";
+			break;
+		}
+		if (_insertPolicy == SettingsPrivate::IP_Years) {
+			QVariant vYear = qLibrary.value(6);
+			if (yearIndex < 0 || vYear != currentYear) {
+				closeAlbum();
+				currentYear = vYear;
+				NodeStore::Node year(Miam::IT_Year);
+				year.year = vYear.toInt();
+				year.strings[NodeStore::S_Title] = string(vYear);
+				year.strings[NodeStore::S_TitleNormalized] = year.strings[NodeStore::S_Title];
+				yearIndex = _store->append(year);
+			}
+			if (qLibrary.value(0).isNull()) {
+				continue;
+			}
+		} else if (_insertPolicy == SettingsPrivate::IP_Artists) {
+			uint artistId = qLibrary.value(0).toUInt();
+			if (artistIndex < 0 || artistId != currentArtistId) {
+				closeAlbum();
+				currentArtistId = artistId;
+				NodeStore::Node artist(Miam::IT_Artist);
+				QString name = qLibrary.value(1).toString();
+				artist.id = artistId;
+				artist.strings[NodeStore::S_Title] = string(name);
+				if (_articles.isEmpty()) {
+					artist.strings[NodeStore::S_TitleNormalized] = string(qLibrary.value(2));
+				} else {
+					for (QString article : _articles) {
+						if (name.startsWith(article + " ", Qt::CaseInsensitive)) {
+							name = name.mid(article.length() + 1);
+							artist.strings[NodeStore::S_CustomData] = string(name + ", " + article);
+							break;
+						}
+					}
+					artist.strings[NodeStore::S_TitleNormalized] = string(FieldNormalizer::normalize(name));
+				}
+				artistIndex = _store->append(artist);
+			}
+		}
+
+		// Albums
+		if (qLibrary.value(3).isNull()) {
+			continue;
+		}
+		uint albumId = qLibrary.value(3).toUInt();
+		if (albumIndex < 0 || albumId != currentAlbumId) {
+			closeAlbum();
+			currentAlbumId = albumId;
+			NodeStore::Node album(Miam::IT_Album);
+			album.id = albumId;
+			album.strings[NodeStore::S_Title] = string(qLibrary.value(4));
+			album.strings[NodeStore::S_TitleNormalized] = string(qLibrary.value(5));
+			album.year = qLibrary.value(6).toInt();
+			album.strings[NodeStore::S_Cover] = string(qLibrary.value(7));
+			album.strings[NodeStore::S_Host] = string(qLibrary.value(8));
+			album.strings[NodeStore::S_Icon] = string(qLibrary.value(9));
+			if (_insertPolicy == SettingsPrivate::IP_Artists) {
+				album.parent = artistIndex;
+				album.strings[NodeStore::S_Artist] = _store->node(artistIndex).strings[NodeStore::S_Title];
+			} else if (_insertPolicy == SettingsPrivate::IP_Years) {
+				album.parent = yearIndex;
+			}
+			albumIndex = _store->append(album);
+		}
+
+		// Tracks
+		if (qLibrary.value(10).isNull()) {
+			continue;
+		}
+		NodeStore::Node track(Miam::IT_Track);
+		quint32 uri = string(qLibrary.value(10));
+		track.strings[NodeStore::S_Uri] = uri;
+		track.trackNumber = qLibrary.value(11).toInt();
+		track.strings[NodeStore::S_Title] = string(qLibrary.value(12));
+		track.strings[NodeStore::S_Artist] = string(qLibrary.value(13));
+		track.strings[NodeStore::S_Album] = string(qLibrary.value(14));
+		track.strings[NodeStore::S_ArtistAlbum] = string(qLibrary.value(15));
+		track.length = qLibrary.value(16).toInt();
+		track.rating = qLibrary.value(17).toInt();
+		track.disc = qLibrary.value(18).toInt();
+		if (!internalCover && qLibrary.value(19).toBool()) {
+			// Cover path is pointing to the first track of this album, because it need to be extracted at runtime
+			_store->node(albumIndex).strings[NodeStore::S_Cover] = uri;
+			internalCover = true;
+		}
+		track.strings[NodeStore::S_Host] = string(qLibrary.value(20));
+		track.strings[NodeStore::S_Icon] = string(qLibrary.value(21));
+		track.parent = albumIndex;
+		track.year = _store->node(albumIndex).year;
+		_store->append(track);
+	}
+	if (_isCancelled.load() == 0) {
+		closeAlbum();
+	}
+}
+
+/** Sends nodes which were appended since the last batch. Nodes must be complete: they'll be read by another thread. */
+void LibraryLoader::sendNodes(bool isLastBatch)
+{
+	quint32 size = _store->size();
+	if (size - _sentNodes >= (quint32)NODES_PER_BATCH || (isLastBatch && size > _sentNodes)) {
+		emit nodesLoaded(_sentNodes, size - _sentNodes);
+		_sentNodes = size;
+	}
+}
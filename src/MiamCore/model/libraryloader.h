@@ -0,0 +1,75 @@
+#ifndef LIBRARYLOADER_H
+#define LIBRARYLOADER_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QStringList>
+
+#include "../miamcore_global.h"
+#include "../settingsprivate.h"
+#include "librarysnapshot.h"
+#include "nodestore.h"
+
+/**
+ * \brief		The LibraryLoader class reads the whole library in a thread pool, and builds nodes for the views.
+ * \details		It uses its own read-only connection to the database, so the UI isn't frozen while nodes are built. Nodes are
+ *				appended to a NodeStore in display order, and ranges of complete nodes are sent by batches: parents are always
+ *				sent before their children.
+ *				When the snapshot saved by a previous loader is still valid, nodes are read from it instead of the database.
+ *				Otherwise nodes built from the database are saved in a new snapshot.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY LibraryLoader : public QObject, public QRunnable
+{
+	Q_OBJECT
+private:
+	QString _databaseName;
+
+	SettingsPrivate::InsertPolicy _insertPolicy;
+
+	/** Articles like "The" which are moved at the end of artists' names, when enabled. */
+	QStringList _articles;
+
+	QAtomicInt _isCancelled;
+
+	QSharedPointer<NodeStore> _store;
+
+	/** Number of nodes which were already sent. */
+	quint32 _sentNodes;
+
+	LibrarySnapshot _snapshot;
+
+	/** Number of nodes sent at once to the views. */
+	static const int NODES_PER_BATCH;
+
+public:
+	LibraryLoader(const QString &databaseName, const QSharedPointer<NodeStore> &store, QObject *parent = nullptr);
+
+	/** Stops the loader as soon as possible. Nodes which were already sent are still valid. */
+	inline void cancel() { _isCancelled.store(1); }
+
+	virtual void run() override;
+
+private:
+	/** Builds the query which returns the whole library for an insert policy, ordered like nodes have to be sent. */
+	QString librarySql() const;
+
+	/** Reads every node from the database. */
+	void loadFromDatabase(QSqlDatabase &db);
+
+	/** Sends nodes which were appended since the last batch. Nodes must be complete: they'll be read by another thread. */
+	void sendNodes(bool isLastBatch);
+
+signals:
+	/** A range of nodes in the store, in display order, emitted from the thread pool. */
+	void nodesLoaded(quint32 first, quint32 count);
+
+	/** Emitted when everything has been sent, or when the loader was cancelled. */
+	void finished();
+};
+
+#endif // LIBRARYLOADER_H
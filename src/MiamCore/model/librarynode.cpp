@@ -0,0 +1,53 @@
+#include "librarynode.h"
+
+#include "nodestore.h"
+
+#include <QHash>
+
+Miam::ItemType LibraryNode::type() const { return static_cast<Miam::ItemType>(_store->node(_index).type); }
+
+LibraryNode LibraryNode::parentNode() const
+{
+	qint32 parent = _store->node(_index).parent;
+	return parent < 0 ? LibraryNode() : LibraryNode(_store, parent);
+}
+
+uint LibraryNode::id() const { return _store->node(_index).id; }
+
+const QString &LibraryNode::title() const { return _store->string(_store->node(_index).strings[NodeStore::S_Title]); }
+const QString &LibraryNode::titleNormalized() const { return _store->string(_store->node(_index).strings[NodeStore::S_TitleNormalized]); }
+const QString &LibraryNode::host() const { return _store->string(_store->node(_index).strings[NodeStore::S_Host]); }
+const QString &LibraryNode::icon() const { return _store->string(_store->node(_index).strings[NodeStore::S_Icon]); }
+const QString &LibraryNode::customData() const { return _store->string(_store->node(_index).strings[NodeStore::S_CustomData]); }
+const QString &LibraryNode::artist() const { return _store->string(_store->node(_index).strings[NodeStore::S_Artist]); }
+const QString &LibraryNode::album() const { return _store->string(_store->node(_index).strings[NodeStore::S_Album]); }
+const QString &LibraryNode::artistAlbum() const { return _store->string(_store->node(_index).strings[NodeStore::S_ArtistAlbum]); }
+const QString &LibraryNode::cover() const { return _store->string(_store->node(_index).strings[NodeStore::S_Cover]); }
+const QString &LibraryNode::uri() const { return _store->string(_store->node(_index).strings[NodeStore::S_Uri]); }
+
+int LibraryNode::trackNumber() const { return _store->node(_index).trackNumber; }
+int LibraryNode::disc() const { return _store->node(_index).disc; }
+int LibraryNode::length() const { return _store->node(_index).length; }
+int LibraryNode::year() const { return _store->node(_index).year; }
+int LibraryNode::rating() const { return _store->node(_index).rating; }
+
+/** Same node in a tree has the same hash, whichever store it comes from. */
+uint LibraryNode::hash() const
+{
+	const NodeStore::Node &node = _store->node(_index);
+	uint h;
+	switch (node.type) {
+	case Miam::IT_Album:
+		return qHash(titleNormalized()) ^ qHash(node.type) ^ qHash(node.year) ^ qHash(artist());
+	case Miam::IT_Track:
+		h = qHash(title()) ^ qHash(node.rating);
+		break;
+	default:
+		h = qHash(titleNormalized()) ^ qHash(node.type);
+		break;
+	}
+	if (node.type != Miam::IT_Year && node.parent >= 0) {
+		h ^= this->parentNode().hash();
+	}
+	return h;
+}
@@ -0,0 +1,72 @@
+#ifndef LIBRARYNODE_H
+#define LIBRARYNODE_H
+
+#include <QMetaType>
+#include <QString>
+
+#include "../miamcore_global.h"
+
+/// Forward declaration
+class NodeStore;
+
+/**
+ * \brief		The LibraryNode class is a lightweight handle to an artist, an album, a track or a year in a NodeStore.
+ * \details		It can be copied and sent by value in signals. A handle is valid as long as its store is alive, which is until
+ *				the library is loaded again: views have to copy what they need.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY LibraryNode
+{
+private:
+	const NodeStore *_store;
+	quint32 _index;
+
+public:
+	LibraryNode() : _store(nullptr), _index(0) {}
+
+	LibraryNode(const NodeStore *store, quint32 index) : _store(store), _index(index) {}
+
+	inline bool isValid() const { return _store != nullptr; }
+
+	inline const NodeStore *store() const { return _store; }
+	inline quint32 index() const { return _index; }
+
+	inline bool operator==(const LibraryNode &other) const { return _store == other._store && _index == other._index; }
+	inline bool operator!=(const LibraryNode &other) const { return !(*this == other); }
+
+	Miam::ItemType type() const;
+
+	/** Returns an invalid node for top level nodes. */
+	LibraryNode parentNode() const;
+
+	uint id() const;
+
+	const QString &title() const;
+	const QString &titleNormalized() const;
+	const QString &host() const;
+	const QString &icon() const;
+
+	/** Text displayed instead of the title, like "Beatles, The" when articles are moved. */
+	const QString &customData() const;
+
+	const QString &artist() const;
+	const QString &album() const;
+	const QString &artistAlbum() const;
+	const QString &cover() const;
+	const QString &uri() const;
+
+	int trackNumber() const;
+	int disc() const;
+	int length() const;
+	int year() const;
+	int rating() const;
+
+	/** Same node in a tree has the same hash, whichever store it comes from. */
+	uint hash() const;
+};
+
+/** Register this class to send it with queued connections. */
+Q_DECLARE_METATYPE(LibraryNode)
+
+#endif // LIBRARYNODE_H
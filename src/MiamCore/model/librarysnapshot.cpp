@@ -0,0 +1,125 @@
+#include "librarysnapshot.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+
+#include <QtDebug>
+
+const quint32 LibrarySnapshot::MAGIC = 0x4d4c5353; // "MLSS"
+const quint32 LibrarySnapshot::BYTE_ORDER = 0x01020304;
+const quint32 LibrarySnapshot::FORMAT_VERSION = 3;
+
+LibrarySnapshot::LibrarySnapshot(const QString &filePath)
+	: _filePath(filePath)
+{}
+
+/** Maps records in an empty store, and appends strings. Returns false if the snapshot doesn't match the key. */
+bool LibrarySnapshot::read(const Key &key, NodeStore *store) const
+{
+	QScopedPointer<QFile> file(new QFile(_filePath));
+	if (!file->open(QIODevice::ReadOnly) || file->size() < (qint64)sizeof(Header) || store->size() != 0) {
+		return false;
+	}
+	// Records are served from the mapping: a private one, so that the store can still modify them without changing the file
+	uchar *data = file->map(0, file->size(), QFileDevice::MapPrivateOption);
+	if (!data) {
+		return false;
+	}
+
+	// Everything is checked before the store is filled, a stale or damaged snapshot is simply ignored
+	const Header *header = reinterpret_cast<const Header*>(data);
+	if (header->magic != MAGIC || header->formatVersion != FORMAT_VERSION || header->byteOrder != BYTE_ORDER ||
+			header->nodeSize != sizeof(NodeStore::Node) || header->libraryVersion != key.libraryVersion ||
+			header->insertPolicy != key.insertPolicy || header->settingsHash != key.settingsHash || header->stringCount == 0) {
+		return false;
+	}
+	quint64 expectedSize = sizeof(Header) + (quint64)header->nodeCount * sizeof(NodeStore::Node) +
+		((quint64)header->stringCount + 1) * sizeof(quint32) + header->stringDataSize * sizeof(QChar);
+	if (expectedSize != (quint64)file->size()) {
+		return false;
+	}
+	NodeStore::Node *nodes = reinterpret_cast<NodeStore::Node*>(data + sizeof(Header));
+	const quint32 *offsets = reinterpret_cast<const quint32*>(nodes + header->nodeCount);
+	const QChar *chars = reinterpret_cast<const QChar*>(offsets + header->stringCount + 1);
+	for (quint32 i = 0; i < header->stringCount; i++) {
+		if (offsets[i] > offsets[i + 1]) {
+			return false;
+		}
+	}
+	if (offsets[header->stringCount] != header->stringDataSize || !store->canAppendStrings(header->stringCount)) {
+		return false;
+	}
+	for (quint32 i = 0; i < header->nodeCount; i++) {
+		const NodeStore::Node &node = nodes[i];
+		if (node.parent >= (qint32)i) {
+			return false;
+		}
+		for (int f = 0; f < NodeStore::S_Count; f++) {
+			if (node.strings[f] >= header->stringCount) {
+				return false;
+			}
+		}
+	}
+
+	// The empty string is already in the store. Strings are copied in the StringPool, unlike records: views keep copies of
+	// them, which could outlive the mapping if they only referenced it
+	for (quint32 i = 1; i < header->stringCount; i++) {
+		store->appendString(QString(chars + offsets[i], offsets[i + 1] - offsets[i]));
+	}
+	store->mapNodes(file.take(), nodes, header->nodeCount);
+	return true;
+}
+
+/** Replaces the file with the content of a store. */
+bool LibrarySnapshot::save(const Key &key, const NodeStore &store) const
+{
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	header.magic = MAGIC;
+	header.formatVersion = FORMAT_VERSION;
+	header.byteOrder = BYTE_ORDER;
+	header.nodeSize = sizeof(NodeStore::Node);
+	header.libraryVersion = key.libraryVersion;
+	header.insertPolicy = key.insertPolicy;
+	header.settingsHash = key.settingsHash;
+	header.nodeCount = store.size();
+	header.stringCount = store.stringCount();
+
+	QVector<quint32> offsets;
+	offsets.reserve(store.stringCount() + 1);
+	quint32 offset = 0;
+	for (quint32 i = 0; i < store.stringCount(); i++) {
+		offsets.append(offset);
+		offset += store.string(i).size();
+	}
+	offsets.append(offset);
+	header.stringDataSize = offset;
+
+	// The previous snapshot is replaced only when the new one is complete
+	QSaveFile file(_filePath);
+	bool ok = file.open(QIODevice::WriteOnly);
+	if (ok) {
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		for (quint32 i = 0; i < store.size(); i++) {
+			file.write(reinterpret_cast<const char*>(&store.node(i)), sizeof(NodeStore::Node));
+		}
+		file.write(reinterpret_cast<const char*>(offsets.constData()), offsets.size() * sizeof(quint32));
+		for (quint32 i = 0; i < store.stringCount(); i++) {
+			const QString &s = store.string(i);
+			file.write(reinterpret_cast<const char*>(s.constData()), s.size() * sizeof(QChar));
+		}
+		ok = file.commit();
+	}
+	if (!ok) {
+		qWarning() << Q_FUNC_INFO << "cannot save" << _filePath << file.errorString();
+	}
+	return ok;
+}
+
+/** Path of the snapshot of a database, in the same directory. */
+QString LibrarySnapshot::filePathForDatabase(const QString &databaseName)
+{
+	return QFileInfo(databaseName).absolutePath() + "/library.snapshot";
+}
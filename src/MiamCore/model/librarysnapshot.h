@@ -0,0 +1,68 @@
+#ifndef LIBRARYSNAPSHOT_H
+#define LIBRARYSNAPSHOT_H
+
+#include <QString>
+
+#include "../miamcore_global.h"
+#include "nodestore.h"
+
+/**
+ * \brief		The LibrarySnapshot class saves the tree of nodes built from the database in a compact binary file.
+ * \details		The file has a header, the fixed-size records of a NodeStore in display order, then its table of UTF-16
+ *				strings which are shared by records. It's mapped in memory when it's read, and records are served from the
+ *				mapping by the store, so the library can be displayed at startup without running any SQL query.
+ *				A snapshot is valid only for the version of the library it was built from, and for the same insert policy.
+ *				Records are not serialized: a file built on a machine with another byte order or another layout of records
+ *				is ignored.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY LibrarySnapshot
+{
+public:
+	/** Identifies the state of the library and the settings which were used to build nodes. */
+	struct Key
+	{
+		qint64 libraryVersion;
+		qint32 insertPolicy;
+		quint32 settingsHash;
+
+		Key() : libraryVersion(-1), insertPolicy(0), settingsHash(0) {}
+	};
+
+private:
+	/** Records are written as they are in memory: the byte order and their size must be the same when they're mapped. */
+	struct Header
+	{
+		quint32 magic;
+		quint32 formatVersion;
+		quint32 byteOrder;
+		quint32 nodeSize;
+		qint64 libraryVersion;
+		qint32 insertPolicy;
+		quint32 settingsHash;
+		quint32 nodeCount;
+		quint32 stringCount;
+		quint64 stringDataSize;
+	};
+
+	QString _filePath;
+
+	static const quint32 MAGIC;
+	static const quint32 BYTE_ORDER;
+	static const quint32 FORMAT_VERSION;
+
+public:
+	explicit LibrarySnapshot(const QString &filePath);
+
+	/** Maps records in an empty store, and appends strings. Returns false if the snapshot doesn't match the key. */
+	bool read(const Key &key, NodeStore *store) const;
+
+	/** Replaces the file with the content of a store. */
+	bool save(const Key &key, const NodeStore &store) const;
+
+	/** Path of the snapshot of a database, in the same directory. */
+	static QString filePathForDatabase(const QString &databaseName);
+};
+
+#endif // LIBRARYSNAPSHOT_H
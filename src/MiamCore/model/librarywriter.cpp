@@ -0,0 +1,157 @@
+#include "librarywriter.h"
+
+#include "sqldatabase.h"
+
+#include <QFileInfo>
+#include <QSqlError>
+
+#include <QtDebug>
+
+const int LibraryWriter::ROWS_PER_STATEMENT = 64;
+const int LibraryWriter::TRACKS_PER_TRANSACTION = 4096;
+
+LibraryWriter::LibraryWriter(SqlDatabase *db)
+	: _db(db)
+	, _isInitialized(false)
+	, _pendingTracks(0)
+	, _tracksInTransaction(0)
+{}
+
+/** Forgets everything about artists and albums. Has to be called when tables have been modified by someone else. */
+void LibraryWriter::clear()
+{
+	this->flush();
+	_existingArtistIds.clear();
+	_existingAlbumIds.clear();
+	_artistIds.clear();
+	_albumIds.clear();
+	_tracksInTransaction = 0;
+	_isInitialized = false;
+}
+
+/** Inserts all pending rows. */
+void LibraryWriter::flush()
+{
+	if (_pendingTracks == 0) {
+		return;
+	}
+	// A modified file replaces its previous record
+	this->insertRows("INSERT OR REPLACE INTO tracks (uri, trackNumber, title, artistId, albumId, artistAlbum, length, " \
+		"disc, internalCover, rating)", 10, _tracks);
+	this->insertRows("INSERT OR REPLACE INTO fileSignatures (path, size, lastModified, inode)", 4, _signatures);
+	_db->libraryHasChanged();
+
+	_tracksInTransaction += _pendingTracks;
+	_pendingTracks = 0;
+
+	// Committing everything at the end of a scan would need a huge journal, and would be lost on a crash. Tracks written
+	// during an edit are committed with it
+	if (_tracksInTransaction >= TRACKS_PER_TRANSACTION) {
+		_db->updateTableProperties("scanCheckpoint", QFileInfo(_lastFile).absolutePath());
+		if (_db->commitScanBatch()) {
+			_tracksInTransaction = 0;
+		}
+	}
+}
+
+/** Adds a track, its album and its artist, if they're not already in the database. Rowids of new artists and albums
+ * are needed by their tracks, so they're inserted immediately. */
+void LibraryWriter::write(const TrackMetadata &track)
+{
+	if (!_isInitialized) {
+		this->init();
+	}
+
+	QString artistAlbum = track.artistAlbum.isEmpty() ? track.artist : track.artistAlbum;
+	// Use Artist Album to reference tracks in table "tracks", not Artist
+	QString artistNorm = _db->normalizeField(artistAlbum);
+	QString albumNorm = _db->normalizeField(track.album);
+
+	uint artistId = _artistIds.value(artistNorm);
+	if (artistId == 0) {
+		artistId = _db->insertArtist(artistAlbum, artistNorm, QVariant(QVariant::Int));
+		_artistIds.insert(artistNorm, artistId);
+		if (_existingArtistIds.contains(artistId)) {
+			QSqlQuery &updateArtist = _db->preparedQuery("UPDATE artists SET name = ?, hostId = NULL WHERE id = ?");
+			updateArtist.bindValue(0, artistAlbum);
+			updateArtist.bindValue(1, artistId);
+			updateArtist.exec();
+		}
+	}
+
+	QPair<uint, QString> albumKey(artistId, albumNorm);
+	uint albumId = _albumIds.value(albumKey);
+	if (albumId == 0) {
+		QVariant year = track.year.isEmpty() ? QVariant(0) : QVariant(track.year);
+		albumId = _db->insertAlbum(artistId, track.album, albumNorm, year, QVariant(QVariant::Int));
+		_albumIds.insert(albumKey, albumId);
+		if (_existingAlbumIds.contains(albumId)) {
+			// Remote album with an icon in the treeview, then we add the exact same album from harddrive
+			// for example, first: listenned in streaming, second: enjoyed, then downloaded (legit DL of course)
+			QSqlQuery &updateAlbum = _db->preparedQuery("UPDATE albums SET name = ?, hostId = NULL, icon = NULL WHERE id = ?");
+			updateAlbum.bindValue(0, track.album);
+			updateAlbum.bindValue(1, albumId);
+			updateAlbum.exec();
+		}
+	}
+
+	_tracks << "file://" + track.absFilePath << track.trackNumber.toInt() << track.title << artistId << albumId
+			<< track.artistAlbum << track.length << track.disc << track.hasCover << track.rating;
+	_signatures << track.absFilePath << track.signature.size << track.signature.lastModified << track.signature.inode;
+	_lastFile = track.absFilePath;
+
+	if (++_pendingTracks == ROWS_PER_STATEMENT) {
+		this->flush();
+	}
+}
+
+void LibraryWriter::init()
+{
+	QSqlQuery selectIds(_db->connection());
+	selectIds.setForwardOnly(true);
+	if (selectIds.exec("SELECT id FROM artists")) {
+		while (selectIds.next()) {
+			_existingArtistIds.insert(selectIds.value(0).toUInt());
+		}
+	}
+	if (selectIds.exec("SELECT id FROM albums")) {
+		while (selectIds.next()) {
+			_existingAlbumIds.insert(selectIds.value(0).toUInt());
+		}
+	}
+	_isInitialized = true;
+}
+
+/** Inserts rows with as few statements as possible: full chunks always reuse the same prepared statement. */
+void LibraryWriter::insertRows(const QString &insertClause, int columnCount, QVariantList &values)
+{
+	QString row = "(?" + QString(", ?").repeated(columnCount - 1) + ")";
+	int rowCount = values.size() / columnCount;
+	for (int first = 0; first < rowCount; first += ROWS_PER_STATEMENT) {
+		int n = qMin(ROWS_PER_STATEMENT, rowCount - first);
+		QStringList rows;
+		rows.reserve(n);
+		for (int i = 0; i < n; i++) {
+			rows.append(row);
+		}
+		QSqlQuery &insert = _db->preparedQuery(insertClause + " VALUES " + rows.join(", "));
+		int offset = first * columnCount;
+		for (int i = 0; i < n * columnCount; i++) {
+			insert.bindValue(i, values.at(offset + i));
+		}
+		if (insert.exec()) {
+			continue;
+		}
+		// A single bad row makes the whole statement fail: rows are inserted again one by one, so that only this one is lost
+		QSqlQuery &insertRow = _db->preparedQuery(insertClause + " VALUES " + row);
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < columnCount; j++) {
+				insertRow.bindValue(j, values.at(offset + i * columnCount + j));
+			}
+			if (!insertRow.exec()) {
+				qWarning() << Q_FUNC_INFO << "cannot insert" << values.at(offset + i * columnCount) << insertRow.lastError();
+			}
+		}
+	}
+	values.clear();
+}
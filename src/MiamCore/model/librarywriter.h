@@ -0,0 +1,71 @@
+#ifndef LIBRARYWRITER_H
+#define LIBRARYWRITER_H
+
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QVariantList>
+
+#include "../miamcore_global.h"
+#include "../tagreader.h"
+
+/// Forward declaration
+class SqlDatabase;
+
+/**
+ * \brief		The LibraryWriter class inserts tracks read from the FileSystem with as few SQL statements as possible.
+ * \details		Ids of artists and albums are remembered, so each of them is looked up, inserted or updated only once. Tracks
+ *				and their signatures are buffered and inserted with multi-rows statements, prepared once by the database and reused.
+ *				When many tracks are written, the current transaction is committed regularly to keep the journal small.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY LibraryWriter
+{
+private:
+	SqlDatabase *_db;
+
+	/** Ids of artists by normalized name, and ids of albums by artist and normalized name. */
+	QHash<QString, uint> _artistIds;
+	QHash<QPair<uint, QString>, uint> _albumIds;
+
+	/** Ids found in tables before writing anything: these records may come from a remote source. */
+	QSet<uint> _existingArtistIds, _existingAlbumIds;
+
+	bool _isInitialized;
+
+	/** Flattened values of rows waiting to be inserted. */
+	QVariantList _tracks, _signatures;
+	int _pendingTracks;
+
+	int _tracksInTransaction;
+
+	/** Last file which was written, its directory is saved as a checkpoint at each commit. */
+	QString _lastFile;
+
+	/** Maximum number of rows in one INSERT statement. SQLite cannot bind more than 999 values. */
+	static const int ROWS_PER_STATEMENT;
+
+	/** Number of tracks after which the current transaction is committed, and the scan can be resumed from there. */
+	static const int TRACKS_PER_TRANSACTION;
+
+public:
+	explicit LibraryWriter(SqlDatabase *db);
+
+	/** Forgets everything about artists and albums. Has to be called when tables have been modified by someone else. */
+	void clear();
+
+	/** Inserts all pending rows. */
+	void flush();
+
+	/** Adds a track, its album and its artist, if they're not already in the database. */
+	void write(const TrackMetadata &track);
+
+private:
+	void init();
+
+	/** Inserts rows with as few statements as possible: full chunks always reuse the same prepared statement. */
+	void insertRows(const QString &insertClause, int columnCount, QVariantList &values);
+};
+
+#endif // LIBRARYWRITER_H
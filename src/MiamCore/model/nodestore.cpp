@@ -0,0 +1,94 @@
+#include "nodestore.h"
+
+#include "albumdao.h"
+#include "artistdao.h"
+#include "trackdao.h"
+
+#include <QtDebug>
+
+const quint32 NodeStore::NO_INDEX = 0xFFFFFFFF;
+
+NodeStore::NodeStore()
+	: _mappedNodes(nullptr)
+	, _mappedNodeCount(0)
+{
+	this->stringIndex(QString());
+}
+
+/** Serves the first records from a file mapped in memory, which is owned by the store. The store must not have any record. */
+void NodeStore::mapNodes(QFile *file, Node *nodes, quint32 count)
+{
+	Q_ASSERT(this->size() == 0);
+	_mappedFile.reset(file);
+	_mappedNodes = nodes;
+	_mappedNodeCount = count;
+}
+
+/** Converts a node built elsewhere, and its parents if they were not converted yet. Returns an invalid node if the store is full. */
+LibraryNode NodeStore::append(const GenericDAO *dao)
+{
+	auto it = _daoIndexes.constFind(dao);
+	if (it != _daoIndexes.constEnd()) {
+		return LibraryNode(this, it.value());
+	}
+	if (!this->canAppend(1)) {
+		qWarning() << Q_FUNC_INFO << "the library has too many nodes";
+		return LibraryNode();
+	}
+
+	Node node(dao->type());
+	if (dao->parentNode()) {
+		LibraryNode parent = this->append(dao->parentNode());
+		if (!parent.isValid()) {
+			return LibraryNode();
+		}
+		node.parent = parent.index();
+	}
+	node.id = dao->id().toUInt();
+	node.strings[S_Title] = this->stringIndex(dao->title());
+	node.strings[S_TitleNormalized] = this->stringIndex(dao->titleNormalized());
+	node.strings[S_Host] = this->stringIndex(dao->host());
+	node.strings[S_Icon] = this->stringIndex(dao->icon());
+	if (const TrackDAO *track = qobject_cast<const TrackDAO*>(dao)) {
+		node.trackNumber = track->trackNumber().toInt();
+		node.disc = track->disc().toInt();
+		node.length = track->length().toInt();
+		node.year = track->year().toInt();
+		node.rating = track->rating();
+		node.strings[S_Artist] = this->stringIndex(track->artist());
+		node.strings[S_Album] = this->stringIndex(track->album());
+		node.strings[S_ArtistAlbum] = this->stringIndex(track->artistAlbum());
+		node.strings[S_Uri] = this->stringIndex(track->uri());
+	} else if (const AlbumDAO *album = qobject_cast<const AlbumDAO*>(dao)) {
+		node.year = album->year().toInt();
+		node.strings[S_Artist] = this->stringIndex(album->artist());
+		node.strings[S_Cover] = this->stringIndex(album->cover());
+	} else if (const ArtistDAO *artist = qobject_cast<const ArtistDAO*>(dao)) {
+		node.strings[S_CustomData] = this->stringIndex(artist->customData());
+	}
+	quint32 index = this->append(node);
+	_daoIndexes.insert(dao, index);
+	return LibraryNode(this, index);
+}
+
+/** Returns the index of a string, which is added if needed. The empty string is used when the table is full. */
+quint32 NodeStore::stringIndex(const QString &s)
+{
+	auto it = _stringIndexes.constFind(s);
+	if (it != _stringIndexes.constEnd()) {
+		return it.value();
+	}
+	quint32 index = this->appendString(s);
+	if (index == NO_INDEX) {
+		return 0;
+	}
+	// The key shares its data with the StringPool, instead of keeping the string of the caller alive
+	_stringIndexes.insert(_strings.at(index), index);
+	return index;
+}
+
+/** Memory used by records and by the table of strings, without mapped records and the data of strings which is in the StringPool. */
+quint64 NodeStore::memoryUsage() const
+{
+	return _nodes.capacity() * sizeof(Node) + _strings.capacity() * sizeof(QString);
+}
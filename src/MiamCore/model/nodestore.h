@@ -0,0 +1,165 @@
+#ifndef NODESTORE_H
+#define NODESTORE_H
+
+#include <QFile>
+#include <QHash>
+#include <QScopedPointer>
+#include <QString>
+
+#include <cstring>
+
+#include "../miamcore_global.h"
+#include "librarynode.h"
+#include "stringpool.h"
+
+/// Forward declaration
+class GenericDAO;
+
+/**
+ * \brief		The NodeStore class keeps every node of the library in a few big blocks of fixed-size records.
+ * \details		Numeric fields are stored as integers, and strings are indexes in a table where each string is stored only once.
+ *				Blocks are never moved: nodes which were appended can be read from another thread, while new nodes are appended
+ *				by the thread which builds the library. The first records can be served from a snapshot mapped in memory, then new
+ *				ones are appended in blocks. Views and plugins don't use records directly, but LibraryNode handles.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY NodeStore
+{
+	Q_DISABLE_COPY(NodeStore)
+
+public:
+	enum StringField : int {
+		S_Title				= 0,
+		S_TitleNormalized	= 1,
+		S_Host				= 2,
+		S_Icon				= 3,
+		S_CustomData		= 4,
+		S_Artist			= 5,
+		S_Album				= 6,
+		S_ArtistAlbum		= 7,
+		S_Cover				= 8,
+		S_Uri				= 9,
+		S_Count				= 10
+	};
+
+	/** Strings are indexes in the table of strings, and 0 is always the empty string. Parent is -1 for top level nodes. */
+	struct Node
+	{
+		qint32 type;
+		qint32 parent;
+		quint32 id;
+		qint32 trackNumber;
+		qint32 disc;
+		qint32 length;
+		qint32 year;
+		qint32 rating;
+		quint32 strings[S_Count];
+
+		explicit Node(int itemType = Miam::IT_UnknownType)
+			: type(itemType), parent(-1), id(0), trackNumber(0), disc(0), length(0), year(0), rating(-1)
+		{
+			memset(strings, 0, sizeof(strings));
+		}
+	};
+
+private:
+	/** Growable array which never moves its elements. */
+	template<typename T>
+	class Blocks
+	{
+		enum { BLOCK_SIZE = 4096, MAX_BLOCKS = 4096 };
+
+		T *_blocks[MAX_BLOCKS];
+		quint32 _size;
+
+	public:
+		Blocks() : _size(0) { memset(_blocks, 0, sizeof(_blocks)); }
+
+		~Blocks() {
+			for (int i = 0; i < MAX_BLOCKS && _blocks[i]; i++) {
+				delete[] _blocks[i];
+			}
+		}
+
+		/** Returns NO_INDEX, without appending anything, when every block is used. */
+		quint32 append(const T &t) {
+			if (!this->canAppend(1)) {
+				return NO_INDEX;
+			}
+			quint32 block = _size / BLOCK_SIZE;
+			if (!_blocks[block]) {
+				_blocks[block] = new T[BLOCK_SIZE];
+			}
+			_blocks[block][_size % BLOCK_SIZE] = t;
+			return _size++;
+		}
+
+		inline T &operator[](quint32 i) { return _blocks[i / BLOCK_SIZE][i % BLOCK_SIZE]; }
+		inline const T &at(quint32 i) const { return _blocks[i / BLOCK_SIZE][i % BLOCK_SIZE]; }
+		inline quint32 size() const { return _size; }
+		inline bool canAppend(quint32 count) const { return (quint64)_size + count <= (quint64)BLOCK_SIZE * MAX_BLOCKS; }
+		inline quint64 capacity() const { return (quint64)((_size + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE; }
+	};
+
+	/** Snapshot which holds the first records, kept mapped as long as the store. It's destroyed after blocks below. */
+	QScopedPointer<QFile> _mappedFile;
+	Node *_mappedNodes;
+	quint32 _mappedNodeCount;
+
+	/** Records appended after mapped ones. */
+	Blocks<Node> _nodes;
+	Blocks<QString> _strings;
+
+	/** Only used by the thread which appends nodes. */
+	QHash<QString, quint32> _stringIndexes;
+	QHash<const GenericDAO*, quint32> _daoIndexes;
+
+public:
+	/** Returned instead of an index when the store is full. */
+	static const quint32 NO_INDEX;
+
+	NodeStore();
+
+	/** Returns true if count records, and all their strings, can still be appended. */
+	inline bool canAppend(quint32 count) const { return _nodes.canAppend(count) && _strings.canAppend(count * S_Count); }
+
+	/** Adds a record, and returns its index. Returns NO_INDEX if the store is full: callers check canAppend() first. */
+	inline quint32 append(const Node &node) {
+		quint32 index = _nodes.append(node);
+		return index == NO_INDEX ? NO_INDEX : _mappedNodeCount + index;
+	}
+
+	/** Serves the first records from a file mapped in memory, which is owned by the store. The store must not have any record. */
+	void mapNodes(QFile *file, Node *nodes, quint32 count);
+
+	/** Converts a node built elsewhere, and its parents if they were not converted yet. Returns an invalid node if the store is full. */
+	LibraryNode append(const GenericDAO *dao);
+
+	/** Forgets DAOs which were converted, before they're deleted: their addresses may be reused by new ones. */
+	inline void clearConvertedDAOs() { _daoIndexes.clear(); }
+
+	inline Node &node(quint32 index) {
+		return index < _mappedNodeCount ? _mappedNodes[index] : _nodes[index - _mappedNodeCount];
+	}
+	inline const Node &node(quint32 index) const {
+		return index < _mappedNodeCount ? _mappedNodes[index] : _nodes.at(index - _mappedNodeCount);
+	}
+	inline quint32 size() const { return _mappedNodeCount + _nodes.size(); }
+
+	/** Adds a string without looking for an equal one in this store. Its data is shared with the StringPool. Returns NO_INDEX
+	 * if the table of strings is full. */
+	inline quint32 appendString(const QString &s) { return _strings.append(StringPool::instance()->intern(s)); }
+
+	/** Returns the index of a string, which is added if needed. The empty string is used when the table is full. */
+	quint32 stringIndex(const QString &s);
+
+	inline bool canAppendStrings(quint32 count) const { return _strings.canAppend(count); }
+	inline const QString &string(quint32 index) const { return _strings.at(index); }
+	inline quint32 stringCount() const { return _strings.size(); }
+
+	/** Memory used by records and by the table of strings, without mapped records and the data of strings which is in the StringPool. */
+	quint64 memoryUsage() const;
+};
+
+#endif // NODESTORE_H
@@ -2,19 +2,27 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QRegularExpression>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QStandardPaths>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QtConcurrent>
 #include <QTimer>
 
 #include <QtDebug>
 
 #include "cover.h"
 #include "settingsprivate.h"
+#include "filesystemmonitor.h"
 #include "musicsearchengine.h"
+#include "fieldnormalizer.h"
 #include "filehelper.h"
+#include "stringpool.h"
 #include "yeardao.h"
 
 #include <chrono>
@@ -22,10 +30,65 @@
 
 SqlDatabase* SqlDatabase::_sqlDatabase = nullptr;
 
+/** Read-only connection of a thread, and its prepared statements. It's closed when the thread exits. */
+struct ReadConnection
+{
+	QString name;
+	QSqlDatabase db;
+	QHash<QString, QSqlQuery> statements;
+
+	~ReadConnection()
+	{
+		statements.clear();
+		db = QSqlDatabase();
+		QSqlDatabase::removeDatabase(name);
+	}
+};
+
+static QThreadStorage<ReadConnection*> readConnections;
+
+/** Opens the read-only connection of the current thread if needed. */
+static ReadConnection* currentReadConnection(const QString &databaseName)
+{
+	ReadConnection *connection = readConnections.localData();
+	if (connection == nullptr) {
+		connection = new ReadConnection;
+		connection->name = QString("reader_%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+		connection->db = QSqlDatabase::addDatabase("QSQLITE", connection->name);
+		connection->db.setDatabaseName(databaseName);
+		connection->db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+		if (!connection->db.open()) {
+			qWarning() << Q_FUNC_INFO << connection->db.lastError();
+		}
+		readConnections.setLocalData(connection);
+	}
+	return connection;
+}
+
 SqlDatabase::SqlDatabase()
-	: QObject(), QSqlDatabase("QSQLITE")
+	: QObject()
+	, _writer(this)
+	, _statementCacheHits(0)
+	, _statementCacheMisses(0)
+	, _transactionDepth(0)
+	, _isLibraryModified(false)
+	, _runningScans(0)
+	, _hasSearchIndex(false)
+	, _isScanCancelled(false)
+	, _loader(nullptr)
+	, _firstLoadedNode(0)
+	, _lastLoadedNode(0)
+	, _loadTimer(new QTimer(this))
+	, _loadChunkSize(256)
 {
+	qRegisterMetaType<LibraryNode>();
+	qRegisterMetaType<QVector<LibraryNode>>();
+	qRegisterMetaType<QList<GenericDAO*>>();
+	connect(_loadTimer, &QTimer::timeout, this, &SqlDatabase::insertLoadedNodes);
+	connect(this, &SqlDatabase::trackRecordsUpdated, this, &SqlDatabase::applyUpdatedTracks, Qt::QueuedConnection);
+
 	_musicSearchEngine = new MusicSearchEngine;
+	_fileSystemMonitor = new FileSystemMonitor;
 	SettingsPrivate *settings = SettingsPrivate::instance();
 	QString path("%1/%2/%3");
 	path = path.arg(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation),
@@ -52,50 +115,413 @@ SqlDatabase::SqlDatabase()
 	}
 	dbFile.open(QIODevice::ReadWrite);
 	dbFile.close();
-	setDatabaseName(dbPath);
-
-	if (open()) {
-		this->setPragmas();
-		QSqlQuery createDb(*this);
-		createDb.exec("CREATE TABLE IF NOT EXISTS artists (id INTEGER PRIMARY KEY, name varchar(255), normalizedName varchar(255), "\
-					  " icon varchar(255), host varchar(255), UNIQUE(normalizedName))");
-		createDb.exec("CREATE TABLE IF NOT EXISTS albums (id INTEGER PRIMARY KEY, name varchar(255), normalizedName varchar(255), " \
-			"year INTEGER, cover varchar(255), artistId INTEGER, host varchar(255), icon varchar(255), UNIQUE(id, artistId))");
-		QString createTableTracks = "CREATE TABLE IF NOT EXISTS tracks (uri varchar(255) PRIMARY KEY ASC, trackNumber INTEGER, " \
-			"title varchar(255), artistId INTEGER, albumId INTEGER, artistAlbum varchar(255), length INTEGER, " \
-			"rating INTEGER, disc INTEGER, internalCover INTEGER DEFAULT 0, host varchar(255), icon varchar(255))";
-		createDb.exec(createTableTracks);
-		createDb.exec("CREATE TABLE IF NOT EXISTS playlists (id INTEGER PRIMARY KEY, title varchar(255), duration INTEGER, icon varchar(255), " \
-					  "host varchar(255), background varchar(255), checksum varchar(255))");
-		createDb.exec("CREATE TABLE IF NOT EXISTS playlistTracks (trackNumber INTEGER, title varchar(255), album varchar(255), length INTEGER, " \
-					  "artist varchar(255), rating INTEGER, year INTEGER, icon varchar(255), host varchar(255), id INTEGER, " \
-					  "url varchar(255), playlistId INTEGER, FOREIGN KEY(playlistId) REFERENCES playlists(id) ON DELETE CASCADE)");
-		/// TEST Monitor Filesystem
-		 createDb.exec("CREATE TABLE IF NOT EXISTS filesystem (path VARCHAR(255) PRIMARY KEY ASC, " \
-			"lastModified INTEGER);");
-	}
+
+	// Every write is run by a single thread, which owns its connection
+	_databaseWriter.start(dbPath);
+	bool isScanInterrupted = false;
+	_databaseWriter.exec([this, &isScanInterrupted]() {
+		if (this->open()) {
+			this->updateSchema();
+			_hasSearchIndex = this->connection().tables().contains("searchIndex");
+			// Read before any scan of this process sets the same flag
+			isScanInterrupted = this->selectProperty("scanInterrupted").toBool();
+		}
+	});
+
+	// The engine walks the FileSystem in its own thread, tags are read in a pool of threads
+	// and every batch is finally written in the database by the writer thread
+	_musicSearchEngine->moveToThread(&_workerThread);
+	_fileSystemMonitor->moveToThread(&_workerThread);
+	_workerThread.start();
+	// Its thread is kept alive, with its read-only connection
+	_queryPool.setMaxThreadCount(1);
+	_queryPool.setExpiryTimeout(-1);
+
+	connect(qApp, &QCoreApplication::aboutToQuit, this, [=]() {
+		if (_loader) {
+			_loader->cancel();
+		}
+		_workerThread.quit();
+		_workerThread.wait();
+		// Statements have to be released before their connection
+		_databaseWriter.post([this]() {
+			_statements.clear();
+		});
+		_databaseWriter.stop();
+		_queryPool.clear();
+		_queryPool.waitForDone();
+	});
 
 	connect(_musicSearchEngine, &MusicSearchEngine::progressChanged, this, &SqlDatabase::progressChanged);
 	connect(_musicSearchEngine, &MusicSearchEngine::scannedCover, this, &SqlDatabase::saveCoverRef);
-	connect(_musicSearchEngine, &MusicSearchEngine::scannedFile, this, &SqlDatabase::saveFileRef);
+	connect(_musicSearchEngine, &MusicSearchEngine::tracksScanned, this, &SqlDatabase::saveFileRefs, Qt::DirectConnection);
+	connect(_musicSearchEngine, &MusicSearchEngine::filesRemoved, this, &SqlDatabase::removeFileRefs);
+	connect(_fileSystemMonitor, &FileSystemMonitor::filesChanged, this, &SqlDatabase::updateFileRefs);
+	connect(_fileSystemMonitor, &FileSystemMonitor::rescanNeeded, this, &SqlDatabase::rescan);
+	this->setWatchForChanges(settings->isFileSystemMonitored());
+
+	connect(_musicSearchEngine, &MusicSearchEngine::entriesScanned, this, [=](int entryCount) {
+		this->updateTableProperties("entryCount", entryCount);
+	});
 
-	// When the scan is complete, save the model in the filesystem
-	connect(_musicSearchEngine, &MusicSearchEngine::searchHasEnded, [=] () {
-		commit();
+	connect(_musicSearchEngine, &MusicSearchEngine::searchWasCancelled, this, [=]() {
+		_isScanCancelled = true;
+	});
 
-		QSqlQuery index(*this);
-		index.exec("CREATE INDEX IF NOT EXISTS indexArtist ON tracks (artistId)");
-		index.exec("CREATE INDEX IF NOT EXISTS indexAlbum ON tracks (albumId)");
-		index.exec("CREATE INDEX IF NOT EXISTS indexPath ON tracks (uri)");
-		index.exec("CREATE INDEX IF NOT EXISTS indexArtistId ON artists (id)");
-		index.exec("CREATE INDEX IF NOT EXISTS indexAlbumId ON albums (id)");
+	// When the scan is complete, save the model in the filesystem. Batches of the scan were queued before
+	connect(_musicSearchEngine, &MusicSearchEngine::searchHasEnded, this, [=] () {
+		bool isCancelled = _isScanCancelled;
+		_isScanCancelled = false;
+		_databaseWriter.post([=]() {
+			_writer.flush();
+			this->savePendingCoverRefs();
+			// Modified or deleted files may have left albums and artists without any track
+			this->cleanNodesWithoutTracks();
+			this->endScan(isCancelled);
+			QMetaObject::invokeMethod(this, "scanHasEnded", Qt::QueuedConnection);
+		});
+	});
 
-		qDebug() << Q_FUNC_INFO;
-		this->loadFromFileDB(true);
+	// A scan which was interrupted by the previous session is resumed only once, when the event loop starts. Signatures were
+	// committed with tracks at each checkpoint: files which are already in the library are skipped
+	if (isScanInterrupted) {
+		qDebug() << Q_FUNC_INFO << "resuming an interrupted scan";
+		QMetaObject::invokeMethod(this, "rescan", Qt::QueuedConnection);
+	}
+}
 
-		// Resync remote players and remote databases
-		emit aboutToResyncRemoteSources();
+const int SqlDatabase::SCHEMA_VERSION = 4;
+const int SqlDatabase::PATHS_PER_STATEMENT = 64;
+const int SqlDatabase::LOAD_CHUNK_MS = 20;
+
+/** Creates tables which don't exist yet, and migrates previous versions of the schema. */
+void SqlDatabase::updateSchema()
+{
+	QSqlQuery schema(this->connection());
+	int version = 0;
+	if (schema.exec("PRAGMA user_version") && schema.next()) {
+		version = schema.value(0).toInt();
+	}
+	// The search index is created as soon as SQLite has FTS5, even if the schema is already up to date
+	bool hasSearchIndex = this->connection().tables().contains("searchIndex");
+	if (version == SCHEMA_VERSION && hasSearchIndex) {
+		return;
+	}
+
+	transaction();
+
+	// Version 1 had no version number. Its ids were hashes of normalized names, which are kept since they are valid rowids
+	bool isMigrating = (version < 2 && this->connection().tables().contains("tracks"));
+	if (isMigrating) {
+		schema.exec("ALTER TABLE artists RENAME TO artists_v1");
+		schema.exec("ALTER TABLE albums RENAME TO albums_v1");
+		schema.exec("ALTER TABLE tracks RENAME TO tracks_v1");
+	}
+
+	// Remote sources are referenced by local records, null means the record is on the FileSystem
+	schema.exec("CREATE TABLE IF NOT EXISTS hosts (id INTEGER PRIMARY KEY, name varchar(255) NOT NULL UNIQUE)");
+	schema.exec("CREATE TABLE IF NOT EXISTS artists (id INTEGER PRIMARY KEY, name varchar(255), normalizedName varchar(255) NOT NULL UNIQUE, " \
+		"icon varchar(255), hostId INTEGER)");
+	schema.exec("CREATE TABLE IF NOT EXISTS albums (id INTEGER PRIMARY KEY, name varchar(255), normalizedName varchar(255) NOT NULL, " \
+		"year INTEGER, cover varchar(255), artistId INTEGER NOT NULL, icon varchar(255), hostId INTEGER, UNIQUE(artistId, normalizedName))");
+	schema.exec("CREATE TABLE IF NOT EXISTS tracks (id INTEGER PRIMARY KEY, uri varchar(255) NOT NULL UNIQUE, trackNumber INTEGER, " \
+		"title varchar(255), artistId INTEGER, albumId INTEGER, artistAlbum varchar(255), length INTEGER, " \
+		"rating INTEGER, disc INTEGER, internalCover INTEGER DEFAULT 0, icon varchar(255), hostId INTEGER)");
+	schema.exec("CREATE TABLE IF NOT EXISTS playlists (id INTEGER PRIMARY KEY, title varchar(255), duration INTEGER, icon varchar(255), " \
+		"host varchar(255), background varchar(255), checksum varchar(255))");
+	schema.exec("CREATE TABLE IF NOT EXISTS playlistTracks (trackNumber INTEGER, title varchar(255), album varchar(255), length INTEGER, " \
+		"artist varchar(255), rating INTEGER, year INTEGER, icon varchar(255), host varchar(255), id INTEGER, " \
+		"url varchar(255), playlistId INTEGER, FOREIGN KEY(playlistId) REFERENCES playlists(id) ON DELETE CASCADE)");
+	schema.exec("CREATE TABLE IF NOT EXISTS fileSignatures (path varchar(255) PRIMARY KEY ASC, size INTEGER, " \
+		"lastModified INTEGER, inode INTEGER)");
+	schema.exec("CREATE TABLE IF NOT EXISTS properties (key varchar(255) PRIMARY KEY ASC, value varchar(255))");
+
+	if (isMigrating) {
+		schema.exec("INSERT OR IGNORE INTO hosts (name) SELECT host FROM artists_v1 WHERE host <> '' " \
+			"UNION SELECT host FROM albums_v1 WHERE host <> '' UNION SELECT host FROM tracks_v1 WHERE host <> ''");
+		schema.exec("INSERT OR IGNORE INTO artists (id, name, normalizedName, icon, hostId) " \
+			"SELECT a.id, a.name, a.normalizedName, a.icon, h.id FROM artists_v1 a LEFT JOIN hosts h ON a.host = h.name");
+		schema.exec("INSERT OR IGNORE INTO albums (id, name, normalizedName, year, cover, artistId, icon, hostId) " \
+			"SELECT a.id, a.name, a.normalizedName, a.year, a.cover, a.artistId, a.icon, h.id FROM albums_v1 a LEFT JOIN hosts h ON a.host = h.name");
+		schema.exec("INSERT OR IGNORE INTO tracks (uri, trackNumber, title, artistId, albumId, artistAlbum, length, rating, disc, " \
+			"internalCover, icon, hostId) SELECT t.uri, t.trackNumber, t.title, t.artistId, t.albumId, t.artistAlbum, t.length, t.rating, " \
+			"t.disc, t.internalCover, t.icon, h.id FROM tracks_v1 t LEFT JOIN hosts h ON t.host = h.name");
+		// Indexes of version 1 are dropped with their tables
+		schema.exec("DROP TABLE artists_v1");
+		schema.exec("DROP TABLE albums_v1");
+		schema.exec("DROP TABLE tracks_v1");
+	}
+
+	// These indexes match queries which are used to load the library, and are never dropped
+	schema.exec("CREATE INDEX IF NOT EXISTS albumsByArtist ON albums (artistId, id)");
+	schema.exec("CREATE INDEX IF NOT EXISTS albumsByYear ON albums (year, artistId, id)");
+	schema.exec("CREATE INDEX IF NOT EXISTS tracksByAlbum ON tracks (albumId, artistId)");
+	schema.exec("CREATE INDEX IF NOT EXISTS tracksByArtist ON tracks (artistId)");
+
+	// Every change in the library makes its snapshot stale. The version is increased once per committed transaction
+	schema.exec("INSERT OR IGNORE INTO properties (key, value) VALUES ('libraryVersion', 0)");
+
+	// Names are indexed by a full-text table, where the rowid is the id of the record times 4, plus its kind: 0 for artists,
+	// 1 for albums and 2 for tracks. Case and diacritics are folded by the tokenizer, like normalizeField() does
+	if (hasSearchIndex || schema.exec("CREATE VIRTUAL TABLE searchIndex USING fts5(name, " \
+		"tokenize = 'unicode61 remove_diacritics 1', prefix = '2 3')")) {
+		QList<QPair<QString, QString>> indexedColumns = { qMakePair(QString("artists"), QString("name")),
+			qMakePair(QString("albums"), QString("name")), qMakePair(QString("tracks"), QString("title")) };
+		for (int kind = 0; kind < indexedColumns.size(); kind++) {
+			QString table = indexedColumns.at(kind).first;
+			QString column = indexedColumns.at(kind).second;
+			if (!hasSearchIndex) {
+				schema.exec(QString("INSERT INTO searchIndex (rowid, name) SELECT id * 4 + %1, %2 FROM %3").arg(kind).arg(column, table));
+			}
+			schema.exec(QString("CREATE TRIGGER IF NOT EXISTS %1_search_insert AFTER INSERT ON %1 BEGIN " \
+				"INSERT INTO searchIndex (rowid, name) VALUES (new.id * 4 + %3, new.%2); END").arg(table, column).arg(kind));
+			schema.exec(QString("CREATE TRIGGER IF NOT EXISTS %1_search_update AFTER UPDATE OF %2 ON %1 BEGIN " \
+				"UPDATE searchIndex SET name = new.%2 WHERE rowid = old.id * 4 + %3; END").arg(table, column).arg(kind));
+			schema.exec(QString("CREATE TRIGGER IF NOT EXISTS %1_search_delete AFTER DELETE ON %1 BEGIN " \
+				"DELETE FROM searchIndex WHERE rowid = old.id * 4 + %2; END").arg(table).arg(kind));
+		}
+	} else {
+		qDebug() << Q_FUNC_INFO << "FTS5 is not available, library searches will scan tables";
+	}
+
+	schema.exec(QString("PRAGMA user_version = %1").arg(SCHEMA_VERSION));
+	if (commit()) {
+		qDebug() << Q_FUNC_INFO << "schema was updated from version" << version << "to" << SCHEMA_VERSION;
+	} else {
+		qWarning() << Q_FUNC_INFO << this->connection().lastError();
+		rollback();
+	}
+}
+
+/** Returns the id of a remote source, which is inserted if needed. Local records don't have any host. */
+QVariant SqlDatabase::hostId(const QString &host)
+{
+	if (host.isEmpty()) {
+		return QVariant(QVariant::Int);
+	}
+	QSqlQuery &insertHost = this->preparedQuery("INSERT OR IGNORE INTO hosts (name) VALUES (?)");
+	insertHost.addBindValue(host);
+	insertHost.exec();
+	QSqlQuery &selectHost = this->preparedQuery("SELECT id FROM hosts WHERE name = ?");
+	selectHost.addBindValue(host);
+	if (selectHost.exec() && selectHost.next()) {
+		return selectHost.value(0);
+	}
+	return QVariant(QVariant::Int);
+}
+
+/** Returns the id of an artist, which is inserted if needed. */
+uint SqlDatabase::insertArtist(const QString &name, const QString &normalizedName, const QVariant &hostId, const QString &icon)
+{
+	QSqlQuery &insertArtist = this->preparedQuery("INSERT OR IGNORE INTO artists (name, normalizedName, icon, hostId) VALUES (?, ?, ?, ?)");
+	insertArtist.addBindValue(name);
+	insertArtist.addBindValue(normalizedName);
+	insertArtist.addBindValue(icon);
+	insertArtist.addBindValue(hostId);
+	if (insertArtist.exec() && insertArtist.numRowsAffected() > 0) {
+		this->libraryHasChanged();
+	}
+	return this->selectArtistId(normalizedName);
+}
+
+/** Returns the id of an album, which is inserted if needed. Albums are identified by their artist and their normalized name. */
+uint SqlDatabase::insertAlbum(uint artistId, const QString &name, const QString &normalizedName, const QVariant &year,
+							  const QVariant &hostId, const QString &icon)
+{
+	QSqlQuery &insertAlbum = this->preparedQuery("INSERT OR IGNORE INTO albums (name, normalizedName, year, artistId, icon, hostId) " \
+		"VALUES (?, ?, ?, ?, ?, ?)");
+	insertAlbum.addBindValue(name);
+	insertAlbum.addBindValue(normalizedName);
+	insertAlbum.addBindValue(year);
+	insertAlbum.addBindValue(artistId);
+	insertAlbum.addBindValue(icon);
+	insertAlbum.addBindValue(hostId);
+	if (insertAlbum.exec() && insertAlbum.numRowsAffected() > 0) {
+		this->libraryHasChanged();
+	}
+	return this->selectAlbumId(artistId, normalizedName);
+}
+
+/** Returns the id of an artist, or 0 if it's not in the database. */
+uint SqlDatabase::selectArtistId(const QString &normalizedName)
+{
+	QSqlQuery &selectArtist = this->preparedQuery("SELECT id FROM artists WHERE normalizedName = ?");
+	selectArtist.addBindValue(normalizedName);
+	if (selectArtist.exec() && selectArtist.next()) {
+		return selectArtist.value(0).toUInt();
+	}
+	return 0;
+}
+
+/** Returns the id of an album, or 0 if it's not in the database. */
+uint SqlDatabase::selectAlbumId(uint artistId, const QString &normalizedName)
+{
+	QSqlQuery &selectAlbum = this->preparedQuery("SELECT id FROM albums WHERE artistId = ? AND normalizedName = ?");
+	selectAlbum.addBindValue(artistId);
+	selectAlbum.addBindValue(normalizedName);
+	if (selectAlbum.exec() && selectAlbum.next()) {
+		return selectAlbum.value(0).toUInt();
+	}
+	return 0;
+}
+
+/** Returns the connection of the writer thread. */
+QSqlDatabase &SqlDatabase::connection()
+{
+	return _databaseWriter.connection();
+}
+
+/** Runs statements in the writer thread, and waits for their result. */
+template<typename T>
+T SqlDatabase::write(const std::function<T()> &statements)
+{
+	T result = T();
+	_databaseWriter.exec([&result, &statements]() {
+		result = statements();
 	});
+	return result;
+}
+
+/** Opens the connection only once, otherwise prepared statements and pending transactions would be lost. */
+bool SqlDatabase::open()
+{
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([this]() { return this->open(); });
+	}
+	if (this->connection().isOpen()) {
+		return true;
+	}
+	_statements.clear();
+	_transactionDepth = 0;
+	_isLibraryModified = false;
+	// Pragmas are set once per connection, never inside a transaction where some of them are ignored
+	if (!this->connection().open()) {
+		return false;
+	}
+	this->setPragmas();
+	return true;
+}
+
+/** Returns the read-only connection of the current thread, which is opened the first time. */
+QSqlDatabase SqlDatabase::readConnection() const
+{
+	return currentReadConnection(databaseName())->db;
+}
+
+/** Returns a statement prepared only once for the read-only connection of the current thread. */
+QSqlQuery &SqlDatabase::readQuery(const QString &sql)
+{
+	// Pending changes of the writer are only visible from its own connection
+	if (_databaseWriter.isCurrentThread()) {
+		return this->preparedQuery(sql);
+	}
+	ReadConnection *connection = currentReadConnection(databaseName());
+	auto it = connection->statements.find(sql);
+	if (it == connection->statements.end()) {
+		QSqlQuery query(connection->db);
+		query.prepare(sql);
+		it = connection->statements.insert(sql, query);
+	}
+	return it.value();
+}
+
+/** Nested transactions are savepoints, named after their depth. */
+bool SqlDatabase::transaction()
+{
+	if (_transactionDepth == 0) {
+		if (!this->connection().transaction()) {
+			return false;
+		}
+	} else {
+		QSqlQuery savepoint(this->connection());
+		if (!savepoint.exec(QString("SAVEPOINT nested_%1").arg(_transactionDepth))) {
+			return false;
+		}
+	}
+	_transactionDepth++;
+	return true;
+}
+
+bool SqlDatabase::commit()
+{
+	if (_transactionDepth > 1) {
+		QSqlQuery release(this->connection());
+		if (!release.exec(QString("RELEASE nested_%1").arg(_transactionDepth - 1))) {
+			return false;
+		}
+		_transactionDepth--;
+		// An edit made during a scan is saved right away, with tracks which were written before it
+		this->commitScanBatch();
+		return true;
+	}
+	// The version is increased once for the whole transaction, which is rolled back with it if the commit fails
+	if (_isLibraryModified) {
+		this->increaseLibraryVersion();
+	}
+	if (this->connection().commit()) {
+		_transactionDepth = 0;
+		_isLibraryModified = false;
+		return true;
+	}
+	return false;
+}
+
+bool SqlDatabase::rollback()
+{
+	if (_transactionDepth > 1) {
+		_transactionDepth--;
+		QSqlQuery savepoint(this->connection());
+		return savepoint.exec(QString("ROLLBACK TO nested_%1").arg(_transactionDepth)) &&
+			savepoint.exec(QString("RELEASE nested_%1").arg(_transactionDepth));
+	}
+	_transactionDepth = 0;
+	_isLibraryModified = false;
+	return this->connection().rollback();
+}
+
+/** Commits tracks written by running scans, and starts a new transaction for the next ones. Returns false if there's no
+ * scan, or if an edit is in progress: its savepoint can't be committed yet. */
+bool SqlDatabase::commitScanBatch()
+{
+	if (_runningScans == 0 || _transactionDepth != 1) {
+		return false;
+	}
+	return this->commit() && this->transaction();
+}
+
+/** Has to be called when artists, albums or tracks were modified. Snapshots of the library are made stale by increasing its
+ * version, only once when the pending transaction is committed. */
+void SqlDatabase::libraryHasChanged()
+{
+	if (_transactionDepth == 0) {
+		this->increaseLibraryVersion();
+	} else {
+		_isLibraryModified = true;
+	}
+}
+
+/** Makes snapshots of the library stale. */
+void SqlDatabase::increaseLibraryVersion()
+{
+	QSqlQuery &increaseVersion = this->preparedQuery("UPDATE properties SET value = value + 1 WHERE key = 'libraryVersion'");
+	increaseVersion.exec();
+}
+
+/** Returns a statement which is prepared only once for the connection of the writer thread. */
+QSqlQuery &SqlDatabase::preparedQuery(const QString &sql)
+{
+	auto it = _statements.find(sql);
+	if (it == _statements.end()) {
+		_statementCacheMisses++;
+		QSqlQuery query(this->connection());
+		query.prepare(sql);
+		it = _statements.insert(sql, query);
+	} else {
+		_statementCacheHits++;
+		// A previous SELECT may not have been read until the end
+		it.value().finish();
+	}
+	return it.value();
 }
 
 /** Singleton pattern to be able to easily use settings everywhere in the app. */
@@ -112,47 +538,45 @@ MusicSearchEngine * SqlDatabase::musicSearchEngine() const
 	return _musicSearchEngine;
 }
 
+/** Starts or stops to monitor music locations. */
+void SqlDatabase::setWatchForChanges(bool b)
+{
+	QMetaObject::invokeMethod(_fileSystemMonitor, b ? "start" : "stop", Qt::QueuedConnection);
+}
+
 bool SqlDatabase::insertIntoTableArtists(ArtistDAO *artist)
 {
-	QSqlQuery insertArtist(*this);
-	insertArtist.prepare("INSERT OR IGNORE INTO artists (id, name, normalizedName, host) VALUES (?, ?, ?, ?)");
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->insertIntoTableArtists(artist); });
+	}
 	QString artistNorm = this->normalizeField(artist->title());
-	uint artistId = qHash(artistNorm);
-
-	insertArtist.addBindValue(artistId);
-	insertArtist.addBindValue(artist->title());
-	insertArtist.addBindValue(artistNorm);
-	insertArtist.addBindValue(artist->host());
-	insertArtist.exec();
-
-	return lastError().type() == QSqlError::NoError;
+	uint artistId = this->insertArtist(artist->title(), artistNorm, this->hostId(artist->host()), artist->icon());
+	if (artistId != 0) {
+		artist->setId(QString::number(artistId));
+	}
+	return artistId != 0;
 }
 
 bool SqlDatabase::insertIntoTableAlbums(uint artistId, AlbumDAO *album)
 {
-	QSqlQuery insertAlbum(*this);
-	insertAlbum.prepare("INSERT OR IGNORE INTO albums (id, name, normalizedName, year, artistId, host, icon) VALUES (?, ?, ?, ?, ?, ?, ?)");
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->insertIntoTableAlbums(artistId, album); });
+	}
 	QString albumNorm = this->normalizeField(album->title());
-	uint albumId = artistId + qHash(albumNorm, 1);
-
-	insertAlbum.addBindValue(albumId);
-	insertAlbum.addBindValue(album->title());
-	insertAlbum.addBindValue(albumNorm);
-	insertAlbum.addBindValue(album->year());
-	insertAlbum.addBindValue(artistId);
-	insertAlbum.addBindValue(album->host());
-	insertAlbum.addBindValue(album->icon());
-	if (insertAlbum.exec()) {
-		if (ArtistDAO *artist = this->selectArtist(artistId)) {
-			album->setParentNode(artist);
-		}
+	uint albumId = this->insertAlbum(artistId, album->title(), albumNorm, album->year(), this->hostId(album->host()), album->icon());
+	if (albumId == 0) {
+		return false;
 	}
-
-	return lastError().type() == QSqlError::NoError;
+	// The parent isn't looked up here: a DAO doesn't own its parent, which would leak. Callers set it with an artist they own
+	album->setId(QString::number(albumId));
+	return true;
 }
 
 uint SqlDatabase::insertIntoTablePlaylists(const PlaylistDAO &playlist, const std::list<TrackDAO> &tracks, bool isOverwriting)
 {
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<uint>([=]() { return this->insertIntoTablePlaylists(playlist, tracks, isOverwriting); });
+	}
 	static std::uniform_int_distribution<uint> tt;
 	this->transaction();
 	uint id = 0;
@@ -170,7 +594,7 @@ uint SqlDatabase::insertIntoTablePlaylists(const PlaylistDAO &playlist, const st
 			id = playlist.id().toUInt();
 		}
 
-		QSqlQuery insert(*this);
+		QSqlQuery insert(this->connection());
 		insert.prepare("INSERT INTO playlists(id, title, duration, icon, host, checksum) VALUES (?, ?, ?, ?, ?, ?)");
 		insert.addBindValue(id);
 		insert.addBindValue(playlist.title());
@@ -188,18 +612,19 @@ uint SqlDatabase::insertIntoTablePlaylists(const PlaylistDAO &playlist, const st
 
 bool SqlDatabase::insertIntoTablePlaylistTracks(uint playlistId, const std::list<TrackDAO> &tracks, bool isOverwriting)
 {
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->insertIntoTablePlaylistTracks(playlistId, tracks, isOverwriting); });
+	}
 	this->transaction();
 	if (isOverwriting) {
-		QSqlQuery deleteTracks(*this);
-		deleteTracks.prepare("DELETE FROM playlistTracks WHERE playlistId = ?");
+		QSqlQuery &deleteTracks = this->preparedQuery("DELETE FROM playlistTracks WHERE playlistId = ?");
 		deleteTracks.addBindValue(playlistId);
 		deleteTracks.exec();
 	}
+	QSqlQuery &insert = this->preparedQuery("INSERT INTO playlistTracks (trackNumber, title, album, length, artist, rating, year, " \
+		"icon, host, id, url, playlistId) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
 	for (std::list<TrackDAO>::const_iterator it = tracks.cbegin(); it != tracks.cend(); ++it) {
 		TrackDAO track = *it;
-		QSqlQuery insert(*this);
-		insert.prepare("INSERT INTO playlistTracks (trackNumber, title, album, length, artist, rating, year, " \
-					   "icon, host, id, url, playlistId) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
 		insert.addBindValue(track.trackNumber());
 		insert.addBindValue(track.title());
 		insert.addBindValue(track.album());
@@ -215,20 +640,21 @@ bool SqlDatabase::insertIntoTablePlaylistTracks(uint playlistId, const std::list
 		insert.exec();
 	}
 	this->commit();
-	return lastError().type() == QSqlError::NoError;
+	return this->connection().lastError().type() == QSqlError::NoError;
 }
 
 bool SqlDatabase::insertIntoTableTracks(const TrackDAO &track)
 {
-	QSqlQuery insertTrack(*this);
-	insertTrack.prepare("INSERT INTO tracks (uri, trackNumber, title, artistId, albumId, artistAlbum, length, rating, " \
-		"disc, host, icon) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->insertIntoTableTracks(track); });
+	}
+	QSqlQuery &insertTrack = this->preparedQuery("INSERT INTO tracks (uri, trackNumber, title, artistId, albumId, artistAlbum, length, rating, " \
+		"disc, hostId, icon) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
 
 	QString artistAlbum = track.artistAlbum().isEmpty() ? track.artist() : track.artistAlbum();
-	QString artistNorm = this->normalizeField(artistAlbum);
-	QString albumNorm = this->normalizeField(track.album());
-	uint artistId = qHash(artistNorm);
-	uint albumId = artistId + qHash(albumNorm, 1);
+	QVariant hostId = this->hostId(track.host());
+	uint artistId = this->insertArtist(artistAlbum, this->normalizeField(artistAlbum), hostId);
+	uint albumId = this->insertAlbum(artistId, track.album(), this->normalizeField(track.album()), track.year(), hostId);
 
 	insertTrack.addBindValue(track.uri());
 	insertTrack.addBindValue(track.trackNumber());
@@ -239,15 +665,21 @@ bool SqlDatabase::insertIntoTableTracks(const TrackDAO &track)
 	insertTrack.addBindValue(track.length());
 	insertTrack.addBindValue(track.rating());
 	insertTrack.addBindValue(track.disc());
-	insertTrack.addBindValue(track.host());
+	insertTrack.addBindValue(hostId);
 	insertTrack.addBindValue(track.icon());
 	bool b = insertTrack.exec();
+	if (b) {
+		this->libraryHasChanged();
+	}
 	//close();
 	return b;
 }
 
 bool SqlDatabase::insertIntoTableTracks(const std::list<TrackDAO> &tracks)
 {
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->insertIntoTableTracks(tracks); });
+	}
 	bool b = true;
 	for (std::list<TrackDAO>::const_iterator it = tracks.cbegin(); it != tracks.cend(); ++it) {
 		TrackDAO track = *it;
@@ -259,14 +691,17 @@ bool SqlDatabase::insertIntoTableTracks(const std::list<TrackDAO> &tracks)
 
 bool SqlDatabase::removePlaylist(uint playlistId)
 {
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->removePlaylist(playlistId); });
+	}
 	this->transaction();
 	/// XXX: CASCADE not working?
-	QSqlQuery children(*this);
+	QSqlQuery children(this->connection());
 	children.prepare("DELETE FROM playlistTracks WHERE playlistId = :id");
 	children.bindValue(":id", playlistId);
 	children.exec();
 
-	QSqlQuery remove(*this);
+	QSqlQuery remove(this->connection());
 	remove.prepare("DELETE FROM playlists WHERE id = :id");
 	remove.bindValue(":id", playlistId);
 	remove.exec();
@@ -275,14 +710,18 @@ bool SqlDatabase::removePlaylist(uint playlistId)
 
 void SqlDatabase::removePlaylistsFromHost(const QString &host)
 {
+	if (!_databaseWriter.isCurrentThread()) {
+		_databaseWriter.exec([=]() { this->removePlaylistsFromHost(host); });
+		return;
+	}
 	this->transaction();
 
-	QSqlQuery children(*this);
+	QSqlQuery children(this->connection());
 	children.prepare("DELETE FROM playlistTracks WHERE playlistId IN (SELECT id FROM playlists WHERE host LIKE :h)");
 	children.bindValue(":h", host);
 	children.exec();
 
-	QSqlQuery remove(*this);
+	QSqlQuery remove(this->connection());
 	remove.prepare("DELETE FROM playlists WHERE host LIKE :h");
 	remove.bindValue(":h", host);
 	remove.exec();
@@ -293,23 +732,32 @@ void SqlDatabase::removePlaylistsFromHost(const QString &host)
 void SqlDatabase::removeRecordsFromHost(const QString &host)
 {
 	qDebug() << Q_FUNC_INFO << host;
-	this->transaction();
-	QSqlQuery removeTracks(*this);
-	removeTracks.prepare("DELETE FROM tracks WHERE host LIKE :h");
-	removeTracks.bindValue(":h", host);
-	removeTracks.exec();
-
-	QSqlQuery removeAlbums(*this);
-	removeAlbums.prepare("DELETE FROM albums WHERE host LIKE :h");
-	removeAlbums.bindValue(":h", host);
-	removeAlbums.exec();
-
-	QSqlQuery removeArtists(*this);
-	removeArtists.prepare("DELETE FROM artists WHERE host LIKE :h");
-	removeArtists.bindValue(":h", host);
-	removeArtists.exec();
-
-	this->commit();
+	_databaseWriter.exec([=]() {
+		this->transaction();
+		QSqlQuery removeTracks(this->connection());
+		removeTracks.prepare("DELETE FROM tracks WHERE hostId IN (SELECT id FROM hosts WHERE name LIKE :h)");
+		removeTracks.bindValue(":h", host);
+		removeTracks.exec();
+
+		QSqlQuery removeAlbums(this->connection());
+		removeAlbums.prepare("DELETE FROM albums WHERE hostId IN (SELECT id FROM hosts WHERE name LIKE :h)");
+		removeAlbums.bindValue(":h", host);
+		removeAlbums.exec();
+
+		QSqlQuery removeArtists(this->connection());
+		removeArtists.prepare("DELETE FROM artists WHERE hostId IN (SELECT id FROM hosts WHERE name LIKE :h)");
+		removeArtists.bindValue(":h", host);
+		removeArtists.exec();
+
+		QSqlQuery removeHosts(this->connection());
+		removeHosts.prepare("DELETE FROM hosts WHERE name LIKE :h");
+		removeHosts.bindValue(":h", host);
+		removeHosts.exec();
+		_writer.clear();
+		this->libraryHasChanged();
+
+		this->commit();
+	});
 	qDebug() << Q_FUNC_INFO;
 	this->loadFromFileDB();
 }
@@ -318,14 +766,15 @@ Cover* SqlDatabase::selectCoverFromURI(const QString &uri)
 {
 	Cover *c = nullptr;
 
-	QSqlQuery selectCover(*this);
-	selectCover.prepare("SELECT DISTINCT t.internalCover, a.cover, a.id FROM albums a INNER JOIN tracks t ON a.id = t.albumId " \
+	QSqlQuery &selectCover = this->readQuery("SELECT DISTINCT t.internalCover, a.cover, a.id FROM albums a INNER JOIN tracks t ON a.id = t.albumId " \
 		"WHERE t.uri = ?");
 	selectCover.addBindValue(uri);
 	if (selectCover.exec() && selectCover.next()) {
 		bool internalCover = selectCover.record().value(0).toBool();
 		QString coverPath = selectCover.record().value(1).toString();
 		uint albumId = selectCover.record().value(2).toUInt();
+		// Cached statements of read-only connections are released as soon as possible, not to keep an old snapshot
+		selectCover.finish();
 		if (internalCover || !coverPath.isEmpty()) {
 			// If URI has an internal cover, i.e. uri points to a local file
 			if (internalCover) {
@@ -336,10 +785,11 @@ Cover* SqlDatabase::selectCoverFromURI(const QString &uri)
 			}
 		} else {
 			// No direct cover for this file, let's search for the entire album if one track has an inner cover
-			selectCover.prepare("SELECT uri FROM tracks WHERE albumId = ? AND internalCover = 1 LIMIT 1");
-			selectCover.addBindValue(albumId);
-			if (selectCover.exec() && selectCover.next()) {
-				FileHelper fh(selectCover.record().value(0).toString());
+			QSqlQuery &selectInternalCover = this->readQuery("SELECT uri FROM tracks WHERE albumId = ? AND internalCover = 1 LIMIT 1");
+			selectInternalCover.addBindValue(albumId);
+			if (selectInternalCover.exec() && selectInternalCover.next()) {
+				FileHelper fh(selectInternalCover.record().value(0).toString());
+				selectInternalCover.finish();
 				c = fh.extractCover();
 			}
 		}
@@ -350,8 +800,7 @@ Cover* SqlDatabase::selectCoverFromURI(const QString &uri)
 QList<TrackDAO> SqlDatabase::selectPlaylistTracks(uint playlistID)
 {
 	QList<TrackDAO> tracks;
-	QSqlQuery results(*this);
-	results.prepare("SELECT trackNumber, title, album, length, artist, rating, year, icon, id, url FROM playlistTracks WHERE playlistId = ?");
+	QSqlQuery &results = this->readQuery("SELECT trackNumber, title, album, length, artist, rating, year, icon, id, url FROM playlistTracks WHERE playlistId = ?");
 	results.addBindValue(playlistID);
 	if (results.exec()) {
 		while (results.next()) {
@@ -377,8 +826,9 @@ QList<TrackDAO> SqlDatabase::selectPlaylistTracks(uint playlistID)
 PlaylistDAO SqlDatabase::selectPlaylist(uint playlistId)
 {
 	PlaylistDAO playlist;
-	QSqlQuery results = exec("SELECT id, title, checksum, icon, background FROM playlists WHERE id = " + QString::number(playlistId));
-	if (results.next()) {
+	QSqlQuery &results = this->readQuery("SELECT id, title, checksum, icon, background FROM playlists WHERE id = ?");
+	results.addBindValue(playlistId);
+	if (results.exec() && results.next()) {
 		int i = -1;
 		playlist.setId(results.record().value(++i).toString());
 		playlist.setTitle(results.record().value(++i).toString());
@@ -386,13 +836,15 @@ PlaylistDAO SqlDatabase::selectPlaylist(uint playlistId)
 		playlist.setIcon(results.record().value(++i).toString());
 		playlist.setBackground(results.record().value(++i).toString());
 	}
+	results.finish();
 	return playlist;
 }
 
 QList<PlaylistDAO> SqlDatabase::selectPlaylists()
 {
 	QList<PlaylistDAO> playlists;
-	QSqlQuery results = exec("SELECT title, id, icon, background, checksum FROM playlists");
+	QSqlQuery &results = this->readQuery("SELECT title, id, icon, background, checksum FROM playlists");
+	results.exec();
 	while (results.next()) {
 		PlaylistDAO playlist;
 		int i = -1;
@@ -409,8 +861,8 @@ QList<PlaylistDAO> SqlDatabase::selectPlaylists()
 
 AlbumDAO* SqlDatabase::selectAlbumFromArtist(ArtistDAO *artistDAO, uint albumId)
 {
-	QSqlQuery selectAlbum(*this);
-	selectAlbum.prepare("SELECT id, name, normalizedName, year, cover, icon, host FROM albums WHERE id = ?");
+	QSqlQuery &selectAlbum = this->readQuery("SELECT alb.id, alb.name, alb.normalizedName, alb.year, alb.cover, alb.icon, h.name FROM albums alb " \
+		"LEFT JOIN hosts h ON alb.hostId = h.id WHERE alb.id = ?");
 	selectAlbum.addBindValue(albumId);
 	if (selectAlbum.exec() && selectAlbum.next()) {
 		AlbumDAO *album = new AlbumDAO;
@@ -425,6 +877,7 @@ AlbumDAO* SqlDatabase::selectAlbumFromArtist(ArtistDAO *artistDAO, uint albumId)
 		if (artistDAO) {
 			album->setArtist(artistDAO->title());
 		}
+		selectAlbum.finish();
 		return album;
 	} else {
 		return nullptr;
@@ -433,8 +886,8 @@ AlbumDAO* SqlDatabase::selectAlbumFromArtist(ArtistDAO *artistDAO, uint albumId)
 
 ArtistDAO* SqlDatabase::selectArtist(uint artistId)
 {
-	QSqlQuery selectArtist(*this);
-	selectArtist.prepare("SELECT id, name, normalizedName, icon, host FROM artists WHERE id = ?");
+	QSqlQuery &selectArtist = this->readQuery("SELECT art.id, art.name, art.normalizedName, art.icon, h.name FROM artists art " \
+		"LEFT JOIN hosts h ON art.hostId = h.id WHERE art.id = ?");
 	selectArtist.addBindValue(artistId);
 	if (selectArtist.exec() && selectArtist.next()) {
 		ArtistDAO *artist = new ArtistDAO;
@@ -444,20 +897,34 @@ ArtistDAO* SqlDatabase::selectArtist(uint artistId)
 		artist->setTitleNormalized(selectArtist.record().value(++i).toString());
 		artist->setIcon(selectArtist.record().value(++i).toString());
 		artist->setHost(selectArtist.record().value(++i).toString());
+		selectArtist.finish();
 		return artist;
 	} else {
 		return nullptr;
 	}
 }
 
+QVariant SqlDatabase::selectProperty(const QString &key)
+{
+	QSqlQuery &selectValue = this->readQuery("SELECT value FROM properties WHERE key = ?");
+	selectValue.addBindValue(key);
+	if (selectValue.exec() && selectValue.next()) {
+		QVariant value = selectValue.record().value(0);
+		selectValue.finish();
+		return value;
+	} else {
+		return QVariant();
+	}
+}
+
 TrackDAO SqlDatabase::selectTrackByURI(const QString &uri)
 {
 	TrackDAO track;
-	QSqlQuery qTracks(*this);
-	qTracks.prepare("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, " \
-					"rating, disc, internalCover, t.host, t.icon, alb.year " \
+	QSqlQuery &qTracks = this->readQuery("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, " \
+					"rating, disc, internalCover, h.name, t.icon, alb.year " \
 					"FROM tracks t INNER JOIN albums alb ON t.albumId = alb.id " \
 					"INNER JOIN artists art ON t.artistId = art.id " \
+					"LEFT JOIN hosts h ON t.hostId = h.id " \
 					"WHERE uri = ?");
 	qTracks.addBindValue(uri);
 	if (qTracks.exec() && qTracks.next()) {
@@ -477,32 +944,153 @@ TrackDAO SqlDatabase::selectTrackByURI(const QString &uri)
 		track.setIcon(r.value(++j).toString());
 		track.setYear(r.value(++j).toString());
 	}
+	qTracks.finish();
 	return track;
 }
 
+/** Builds a full-text query where every word of text is a prefix, in the same way names are tokenized in the index. */
+QString SqlDatabase::matchExpression(const QString &text)
+{
+	static QRegularExpression separators("[^\\w]+", QRegularExpression::UseUnicodePropertiesOption);
+	QStringList terms;
+	for (QString word : text.split(separators, QString::SkipEmptyParts)) {
+		terms << "\"" + word + "\"*";
+	}
+	return terms.join(' ');
+}
+
+/** Returns at most limit artists, albums or tracks which match text, best matches first. */
+QSqlQuery SqlDatabase::searchLibrary(Miam::ItemType type, const QString &text, int limit)
+{
+	// Columns are: artists (name, id), albums (name, artist, id), tracks (title, artist, uri)
+	QString columns, table, name, joins;
+	int kind;
+	switch (type) {
+	case Miam::IT_Artist:
+		columns = "a.name, a.id";
+		table = "artists a";
+		name = "a.name";
+		kind = 0;
+		break;
+	case Miam::IT_Album:
+		columns = "alb.name, art.name, alb.id";
+		table = "albums alb";
+		name = "alb.name";
+		joins = " INNER JOIN artists art ON alb.artistId = art.id";
+		kind = 1;
+		break;
+	case Miam::IT_Track:
+		columns = "t.title, COALESCE(t.artistAlbum, art.name), t.uri";
+		table = "tracks t";
+		name = "t.title";
+		joins = " INNER JOIN artists art ON t.artistId = art.id";
+		kind = 2;
+		break;
+	default:
+		return QSqlQuery();
+	}
+
+	QString match = matchExpression(text);
+	if (match.isEmpty()) {
+		return QSqlQuery();
+	}
+	QString sql;
+	if (_hasSearchIndex) {
+		// Matches are ranked by the index before records are joined
+		QString id = name.left(name.indexOf('.')) + ".id";
+		sql = "SELECT " + columns + " FROM (SELECT rowid, rank FROM searchIndex WHERE searchIndex MATCH ? AND rowid % 4 = " +
+			QString::number(kind) + " ORDER BY rank LIMIT ?) s INNER JOIN " + table + " ON " + id + " = s.rowid / 4" + joins +
+			" ORDER BY s.rank";
+	} else {
+		sql = "SELECT " + columns + " FROM " + table + joins + " WHERE " + name + " LIKE ? LIMIT ?";
+	}
+	QSqlQuery &search = this->readQuery(sql);
+	search.addBindValue(_hasSearchIndex ? match : "%" + text + "%");
+	search.addBindValue(limit);
+	search.exec();
+	return search;
+}
+
+/** Runs query on the database thread, then callback with its result in the thread of context, if it still exists. */
+template<typename T>
+void SqlDatabase::runAsync(const std::function<T()> &query, QObject *context, const std::function<void(const T &)> &callback)
+{
+	// The watcher is deleted with its context, then the result is dropped
+	QFutureWatcher<T> *watcher = new QFutureWatcher<T>(context);
+	connect(watcher, &QFutureWatcher<T>::finished, context, [watcher, callback]() {
+		callback(watcher->result());
+		watcher->deleteLater();
+	});
+	watcher->setFuture(QtConcurrent::run(&_queryPool, query));
+}
+
+/** Looks for the cover of a track, which may be extracted from the file: the callback owns the cover. */
+void SqlDatabase::selectCoverFromURI(const QString &uri, QObject *context, const std::function<void(Cover* const &)> &callback)
+{
+	this->runAsync<Cover*>([this, uri]() { return this->selectCoverFromURI(uri); }, context, callback);
+}
+
+void SqlDatabase::selectTrackByURI(const QString &uri, QObject *context, const std::function<void(const TrackDAO &)> &callback)
+{
+	this->runAsync<TrackDAO>([this, uri]() { return this->selectTrackByURI(uri); }, context, callback);
+}
+
+/** Tracks are returned in the same order than uris. */
+void SqlDatabase::selectTracksByURI(const QStringList &uris, QObject *context, const std::function<void(const QList<TrackDAO> &)> &callback)
+{
+	this->runAsync<QList<TrackDAO>>([this, uris]() {
+		QList<TrackDAO> tracks;
+		for (QString uri : uris) {
+			tracks.append(this->selectTrackByURI(uri));
+		}
+		return tracks;
+	}, context, callback);
+}
+
 bool SqlDatabase::playlistHasBackgroundImage(uint playlistID)
 {
-	QSqlQuery query = exec("SELECT background FROM playlists WHERE id = " + QString::number(playlistID));
-	query.next();
+	QSqlQuery &query = this->readQuery("SELECT background FROM playlists WHERE id = ?");
+	query.addBindValue(playlistID);
+	if (!query.exec() || !query.next()) {
+		return false;
+	}
 	bool result = !query.record().value(0).toString().isEmpty();
 	qDebug() << Q_FUNC_INFO << query.record().value(0).toString() << result;
+	query.finish();
 	return result;
 }
 
 bool SqlDatabase::updateTablePlaylist(const PlaylistDAO &playlist)
 {
-	QSqlQuery update(*this);
-	update.prepare("UPDATE playlists SET title = ?, checksum = ? WHERE id = ?");
+	if (!_databaseWriter.isCurrentThread()) {
+		return this->write<bool>([=]() { return this->updateTablePlaylist(playlist); });
+	}
+	QSqlQuery &update = this->preparedQuery("UPDATE playlists SET title = ?, checksum = ? WHERE id = ?");
 	update.addBindValue(playlist.title());
 	update.addBindValue(playlist.checksum());
 	update.addBindValue(playlist.id());
 	return update.exec();
 }
 
+void SqlDatabase::updateTableProperties(const QString &key, const QVariant &value)
+{
+	if (!_databaseWriter.isCurrentThread()) {
+		_databaseWriter.post([=]() { this->updateTableProperties(key, value); });
+		return;
+	}
+	QSqlQuery &update = this->preparedQuery("INSERT OR REPLACE INTO properties (key, value) VALUES (?, ?)");
+	update.addBindValue(key);
+	update.addBindValue(value);
+	update.exec();
+}
+
 void SqlDatabase::updateTablePlaylistWithBackgroundImage(uint playlistID, const QString &backgroundImagePath)
 {
-	QSqlQuery update(*this);
-	update.prepare("UPDATE playlists SET background = ? WHERE id = ?");
+	if (!_databaseWriter.isCurrentThread()) {
+		_databaseWriter.exec([=]() { this->updateTablePlaylistWithBackgroundImage(playlistID, backgroundImagePath); });
+		return;
+	}
+	QSqlQuery &update = this->preparedQuery("UPDATE playlists SET background = ? WHERE id = ?");
 	update.addBindValue(backgroundImagePath);
 	update.addBindValue(playlistID);
 	update.exec();
@@ -510,27 +1098,70 @@ void SqlDatabase::updateTablePlaylistWithBackgroundImage(uint playlistID, const
 
 void SqlDatabase::updateTableAlbumWithCoverImage(const QString &coverPath, const QString &album, const QString &artist)
 {
+	if (!_databaseWriter.isCurrentThread()) {
+		_databaseWriter.exec([=]() { this->updateTableAlbumWithCoverImage(coverPath, album, artist); });
+		return;
+	}
 	open();
-	this->setPragmas();
 
-	QSqlQuery update(*this);
-	update.prepare("UPDATE albums SET cover = ? WHERE normalizedName = ? AND artistId = (SELECT id FROM artists WHERE normalizedName = ?)");
+	QSqlQuery &update = this->preparedQuery("UPDATE albums SET cover = ? WHERE normalizedName = ? AND artistId = (SELECT id FROM artists WHERE normalizedName = ?)");
 	update.addBindValue(coverPath);
 	update.addBindValue(this->normalizeField(album));
 	update.addBindValue(this->normalizeField(artist));
-	update.exec();
+	if (update.exec() && update.numRowsAffected() > 0) {
+		this->libraryHasChanged();
+	}
 }
 
 /** Update a list of tracks. If track name has changed, will be removed from Library then added right after. */
 void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &newPaths)
 {
-	// Signals are blocked to prevent saveFileRef method to emit one. Load method will tell connected views to rebuild themselves
-	transaction();
 	Q_ASSERT(oldPaths.size() == newPaths.size());
 
     qDebug() << Q_FUNC_INFO << "oldPaths" << oldPaths;
     qDebug() << Q_FUNC_INFO << "newPaths" << newPaths;
 
+	// Records are written by the writer thread, which may be busy with a scan: the UI doesn't wait for it, and DAOs are sent
+	// back to be converted into nodes
+	_databaseWriter.post([=]() {
+		QList<GenericDAO*> daos;
+		QList<GenericDAO*> extractedDAOs;
+		bool isCleaned = this->updateTrackRecords(oldPaths, newPaths, daos, extractedDAOs);
+		emit trackRecordsUpdated(daos, extractedDAOs, isCleaned);
+	});
+}
+
+/** Converts DAOs extracted by the writer into nodes of the library, then deletes them. */
+void SqlDatabase::applyUpdatedTracks(const QList<GenericDAO*> &daos, const QList<GenericDAO*> &extractedDAOs, bool isCleaned)
+{
+	// Nodes are copied in the store of the library, and sent together. DAOs are only used to build them
+	NodeStore *store = this->storeForUpdates();
+	QVector<LibraryNode> nodes;
+	for (GenericDAO *dao : extractedDAOs) {
+		LibraryNode node = store->append(dao);
+		if (node.isValid()) {
+			nodes.append(node);
+		}
+	}
+	if (!nodes.isEmpty()) {
+		emit nodesExtracted(nodes);
+	}
+	store->clearConvertedDAOs();
+	qDeleteAll(daos);
+
+	if (isCleaned) {
+		// Finally, tell views they need to update themselves
+		emit aboutToCleanView();
+	}
+}
+
+/** Writes updated tracks. DAOs to convert into nodes are appended in display order, and all new DAOs are owned by the caller. */
+bool SqlDatabase::updateTrackRecords(const QStringList &oldPaths, const QStringList &newPaths, QList<GenericDAO*> &daos,
+									 QList<GenericDAO*> &extractedDAOs)
+{
+	// Signals are blocked to prevent saveFileRef method to emit one. Load method will tell connected views to rebuild themselves
+	transaction();
+
 	QList<FileHelper*> olds;
 	QList<ArtistDAO*> artists;
 	QList<AlbumDAO*> albums;
@@ -545,7 +1176,7 @@ void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &n
 				continue;
 			}
 
-			QSqlQuery selectArtist(*this);
+			QSqlQuery selectArtist(this->connection());
 			selectArtist.prepare("SELECT artistId, albumId FROM tracks WHERE uri = ?");
 			selectArtist.addBindValue(oldPath);
 			uint oldArtistId = 0;
@@ -555,36 +1186,36 @@ void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &n
 				oldAlbumId = selectArtist.record().value(1).toUInt();
 			}
 
-			QSqlQuery updateTrack(*this);
+			QSqlQuery updateTrack(this->connection());
 			updateTrack.prepare("UPDATE tracks SET trackNumber = ?, title = ?, artistId = ?, albumId = ?, artistAlbum = ?, rating = ?, "\
 								"disc = ?, internalCover = ? WHERE uri = ?");
 
 			QString artistAlbum = fh->artistAlbum().isEmpty() ? fh->artist() : fh->artistAlbum();
 			QString artistNorm = this->normalizeField(artistAlbum);
 			QString albumNorm = this->normalizeField(fh->album());
-			uint artistId = qHash(artistNorm);
-			uint albumId = artistId + qHash(albumNorm, 1);
+			uint artistId = this->selectArtistId(artistNorm);
 
 			// Check if Artist has changed (can change how tracks are displayed in the library)
-			if (oldArtistId != artistId) {
+			if (artistId == 0 || oldArtistId != artistId) {
 				ArtistDAO *artistDAO = new ArtistDAO;
-				artistDAO->setId(QString::number(artistId));
+				daos << artistDAO;
 				artistDAO->setTitle(artistAlbum);
 				artistDAO->setTitleNormalized(artistNorm);
 				if (this->insertIntoTableArtists(artistDAO)) {
+					artistId = artistDAO->id().toUInt();
 					artists << artistDAO;
-					emit nodeExtracted(artistDAO);
-				} else {
-					delete artistDAO;
+					extractedDAOs << artistDAO;
 				}
 			}
 
 			// Same thing for Album
-			if (oldAlbumId == albumId) {
-				QSqlQuery queryAlbum("SELECT cover FROM albums WHERE id = ?", *this);
+			uint albumId = this->selectAlbumId(artistId, albumNorm);
+			if (albumId != 0 && oldAlbumId == albumId) {
+				QSqlQuery queryAlbum("SELECT cover FROM albums WHERE id = ?", this->connection());
 				queryAlbum.addBindValue(oldAlbumId);
 				if (queryAlbum.exec() && queryAlbum.next()) {
 					AlbumDAO *albumDAO = new AlbumDAO;
+					daos << albumDAO;
 					albumDAO->setId(QString::number(oldAlbumId));
 					albumDAO->setTitle(fh->album());
 					albumDAO->setYear(fh->year());
@@ -595,23 +1226,18 @@ void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &n
 					}
 					albums << albumDAO;
 				}
-			} else {
-				QSqlQuery queryAlbum("SELECT * FROM albums WHERE id = ?", *this);
-				queryAlbum.addBindValue(albumId);
-				if (!(queryAlbum.exec() && queryAlbum.next())) {
-					AlbumDAO *albumDAO = new AlbumDAO;
-					albumDAO->setId(QString::number(albumId));
-					albumDAO->setTitle(fh->album());
-					albumDAO->setYear(fh->year());
-					if (this->insertIntoTableAlbums(artistId, albumDAO)) {
-						albums << albumDAO;
-						if (fh->hasCover()) {
-							albumDAO->setCover(oldPath);
-						} else {
-							// how to tie cover on the filesystem?
-						}
+			} else if (albumId == 0) {
+				AlbumDAO *albumDAO = new AlbumDAO;
+				daos << albumDAO;
+				albumDAO->setTitle(fh->album());
+				albumDAO->setYear(fh->year());
+				if (this->insertIntoTableAlbums(artistId, albumDAO)) {
+					albumId = albumDAO->id().toUInt();
+					albums << albumDAO;
+					if (fh->hasCover()) {
+						albumDAO->setCover(oldPath);
 					} else {
-						delete albumDAO;
+						// how to tie cover on the filesystem?
 					}
 				}
 			}
@@ -633,12 +1259,16 @@ void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &n
 				if (savedAlbum->id().toUInt() == albumId) {
 					albumDAO = savedAlbum;
 					ArtistDAO *art = this->selectArtist(artistId);
+					if (art) {
+						daos << art;
+					}
 					albumDAO->setParentNode(art);
 					break;
 				}
 			}
 			if (updateTrack.exec()) {
 				TrackDAO *trackDAO = new TrackDAO;
+				daos << trackDAO;
 				trackDAO->setUri(oldPath);
 				trackDAO->setTrackNumber(fh->trackNumber());
 				trackDAO->setTitle(fh->title());
@@ -654,33 +1284,39 @@ void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &n
 				}
 				if (artist) {
 					AlbumDAO *album = this->selectAlbumFromArtist(artist, albumId);
-					album->setParentNode(artist);
-					emit nodeExtracted(album);
-					trackDAO->setParentNode(album);
+					if (album) {
+						daos << album;
+						album->setParentNode(artist);
+						extractedDAOs << album;
+						trackDAO->setParentNode(album);
+					}
 				}
                 qDebug() << Q_FUNC_INFO << "about to extract track" << trackDAO->artist() << trackDAO->artistAlbum() << trackDAO->album() << trackDAO->title();
-				emit nodeExtracted(trackDAO);
+				extractedDAOs << trackDAO;
 			}
 			olds.append(fh);
 		} else {
 			QString newPath = newPaths.at(i);
-			QSqlQuery hasTrack("SELECT COUNT(*) FROM tracks WHERE uri = ?", *this);
+			QSqlQuery hasTrack("SELECT COUNT(*) FROM tracks WHERE uri = ?", this->connection());
 			hasTrack.addBindValue(oldPath);
 			if (hasTrack.exec() && hasTrack.next() && hasTrack.record().value(0).toInt() != 0) {
-				QSqlQuery removeTrack("DELETE FROM tracks WHERE uri = ?", *this);
+				QSqlQuery removeTrack("DELETE FROM tracks WHERE uri = ?", this->connection());
 				removeTrack.addBindValue(oldPath);
 				qDebug() << Q_FUNC_INFO << "deleting tracks";
 				if (removeTrack.exec()) {
-					this->saveFileRef(newPath);
+					TrackMetadata track = TagReader::readTags(newPath);
+					if (track.isValid && track.length.toInt() <= 0) {
+						// A single file is read entirely right away, instead of after other batches like during scans
+						track = TagReader::readTags(newPath, FileHelper::DefaultIO, FileHelper::ReadAll);
+					}
+					_writer.write(track);
 				}
 			}
 		}
 	}
 
-	if (this->cleanNodesWithoutTracks()) {
-		// Finally, tell views they need to update themselves
-		emit aboutToCleanView();
-	}
+	bool isCleaned = this->cleanNodesWithoutTracks();
+	this->libraryHasChanged();
 	commit();
 
 	while (!olds.isEmpty()) {
@@ -689,29 +1325,79 @@ void SqlDatabase::updateTracks(const QStringList &oldPaths, const QStringList &n
 			delete fh;
 		}
 	}
+	return isCleaned;
+}
+
+/** Returns the store where edited nodes are appended: the store of the library, unless the loader is still filling it. */
+NodeStore* SqlDatabase::storeForUpdates()
+{
+	if (_nodeStore && !_loader) {
+		return _nodeStore.data();
+	}
+	// Only the loader appends nodes to its store from its thread: a single store is kept for updates until the next load
+	if (!_updatedNodeStore) {
+		_updatedNodeStore.reset(new NodeStore);
+	}
+	return _updatedNodeStore.data();
+}
+
+/** The first scan opens the transaction which is shared by all scans started before the last one has ended. */
+void SqlDatabase::beginScan()
+{
+	if (_runningScans++ == 0) {
+		// Until this flag is removed, the scan will be resumed at next startup
+		this->updateTableProperties("scanInterrupted", true);
+		this->transaction();
+	}
+}
+
+/** Commits tracks of the scan which has ended. The transaction is kept as long as other scans are running. */
+void SqlDatabase::endScan(bool isCancelled)
+{
+	if (_runningScans > 1) {
+		this->commitScanBatch();
+		_runningScans--;
+		return;
+	}
+	_runningScans = 0;
+	// A cancelled scan will be resumed at next startup
+	if (!isCancelled) {
+		QSqlQuery &removeCheckpoint = this->preparedQuery("DELETE FROM properties WHERE key IN ('scanInterrupted', 'scanCheckpoint')");
+		removeCheckpoint.exec();
+	}
+	this->commit();
 }
 
 /** When one has manually updated tracks with TagEditor, some nodes might in unstable state. */
 bool SqlDatabase::cleanNodesWithoutTracks()
 {
-	QSqlQuery albumsWithoutTracks("SELECT DISTINCT a.id FROM albums a WHERE a.id NOT IN (SELECT DISTINCT t.albumId FROM tracks t)", *this);
+	// Pending tracks have to be inserted first, and deleted nodes must not be remembered by the writer
+	_writer.clear();
+
+	bool isModified = false;
+	QSqlQuery albumsWithoutTracks("SELECT DISTINCT a.id FROM albums a WHERE a.id NOT IN (SELECT DISTINCT t.albumId FROM tracks t)", this->connection());
 	if (albumsWithoutTracks.exec()) {
+		QSqlQuery &deleteAlbum = this->preparedQuery("DELETE FROM albums WHERE id = ?");
 		while (albumsWithoutTracks.next()) {
-			QSqlQuery deleteAlbum("DELETE FROM albums WHERE id = ?", *this);
 			deleteAlbum.addBindValue(albumsWithoutTracks.record().value(0).toUInt());
 			deleteAlbum.exec();
+			isModified = true;
 		}
 	}
 
-	QSqlQuery artistsWithoutTracks("SELECT DISTINCT a.id FROM artists a WHERE a.id NOT IN (SELECT DISTINCT t.artistId FROM tracks t)", *this);
+	QSqlQuery artistsWithoutTracks("SELECT DISTINCT a.id FROM artists a WHERE a.id NOT IN (SELECT DISTINCT t.artistId FROM tracks t)", this->connection());
 	if (artistsWithoutTracks.exec()) {
+		QSqlQuery &deleteArtist = this->preparedQuery("DELETE FROM artists WHERE id = ?");
 		while (artistsWithoutTracks.next()) {
-			QSqlQuery deleteArtist("DELETE FROM artists WHERE id = ?", *this);
 			deleteArtist.addBindValue(artistsWithoutTracks.record().value(0).toUInt());
 			deleteArtist.exec();
+			isModified = true;
 		}
 	}
-	return lastError().type() == QSqlError::NoError;
+	if (isModified) {
+		this->libraryHasChanged();
+	}
+	return this->connection().lastError().type() == QSqlError::NoError;
 }
 
 /** Read all tracks entries in the database and send them to connected views. */
@@ -721,231 +1407,89 @@ void SqlDatabase::loadFromFileDB(bool sendResetSignal)
 		emit aboutToLoad();
 	}
 
-	// Lambda function to reduce duplicate code which is relevant only in this method
-	auto loadTracks = [this] (QSqlQuery& qTracks, AlbumDAO *albumDAO, const QString &year) -> void {
-		bool internalCover = false;
-		while (qTracks.next()) {
-			QSqlRecord r = qTracks.record();
-			TrackDAO *trackDAO = new TrackDAO;
-			QString uri = r.value(0).toString();
-			trackDAO->setUri(uri);
-			trackDAO->setTrackNumber(r.value(1).toString());
-			trackDAO->setTitle(r.value(2).toString());
-			trackDAO->setArtist(r.value(3).toString());
-			trackDAO->setAlbum(r.value(4).toString());
-			trackDAO->setArtistAlbum(r.value(5).toString());
-			trackDAO->setLength(r.value(6).toString());
-			trackDAO->setRating(r.value(7).toInt());
-			trackDAO->setDisc(r.value(8).toString());
-			if (!internalCover && r.value(9).toBool()) {
-				albumDAO->setCover(uri);
-				internalCover = true;
-			}
-			trackDAO->setHost(r.value(10).toString());
-			trackDAO->setIcon(r.value(11).toString());
-			trackDAO->setParentNode(albumDAO);
-			trackDAO->setYear(year);
-			emit nodeExtracted(trackDAO);
-		}
-		if (internalCover) {
-			// Cover path is now pointing to the first track of this album, because it need to be extracted at runtime
-			emit aboutToUpdateNode(albumDAO);
-		}
-	};
-
-	auto s = SettingsPrivate::instance();
-	switch (s->insertPolicy()) {
-	case SettingsPrivate::IP_Artists: {
-		QStringList filters;
-		if (s->isLibraryFilteredByArticles() && !s->libraryFilteredByArticles().isEmpty()) {
-			filters = s->libraryFilteredByArticles();
-		}
+	// Nodes which were not inserted yet belong to an outdated library
+	if (_loader) {
+		_loader->cancel();
+	}
+	_firstLoadedNode = 0;
+	_lastLoadedNode = 0;
+
+	// An outdated loader is deleted only when all its pending batches have been received, and keeps its store until then
+	_updatedNodeStore.clear();
+	_nodeStore.reset(new NodeStore);
+	_loader = new LibraryLoader(databaseName(), _nodeStore, this);
+	connect(_loader, &LibraryLoader::nodesLoaded, this, &SqlDatabase::appendLoadedNodes);
+	connect(_loader, &LibraryLoader::finished, this, &SqlDatabase::loaderHasFinished);
+	QThreadPool::globalInstance()->start(_loader);
+}
 
-		// Level 1: Artists
-		QSqlQuery qArtists("SELECT id, name, normalizedName FROM artists", *this);
-		if (qArtists.exec()) {
-			while (qArtists.next()) {
-				QSqlRecord record = qArtists.record();
-				ArtistDAO *artistDAO = new ArtistDAO;
-				uint artistId = record.value(0).toUInt();
-				QString artist = record.value(1).toString();
-				artistDAO->setId(record.value(0).toString());
-				artistDAO->setTitle(artist);
-				if (filters.isEmpty()) {
-					artistDAO->setTitleNormalized(record.value(2).toString());
-				} else {
-					for (QString filter : filters) {
-						if (artist.startsWith(filter + " ", Qt::CaseInsensitive)) {
-							artist = artist.mid(filter.length() + 1);
-							artistDAO->setCustomData(artist + ", " + filter);
-							break;
-						}
-					}
-					artistDAO->setTitleNormalized(this->normalizeField(artist));
-				}
-				emit nodeExtracted(artistDAO);
-
-				// Level 2: Albums
-				QSqlQuery qAlbums(*this);
-				qAlbums.prepare("SELECT name, normalizedName, year, cover, host, icon, id FROM albums WHERE artistId = ?");
-				qAlbums.addBindValue(artistId);
-				if (qAlbums.exec()) {
-					while (qAlbums.next()) {
-						QSqlRecord r = qAlbums.record();
-						AlbumDAO *albumDAO = new AlbumDAO;
-						QString album = r.value(0).toString();
-						albumDAO->setTitle(album);
-						albumDAO->setTitleNormalized(r.value(1).toString());
-						QString year = r.value(2).toString();
-						albumDAO->setYear(year);
-						albumDAO->setCover(r.value(3).toString());
-						albumDAO->setHost(r.value(4).toString());
-						albumDAO->setIcon(r.value(5).toString());
-						uint albumId = r.value(6).toUInt();
-						albumDAO->setParentNode(artistDAO);
-						albumDAO->setArtist(artistDAO->title());
-						albumDAO->setId(QString::number(albumId));
-						emit nodeExtracted(albumDAO);
-						//_cache.insert(albumId, albumDAO);
-
-						// Level 3: Tracks
-						QSqlQuery qTracks(*this);
-						qTracks.prepare("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, rating, disc, internalCover, " \
-										"t.host, t.icon FROM tracks t INNER JOIN albums alb ON t.albumId = alb.id " \
-										"INNER JOIN artists art ON t.artistId = art.id " \
-										"WHERE t.artistId = ? AND t.albumId = ?");
-						qTracks.addBindValue(artistId);
-						qTracks.addBindValue(albumId);
-						if (qTracks.exec()) {
-							loadTracks(qTracks, albumDAO, year);
-						}
-					}
-				}
-			}
-		}
-		break;
+/** Keeps nodes sent by the current loader, and drops outdated ones. */
+void SqlDatabase::appendLoadedNodes(quint32 first, quint32 count)
+{
+	if (sender() != _loader) {
+		return;
 	}
-	case SettingsPrivate::IP_Albums: {
-		// Level 1: Albums
-		QSqlQuery qAlbums("SELECT name, normalizedName, year, cover, host, icon, id FROM albums", *this);
-		if (qAlbums.exec()) {
-			while (qAlbums.next()) {
-				QSqlRecord r = qAlbums.record();
-				AlbumDAO *albumDAO = new AlbumDAO;
-				QString album = r.value(0).toString();
-				albumDAO->setTitle(album);
-				albumDAO->setTitleNormalized(r.value(1).toString());
-				QString year = r.value(2).toString();
-				albumDAO->setYear(year);
-				albumDAO->setCover(r.value(3).toString());
-				albumDAO->setHost(r.value(4).toString());
-				albumDAO->setIcon(r.value(5).toString());
-				uint albumId = r.value(6).toUInt();
-				emit nodeExtracted(albumDAO);
-
-				// Level 2: Tracks
-				QSqlQuery qTracks(*this);
-				qTracks.prepare("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, rating, disc, internalCover, " \
-								"t.host, t.icon FROM tracks t INNER JOIN albums alb ON t.albumId = alb.id " \
-								"INNER JOIN artists art ON t.artistId = art.id " \
-								"WHERE t.albumId = ?");
-				qTracks.addBindValue(albumId);
-				if (qTracks.exec()) {
-					loadTracks(qTracks, albumDAO, year);
-				}
-			}
-		}
-		break;
+	// Ranges are contiguous
+	_lastLoadedNode = first + count;
+	if (!_loadTimer->isActive()) {
+		_loadTimer->start(0);
+		// The first screen of the library is displayed immediately
+		this->insertLoadedNodes();
 	}
-	case SettingsPrivate::IP_ArtistsAlbums: {
-		// Level 1: Artist - Album
-		QSqlQuery qAlbums("SELECT art.name || ' – ' || alb.name, art.normalizedName || alb.normalizedName, alb.year, alb.cover, alb.host, alb.icon, alb.id " \
-						  "FROM albums alb " \
-						  "INNER JOIN artists art ON alb.artistId = art.id", *this);
-		if (qAlbums.exec()) {
-			while (qAlbums.next()) {
-				QSqlRecord r = qAlbums.record();
-				AlbumDAO *albumDAO = new AlbumDAO;
-				QString album = r.value(0).toString();
-				albumDAO->setTitle(album);
-				albumDAO->setTitleNormalized(r.value(1).toString());
-				QString year = r.value(2).toString();
-				albumDAO->setYear(year);
-				albumDAO->setCover(r.value(3).toString());
-				albumDAO->setHost(r.value(4).toString());
-				albumDAO->setIcon(r.value(5).toString());
-				uint albumId = r.value(6).toUInt();
-				emit nodeExtracted(albumDAO);
-
-				// Level 2: Tracks
-				QSqlQuery qTracks(*this);
-				qTracks.prepare("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, rating, disc, internalCover, " \
-								"t.host, t.icon FROM tracks t INNER JOIN albums alb ON t.albumId = alb.id " \
-								"INNER JOIN artists art ON t.artistId = art.id " \
-								"WHERE t.albumId = ?");
-				qTracks.addBindValue(albumId);
-				if (qTracks.exec()) {
-					loadTracks(qTracks, albumDAO, year);
-				}
-			}
-		}
-		break;
+}
+
+/** Sends a chunk of loaded nodes to the views. */
+void SqlDatabase::insertLoadedNodes()
+{
+	quint32 last = qMin(_lastLoadedNode, _firstLoadedNode + _loadChunkSize);
+	QVector<LibraryNode> nodes;
+	nodes.reserve(last - _firstLoadedNode);
+	for (; _firstLoadedNode < last; _firstLoadedNode++) {
+		nodes.append(LibraryNode(_nodeStore.data(), _firstLoadedNode));
 	}
-	case SettingsPrivate::IP_Years: {
-		// Level 1: Years
-		QSqlQuery qYears("SELECT DISTINCT year FROM albums ORDER BY year", *this);
-		if (qYears.exec()) {
-			while (qYears.next()) {
-				QSqlRecord r = qYears.record();
-				YearDAO *yearDAO = new YearDAO;
-				QVariant vYear = r.value(0);
-				yearDAO->setTitle(vYear.toString());
-				yearDAO->setTitleNormalized(vYear.toString());
-				emit nodeExtracted(yearDAO);
-
-				// Level 2: Artist - Album
-				QSqlQuery qAlbums(*this);
-				qAlbums.prepare("SELECT art.name || ' – ' || alb.name, art.normalizedName || alb.normalizedName, alb.year, alb.cover, alb.host, alb.icon, art.id, alb.id " \
-								"FROM albums alb INNER JOIN artists art ON alb.artistId = art.id " \
-								"WHERE alb.year = ?");
-				qAlbums.addBindValue(vYear.toInt());
-				if (qAlbums.exec()) {
-					while (qAlbums.next()) {
-						QSqlRecord r = qAlbums.record();
-						AlbumDAO *albumDAO = new AlbumDAO;
-						QString album = r.value(0).toString();
-						albumDAO->setTitle(album);
-						albumDAO->setTitleNormalized(r.value(1).toString());
-						QString year = r.value(2).toString();
-						albumDAO->setYear(year);
-						albumDAO->setCover(r.value(3).toString());
-						albumDAO->setHost(r.value(4).toString());
-						albumDAO->setIcon(r.value(5).toString());
-						uint artistId = r.value(6).toUInt();
-						uint albumId = r.value(7).toUInt();
-						albumDAO->setParentNode(yearDAO);
-						emit nodeExtracted(albumDAO);
-
-						// Level 3: Tracks
-						QSqlQuery qTracks(*this);
-						qTracks.prepare("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, rating, disc, internalCover, " \
-										"t.host, t.icon FROM tracks t INNER JOIN albums alb ON t.albumId = alb.id " \
-										"INNER JOIN artists art ON t.artistId = art.id " \
-										"WHERE t.artistId = ? AND t.albumId = ?");
-						qTracks.addBindValue(artistId);
-						qTracks.addBindValue(albumId);
-						if (qTracks.exec()) {
-							loadTracks(qTracks, albumDAO, year);
-						}
-					}
-				}
-			}
+
+	QElapsedTimer elapsed;
+	elapsed.start();
+	emit nodesExtracted(nodes);
+	qint64 ms = elapsed.elapsed();
+	if (ms > LOAD_CHUNK_MS) {
+		_loadChunkSize = qMax(64, _loadChunkSize / 2);
+	} else if (ms < LOAD_CHUNK_MS / 2) {
+		_loadChunkSize = qMin(16384, _loadChunkSize * 2);
+	}
+
+	if (_firstLoadedNode == _lastLoadedNode) {
+		_loadTimer->stop();
+		if (!_loader) {
+			emit loaded();
 		}
-		break;
 	}
+}
+
+void SqlDatabase::loaderHasFinished()
+{
+	LibraryLoader *loader = static_cast<LibraryLoader*>(sender());
+	loader->deleteLater();
+	if (loader == _loader) {
+		_loader = nullptr;
+
+		// Strings of the previous library are not used by views anymore
+		StringPool::instance()->squeeze();
+
+		if (_firstLoadedNode == _lastLoadedNode) {
+			emit loaded();
+		}
 	}
+}
 
-	emit loaded();
+/** Loads the library again when the writer has committed a scan, and resyncs remote sources. */
+void SqlDatabase::scanHasEnded()
+{
+	qDebug() << Q_FUNC_INFO;
+	this->loadFromFileDB(true);
+
+	// Resync remote players and remote databases
+	emit aboutToResyncRemoteSources();
 }
 
 /** Delete and rescan local tracks. */
@@ -953,46 +1497,89 @@ void SqlDatabase::rebuild()
 {
 	emit aboutToLoad();
 
-	open();
-	this->setPragmas();
+	// Tracks of the scan are queued after this write, the UI doesn't wait for it
+	_databaseWriter.post([this]() {
+		open();
 
-	QSqlQuery cleanDb(*this);
-	//cleanDb.exec("DELETE FROM tracks WHERE uri LIKE 'file:%'");
-	//cleanDb.exec("DELETE FROM albums WHERE id NOT IN (SELECT DISTINCT albumId FROM tracks)");
-	//cleanDb.exec("DELETE FROM artists WHERE id NOT IN (SELECT DISTINCT artistId FROM tracks)");
-	cleanDb.exec("DELETE FROM tracks");
-	cleanDb.exec("DELETE FROM albums");
-	cleanDb.exec("DELETE FROM artists");
-	cleanDb.exec("DROP INDEX indexArtist");
-	cleanDb.exec("DROP INDEX indexAlbum");
-	cleanDb.exec("DROP INDEX indexPath");
-	cleanDb.exec("DROP INDEX indexArtistId");
-	cleanDb.exec("DROP INDEX indexAlbumId");
-	transaction();
+		_writer.clear();
+		QSqlQuery cleanDb(this->connection());
+		//cleanDb.exec("DELETE FROM tracks WHERE uri LIKE 'file:%'");
+		//cleanDb.exec("DELETE FROM albums WHERE id NOT IN (SELECT DISTINCT albumId FROM tracks)");
+		//cleanDb.exec("DELETE FROM artists WHERE id NOT IN (SELECT DISTINCT artistId FROM tracks)");
+		cleanDb.exec("DELETE FROM tracks");
+		cleanDb.exec("DELETE FROM albums");
+		cleanDb.exec("DELETE FROM artists");
+		cleanDb.exec("DELETE FROM hosts");
+		cleanDb.exec("DELETE FROM fileSignatures");
+		this->libraryHasChanged();
+		this->beginScan();
+
+		// Foreach file, insert tuple
+		_musicSearchEngine->setEstimatedEntryCount(this->selectProperty("entryCount").toInt());
+		QMetaObject::invokeMethod(_musicSearchEngine, "doSearch", Qt::QueuedConnection);
+	});
+}
 
-	// Foreach file, insert tuple
-	_musicSearchEngine->moveToThread(&_workerThread);
-	_musicSearchEngine->doSearch();
+/** Compares the library with the FileSystem, and reads only files which were added or modified since the last scan. */
+void SqlDatabase::rescan()
+{
+	// Signatures are read by the writer, which sees tracks of a scan which is still running
+	_databaseWriter.post([this]() {
+		open();
+
+		FileSignatures knownFiles;
+		QSqlQuery selectSignatures(this->connection());
+		selectSignatures.setForwardOnly(true);
+		if (selectSignatures.exec("SELECT path, size, lastModified, inode FROM fileSignatures")) {
+			while (selectSignatures.next()) {
+				FileSignature signature;
+				signature.absFilePath = selectSignatures.value(0).toString();
+				signature.size = selectSignatures.value(1).toLongLong();
+				signature.lastModified = selectSignatures.value(2).toLongLong();
+				signature.inode = selectSignatures.value(3).toULongLong();
+				knownFiles.insert(signature.absFilePath, signature);
+			}
+		}
+
+		// Without any signature (first launch, or database built by a previous version), nothing can be compared. Views
+		// are reset from the UI thread
+		if (knownFiles.isEmpty()) {
+			QMetaObject::invokeMethod(this, "rebuild", Qt::QueuedConnection);
+			return;
+		}
+
+		this->beginScan();
+		_musicSearchEngine->setEstimatedEntryCount(this->selectProperty("entryCount").toInt());
+		QMetaObject::invokeMethod(_musicSearchEngine, "doRescan", Qt::QueuedConnection, Q_ARG(FileSignatures, knownFiles));
+	});
 }
 
 void SqlDatabase::rebuild(const QStringList &oldLocations, const QStringList &newLocations)
 {
-	open();
-	this->setPragmas();
+	// Remove old locations from database cache. The library is loaded again afterwards: the UI has to wait
+	_databaseWriter.exec([=]() {
+		open();
 
-	// Remove old locations from database cache
-	transaction();
-	for (QString oldLocation : oldLocations) {
-		if (newLocations.isEmpty() || !newLocations.contains(oldLocation)) {
-			QSqlQuery syncDb(*this);
-			syncDb.prepare("DELETE FROM tracks WHERE uri LIKE :path ");
-			syncDb.bindValue(":path", "file://" + QDir::fromNativeSeparators(oldLocation) + "%");
-			syncDb.exec();
+		transaction();
+		QStringList removedLocations;
+		for (QString oldLocation : oldLocations) {
+			if (newLocations.isEmpty() || !newLocations.contains(oldLocation)) {
+				removedLocations << QDir::fromNativeSeparators(oldLocation);
+			}
+		}
+		if (!removedLocations.isEmpty()) {
+			this->removeFileRefs(removedLocations);
+			QSqlQuery syncDb(this->connection());
 			syncDb.exec("DELETE FROM albums WHERE id NOT IN (SELECT DISTINCT albumId FROM tracks)");
 			syncDb.exec("DELETE FROM artists WHERE id NOT IN (SELECT DISTINCT artistId FROM tracks)");
 		}
+		commit();
+	});
+
+	// Watch new locations instead of old ones
+	if (SettingsPrivate::instance()->isFileSystemMonitored()) {
+		this->setWatchForChanges(true);
 	}
-	commit();
 
 	// Restart the worker thread on new locations
 	QStringList locationsToAdd;
@@ -1005,209 +1592,141 @@ void SqlDatabase::rebuild(const QStringList &oldLocations, const QStringList &ne
 	if (locationsToAdd.isEmpty()) {
 		this->load();
 	} else {
-		_musicSearchEngine->moveToThread(&_workerThread);
-		_musicSearchEngine->doSearch(locationsToAdd);
+		_databaseWriter.post([=]() {
+			this->beginScan();
+			QMetaObject::invokeMethod(_musicSearchEngine, "doSearch", Qt::QueuedConnection, Q_ARG(QStringList, locationsToAdd));
+		});
 	}
 }
 
 /** Load an existing database file or recreate it, if not found. */
 void SqlDatabase::load()
 {
-	if (open() && tables().contains("tracks")) {
+	// The schema was created by the writer when it opened the database
+	if (this->readConnection().tables().contains("tracks")) {
 		this->loadFromFileDB();
 	} else {
 		this->rebuild();
 	}
 }
 
-/** Reads an external picture which is close to multimedia files (same folder). */
-void SqlDatabase::saveCoverRef(const QString &coverPath, const QString &track)
+/** Attach covers collected during a scan to their albums. */
+void SqlDatabase::savePendingCoverRefs()
 {
-	FileHelper fh(track);
-	QString artistAlbum = fh.artistAlbum().isEmpty() ? fh.artist() : fh.artistAlbum();
-	QString artistNorm = this->normalizeField(artistAlbum);
-	QString albumNorm = this->normalizeField(fh.album());
-
-	uint artistId = qHash(artistNorm);
-	uint albumId = artistId + qHash(albumNorm, 1);
-
-	QSqlQuery updateCoverPath("UPDATE albums SET cover = ? WHERE id = ? AND artistId = ?", *this);
-	updateCoverPath.addBindValue(coverPath);
-	updateCoverPath.addBindValue(albumId);
-	updateCoverPath.addBindValue(artistId);
-	bool b = updateCoverPath.exec();
-	if (b) {
-		QSqlQuery selectAlbum("SELECT id, name, normalizedName, year, cover, artistId FROM albums WHERE id = ? AND artistId = ?", *this);
-		selectAlbum.addBindValue(albumId);
-		selectAlbum.addBindValue(artistId);
+	QSqlQuery &selectAlbum = this->preparedQuery("SELECT albumId FROM tracks WHERE uri = ?");
+	QSqlQuery &updateCoverPath = this->preparedQuery("UPDATE albums SET cover = ? WHERE id = ?");
+	QHashIterator<QString, QString> it(_pendingCovers);
+	while (it.hasNext()) {
+		it.next();
+		selectAlbum.addBindValue("file://" + it.key());
 		if (selectAlbum.exec() && selectAlbum.next()) {
-			if (AlbumDAO *albumDAO = qobject_cast<AlbumDAO*>(_cache.value(albumId))) {
-				int i = -1;
-				albumDAO->setId(selectAlbum.record().value(++i).toString());
-				albumDAO->setTitle(selectAlbum.record().value(++i).toString());
-				albumDAO->setTitleNormalized(selectAlbum.record().value(++i).toString());
-				albumDAO->setYear(selectAlbum.record().value(++i).toString());
-				albumDAO->setCover(selectAlbum.record().value(++i).toString());
-				emit aboutToUpdateNode(albumDAO);
-			}
+			updateCoverPath.addBindValue(it.value());
+			updateCoverPath.addBindValue(selectAlbum.record().value(0).toUInt());
+			updateCoverPath.exec();
 		}
 	}
+	if (!_pendingCovers.isEmpty()) {
+		this->libraryHasChanged();
+	}
+	_pendingCovers.clear();
+}
+
+/** Reads an external picture which is close to multimedia files (same folder). */
+void SqlDatabase::saveCoverRef(const QString &coverPath, const QString &track)
+{
+	// Tracks are still in the pipeline, albums will be updated by the writer when the scan has ended
+	_databaseWriter.post([=]() {
+		_pendingCovers.insert(track, coverPath);
+	});
 }
 
 QString SqlDatabase::normalizeField(const QString &s) const
 {
-	static QRegularExpression regExp("[^\\w]");
-	QString sNormed = s.toLower().normalized(QString::NormalizationForm_KD).remove(regExp).trimmed();
-	if (sNormed.isEmpty()) {
-		return s.toLower().remove(" ").trimmed();
-	} else {
-		return sNormed;
-	}
+	return FieldNormalizer::normalize(s);
 }
 
+/** Configures the write connection when it has just been opened. */
 void SqlDatabase::setPragmas()
 {
-	this->exec("PRAGMA journal_mode = MEMORY");
-	this->exec("PRAGMA synchronous = OFF");
-	this->exec("PRAGMA temp_store = 2");
-	this->exec("PRAGMA foreign_keys = 1");
+	// With a write-ahead log, readers and the writer don't block each other, and a crash can't corrupt the database:
+	// at worst the last transactions are lost. NORMAL is safe in this mode, and syncs only at checkpoints
+	QSqlDatabase &db = this->connection();
+	db.exec("PRAGMA journal_mode = WAL");
+	db.exec("PRAGMA synchronous = NORMAL");
+	db.exec("PRAGMA busy_timeout = 5000");
+	db.exec("PRAGMA temp_store = 2");
+	db.exec("PRAGMA foreign_keys = 1");
+	// Rows replaced by INSERT OR REPLACE have to be removed from the search index by their delete trigger
+	db.exec("PRAGMA recursive_triggers = 1");
 }
 
-/** Reads a file from the filesystem and adds it into the library. */
-void SqlDatabase::saveFileRef(const QString &absFilePath)
+/** Removes files, or whole directories, which were deleted from the filesystem. */
+void SqlDatabase::removeFileRefs(const QStringList &absFilePaths)
 {
-	if (!isOpen()) {
-		open();
-	}
-	FileHelper fh(absFilePath);
-	/*if (!fh.isValid()) {
+	if (!_databaseWriter.isCurrentThread()) {
+		_databaseWriter.post([=]() { this->removeFileRefs(absFilePaths); });
 		return;
-	}*/
-
-	QSqlQuery insertTrack(*this);
-	insertTrack.prepare("INSERT INTO tracks (uri, trackNumber, title, artistId, albumId, artistAlbum, length, " \
-		"disc, internalCover, rating) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-
-	QString tn = fh.trackNumber();
-	QString title = fh.title();
-	//qDebug() << Q_FUNC_INFO << fh.artistAlbum() << fh.artist();
-	QString artistAlbum = fh.artistAlbum().isEmpty() ? fh.artist() : fh.artistAlbum();
-	// Use Artist Album to reference tracks in table "tracks", not Artist
-	QString artistNorm = this->normalizeField(artistAlbum);
-	QString album = fh.album();
-	QString albumNorm = this->normalizeField(album);
-	QString length = fh.length();
-	uint artistId = qHash(artistNorm);
-	uint albumId = artistId + qHash(albumNorm, 1);
-	int dn = fh.discNumber();
-
-	insertTrack.addBindValue("file://" + absFilePath);
-	insertTrack.addBindValue(tn.toInt());
-	if (title.isEmpty()) {
-		insertTrack.addBindValue(fh.fileInfo().baseName());
-	} else {
-		insertTrack.addBindValue(title);
 	}
-	insertTrack.addBindValue(artistId);
-	insertTrack.addBindValue(albumId);
-	insertTrack.addBindValue(fh.artistAlbum());
-	insertTrack.addBindValue(length);
-	insertTrack.addBindValue(dn);
-	insertTrack.addBindValue(fh.hasCover());
-	insertTrack.addBindValue(fh.rating());
-
-	bool artistInserted = false;
-	bool albumInserted = false;
-	ArtistDAO *artistDAO = nullptr;
-	AlbumDAO *albumDAO = nullptr;
-
-	if (!insertTrack.exec()) {
-		qDebug() << Q_FUNC_INFO << insertTrack.lastError();
+	if (absFilePaths.isEmpty()) {
 		return;
 	}
-	TrackDAO *trackDAO = new TrackDAO;
-	trackDAO->setUri("file://" + absFilePath);
-	trackDAO->setTrackNumber(tn);
-	trackDAO->setTitle(title);
-	trackDAO->setArtist(fh.artist());
-	trackDAO->setAlbum(album);
-	trackDAO->setArtistAlbum(artistAlbum);
-	trackDAO->setLength(length);
-	trackDAO->setRating(fh.rating());
-	trackDAO->setDisc(QString::number(dn));
-
-	QSqlQuery selectAlbum(*this);
-	selectAlbum.prepare("SELECT name, normalizedName FROM albums WHERE id = ? AND artistId = ?");
-	selectAlbum.addBindValue(albumId);
-	selectAlbum.addBindValue(artistId);
-	selectAlbum.exec();
-	if (!selectAlbum.next()) {
-		QSqlQuery insertAlbum(*this);
-		insertAlbum.prepare("INSERT INTO albums (id, name, normalizedName, year, artistId) VALUES (?, ?, ?, ?, ?)");
-		insertAlbum.addBindValue(albumId);
-		insertAlbum.addBindValue(album);
-		insertAlbum.addBindValue(albumNorm);
-		if (fh.year().isEmpty()) {
-			insertAlbum.addBindValue(0);
-		} else {
-			insertAlbum.addBindValue(fh.year());
-		}
-		insertAlbum.addBindValue(artistId);
-		albumInserted = insertAlbum.exec();
-		if (!albumInserted) {
-			qDebug() << Q_FUNC_INFO << "not inserted" << insertAlbum.lastError();
-		}
+	transaction();
+	this->removePaths("tracks", "uri", "file://", absFilePaths);
+	this->removePaths("fileSignatures", "path", QString(), absFilePaths);
+	this->libraryHasChanged();
+	commit();
+}
 
-		albumDAO = new AlbumDAO;
-		albumDAO->setId(QString::number(albumId));
-		albumDAO->setTitle(album);
-		albumDAO->setTitleNormalized(albumNorm);
-		albumDAO->setYear(fh.year());
-		if (fh.hasCover()) {
-			albumDAO->setCover(absFilePath);
+/** Deletes rows of a table where a column is one of these paths, or a path under one of them. */
+void SqlDatabase::removePaths(const QString &table, const QString &column, const QString &scheme, const QStringList &paths)
+{
+	// LIKE would ignore case, would read '_' and '%' in names as wildcards, and couldn't use the unique index of the column.
+	// Paths under a directory are a range instead, since '0' is the character after '/'
+	for (int i = 0; i < paths.size(); i += PATHS_PER_STATEMENT) {
+		QStringList batch = paths.mid(i, PATHS_PER_STATEMENT);
+		QStringList conditions;
+		for (int j = 0; j < batch.size(); j++) {
+			conditions << QString("%1 = ? OR (%1 >= ? AND %1 < ?)").arg(column);
 		}
-		_cache.insert(albumId, albumDAO);
-
-	} else {
-		QSqlQuery updateAlbum(*this);
-		if (QString::compare(selectAlbum.record().value(0).toString(), album) == 0) {
-			// Remote album with an icon in the treeview, then we add the exact same album from harddrive
-			// for example, first: listenned in streaming, second: enjoyed, then downloaded (legit DL of course)
-			updateAlbum.prepare("UPDATE albums SET host = nullptr, icon = nullptr WHERE id = ?");
-		} else {
-			// A previous record exists for this normalized name but the new name is different
-			updateAlbum.prepare("UPDATE albums SET name = ? WHERE id = ?");
-			updateAlbum.addBindValue(album);
+		QSqlQuery &remove = this->preparedQuery(QString("DELETE FROM %1 WHERE ").arg(table) + conditions.join(" OR "));
+		for (const QString &path : batch) {
+			QString directory = path.endsWith('/') ? path : path + '/';
+			remove.addBindValue(scheme + path);
+			remove.addBindValue(scheme + directory);
+			remove.addBindValue(scheme + directory.left(directory.size() - 1) + '0');
 		}
-		updateAlbum.addBindValue(albumId);
-		updateAlbum.exec();
+		remove.exec();
 	}
-	QSqlQuery selectArtist(*this);
-	selectArtist.prepare("SELECT name, normalizedName FROM artists WHERE id = ?");
-	selectArtist.addBindValue(artistId);
-	selectArtist.exec();
-	if (!selectArtist.next()) {
-		QSqlQuery insertArtist(*this);
-		insertArtist.prepare("INSERT INTO artists (id, name, normalizedName) VALUES (?, ?, ?)");
-		insertArtist.addBindValue(artistId);
-		insertArtist.addBindValue(artistAlbum);
-		insertArtist.addBindValue(artistNorm);
-		artistInserted = insertArtist.exec();
-
-		artistDAO = new ArtistDAO;
-		artistDAO->setId(QString::number(artistId));
-		artistDAO->setTitle(artistAlbum);
-		artistDAO->setTitleNormalized(artistNorm);
-		_cache.insert(artistId, artistDAO);
-	} else {
-		QSqlQuery updateArtist(*this);
-		if (QString::compare(selectArtist.record().value(0).toString(), artistAlbum) == 0) {
-			updateArtist.prepare("UPDATE artists SET host = nullptr WHERE id = ?");
+}
+
+/** Applies changes reported by the FileSystemMonitor: removed paths are deleted, new and modified files are read again. */
+void SqlDatabase::updateFileRefs(const QStringList &changedFiles, const QStringList &removedPaths)
+{
+	_databaseWriter.post([=]() {
+		open();
+		if (changedFiles.isEmpty()) {
+			transaction();
+			this->removeFileRefs(removedPaths);
+			this->cleanNodesWithoutTracks();
+			commit();
+			QMetaObject::invokeMethod(this, "loadFromFileDB", Qt::QueuedConnection);
 		} else {
-			updateArtist.prepare("UPDATE artists SET name = ?, host = nullptr WHERE id = ?");
-			updateArtist.addBindValue(artistAlbum);
+			// Database will be committed when the engine has finished to read these files, like after any other scan
+			this->beginScan();
+			this->removeFileRefs(removedPaths);
+			QMetaObject::invokeMethod(_musicSearchEngine, "doUpdate", Qt::QueuedConnection, Q_ARG(QStringList, changedFiles));
 		}
-		updateArtist.addBindValue(artistId);
-		updateArtist.exec();
-	}
+	});
+}
+
+/** Adds a batch of files read from the filesystem into the library. Called by TagReaders, in their threads: the batch is
+ * queued to the writer without going through the UI thread. */
+void SqlDatabase::saveFileRefs(const QList<TrackMetadata> &tracks)
+{
+	_databaseWriter.post([this, tracks]() {
+		open();
+		for (const TrackMetadata &track : tracks) {
+			_writer.write(track);
+		}
+	});
 }
@@ -4,27 +4,42 @@
 #include "../miamcore_global.h"
 #include "artistdao.h"
 #include "albumdao.h"
+#include "databasewriter.h"
 #include "trackdao.h"
+#include "libraryloader.h"
+#include "librarywriter.h"
 #include "playlistdao.h"
 #include "yeardao.h"
+#include "../tagreader.h"
 
 #include <QFileInfo>
 #include <QSqlDatabase>
+#include <QSqlQuery>
 #include <QSqlTableModel>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
 #include <QWeakPointer>
 
+#include <functional>
+
 /// Forward declarations
 class Cover;
 class FileHelper;
+class FileSystemMonitor;
 class MusicSearchEngine;
 
 /**
  * \brief		The SqlDatabase class uses SQLite to store few but useful tables for tracks, playlists, etc.
+ * \details		The database is in WAL mode. Only one connection writes, it's owned by the thread of a DatabaseWriter: edits
+ *				from the UI wait for their result there, while tracks read by a scan are sent to it without going through the UI
+ *				thread. Other reads use a read-only connection per thread, from readConnection() or readQuery(): a scan which
+ *				is writing doesn't block them, and they don't see changes which aren't committed yet.
  * \author      Matthieu Bachelier
  * \copyright   GNU General Public License v3
  */
-class MIAMCORE_LIBRARY SqlDatabase : public QObject, public QSqlDatabase
+class MIAMCORE_LIBRARY SqlDatabase : public QObject
 {
 	Q_OBJECT
 private:
@@ -35,10 +50,78 @@ private:
 	/** This worker is used to avoid a blocking UI when scanning the FileSystem. */
 	QThread _workerThread;
 
+	/** A single thread which runs queries of the asynchronous API, with its own read-only connection. */
+	QThreadPool _queryPool;
+
 	/** Object than can iterate throught the FileSystem for Audio files. */
 	MusicSearchEngine *_musicSearchEngine;
 
-	QHash<uint, GenericDAO*> _cache;
+	/** Reports changes in music locations, lives in the same thread than the engine. */
+	FileSystemMonitor *_fileSystemMonitor;
+
+	/** Thread which owns the connection allowed to write. Members below, up to the transaction, are only used there. */
+	DatabaseWriter _databaseWriter;
+
+	/** Covers found next to tracks are saved when the scan has ended, because albums may not be inserted yet. */
+	QHash<QString, QString> _pendingCovers;
+
+	/** Inserts tracks read by the engine with a few multi-rows statements. */
+	LibraryWriter _writer;
+
+	/** Statements prepared for the current connection, by SQL string. */
+	QHash<QString, QSqlQuery> _statements;
+	int _statementCacheHits;
+	int _statementCacheMisses;
+
+	/** Number of nested transactions: only the first one is a real transaction, others are savepoints. Changes of a pending
+	 * transaction are only visible from this connection. */
+	int _transactionDepth;
+
+	/** The pending transaction has modified the library: its version has to be increased when it's committed. */
+	bool _isLibraryModified;
+
+	/** Scans which were started and have not ended yet. They share a transaction, which is committed by batches. */
+	int _runningScans;
+
+	/** Full-text index of names, which exists only if SQLite was built with FTS5. */
+	bool _hasSearchIndex;
+
+	/** When a scan is cancelled, its checkpoint is kept so that it can be resumed later. */
+	bool _isScanCancelled;
+
+	/** Reads the library in a thread pool when views have to be populated. */
+	LibraryLoader *_loader;
+
+	/** Nodes of the library, filled by the loader. */
+	QSharedPointer<NodeStore> _nodeStore;
+
+	/** Nodes sent to views when tracks are updated while the loader is running, kept until the library is loaded again. */
+	QSharedPointer<NodeStore> _updatedNodeStore;
+
+	/** Range of nodes sent by the loader, inserted in views by small chunks to keep the UI responsive. */
+	quint32 _firstLoadedNode;
+	quint32 _lastLoadedNode;
+	QTimer *_loadTimer;
+
+	/** Number of nodes sent in the next chunk, adjusted to the time views took to insert the previous one. */
+	int _loadChunkSize;
+
+	/** Time spent at most to insert loaded nodes, before giving control back to the event loop. */
+	static const int LOAD_CHUNK_MS;
+
+	/** Stored in the database with PRAGMA user_version. */
+	static const int SCHEMA_VERSION;
+
+	/** Deleted paths which are removed by a single statement. */
+	static const int PATHS_PER_STATEMENT;
+
+	/** Runs query on the database thread, then callback with its result in the thread of context, if it still exists. */
+	template<typename T>
+	void runAsync(const std::function<T()> &query, QObject *context, const std::function<void(const T &)> &callback);
+
+	/** Runs statements in the writer thread, and waits for their result. */
+	template<typename T>
+	T write(const std::function<T()> &statements);
 
 	Q_ENUMS(extension)
 
@@ -48,6 +131,61 @@ public:
 
 	MusicSearchEngine * musicSearchEngine() const;
 
+	/** Opens the connection only once, otherwise prepared statements and pending transactions would be lost. */
+	bool open();
+
+	inline const QString &databaseName() const { return _databaseWriter.databaseName(); }
+
+	/** Returns the connection of the writer thread, which can only be used there. Methods which use it directly, like
+	 * preparedQuery(), transactions, or inserts of artists and albums by their names, are only called by writes. */
+	QSqlDatabase &connection();
+
+	/** Returns a statement which is prepared only once for the connection of the writer thread. */
+	QSqlQuery &preparedQuery(const QString &sql);
+
+	/** Returns the read-only connection of the current thread, which is opened the first time. */
+	QSqlDatabase readConnection() const;
+
+	/** Returns a statement prepared only once for the read-only connection of the current thread. In the writer thread, the
+	 * writer's connection is used instead: its pending changes are visible. */
+	QSqlQuery &readQuery(const QString &sql);
+
+	/** Transactions are tracked, so that reads of the thread which writes can see its own pending changes. They can be nested:
+	 * an edit made during a scan is a savepoint, which doesn't commit or roll back tracks of the scan. */
+	bool transaction();
+	bool commit();
+	bool rollback();
+
+	/** Commits tracks written by running scans, and starts a new transaction for the next ones. Returns false if there's no
+	 * scan, or if an edit is in progress: its savepoint can't be committed yet. */
+	bool commitScanBatch();
+
+	/** Has to be called when artists, albums or tracks were modified. Snapshots of the library are made stale by increasing its
+	 * version, only once when the pending transaction is committed. */
+	void libraryHasChanged();
+
+	inline int statementCacheHits() const { return _statementCacheHits; }
+	inline int statementCacheMisses() const { return _statementCacheMisses; }
+
+	/** Starts or stops to monitor music locations. */
+	void setWatchForChanges(bool b);
+
+	/** Returns the id of a remote source, which is inserted if needed. Local records don't have any host. */
+	QVariant hostId(const QString &host);
+
+	/** Returns the id of an artist, which is inserted if needed. */
+	uint insertArtist(const QString &name, const QString &normalizedName, const QVariant &hostId, const QString &icon = QString());
+
+	/** Returns the id of an album, which is inserted if needed. Albums are identified by their artist and their normalized name. */
+	uint insertAlbum(uint artistId, const QString &name, const QString &normalizedName, const QVariant &year,
+					 const QVariant &hostId, const QString &icon = QString());
+
+	/** Returns the id of an artist, or 0 if it's not in the database. */
+	uint selectArtistId(const QString &normalizedName);
+
+	/** Returns the id of an album, or 0 if it's not in the database. */
+	uint selectAlbumId(uint artistId, const QString &normalizedName);
+
 	bool insertIntoTableArtists(ArtistDAO *artist);
 	bool insertIntoTableAlbums(uint artistId, AlbumDAO *album);
 	uint insertIntoTablePlaylists(const PlaylistDAO &playlist, const std::list<TrackDAO> &tracks, bool isOverwriting);
@@ -64,28 +202,66 @@ public:
 	PlaylistDAO selectPlaylist(uint playlistId);
 	QList<PlaylistDAO> selectPlaylists();
 
+	/** Reads below use the read-only connection of the calling thread: they don't wait for the writer. */
 	ArtistDAO* selectArtist(uint artistId);
 	AlbumDAO* selectAlbumFromArtist(ArtistDAO *artistDAO, uint albumId);
+	/** Properties are internal values (key, value) related to the library, like the size of the last scan. */
+	QVariant selectProperty(const QString &key);
+
 	TrackDAO selectTrackByURI(const QString &uri);
 
+	/** Asynchronous queries: they never block the caller, and callbacks are called in the thread of context. */
+	void selectCoverFromURI(const QString &uri, QObject *context, const std::function<void(Cover* const &)> &callback);
+	void selectTrackByURI(const QString &uri, QObject *context, const std::function<void(const TrackDAO &)> &callback);
+	void selectTracksByURI(const QStringList &uris, QObject *context, const std::function<void(const QList<TrackDAO> &)> &callback);
+
+	/** Returns at most limit artists, albums or tracks which match text, best matches first. */
+	QSqlQuery searchLibrary(Miam::ItemType type, const QString &text, int limit);
+
+	/** Builds a full-text query where every word of text is a prefix, in the same way names are tokenized in the index. */
+	static QString matchExpression(const QString &text);
+
 	bool playlistHasBackgroundImage(uint playlistID);
 	bool updateTablePlaylist(const PlaylistDAO &playlist);
+	void updateTableProperties(const QString &key, const QVariant &value);
 	void updateTablePlaylistWithBackgroundImage(uint playlistID, const QString &backgroundImagePath);
 	void updateTableAlbumWithCoverImage(const QString &coverPath, const QString &album, const QString &artist);
 
-	/** Update a list of tracks. If track name has changed, it will be removed from Library then added right after. */
+	/** Update a list of tracks. If track name has changed, it will be removed from Library then added right after. Must be
+	 * called from the UI thread, which owns nodes. Records are written later by the writer, the caller doesn't wait. */
 	void updateTracks(const QStringList &oldPaths, const QStringList &newPaths);
 
+	/** Normalized names identify artists and albums, see FieldNormalizer. */
 	QString normalizeField(const QString &s) const;
 
+private:
+	/** Configures the write connection when it has just been opened. */
 	void setPragmas();
 
-private:
+	/** Creates tables which don't exist yet, and migrates previous versions of the schema. */
+	void updateSchema();
+
+	/** Makes snapshots of the library stale. */
+	void increaseLibraryVersion();
+
 	/** When one has manually updated tracks with TagEditor, some nodes might in unstable state. */
 	bool cleanNodesWithoutTracks();
 
-	/** Read all tracks entries in the database and send them to connected views. */
-	void loadFromFileDB(bool sendResetSignal = true);
+	/** Writes updated tracks. DAOs to convert into nodes are appended in display order, and all new DAOs are owned by the caller. */
+	bool updateTrackRecords(const QStringList &oldPaths, const QStringList &newPaths, QList<GenericDAO*> &daos,
+							QList<GenericDAO*> &extractedDAOs);
+
+	/** Attach covers collected during a scan to their albums. */
+	void savePendingCoverRefs();
+
+	/** Returns the store where edited nodes are appended: the store of the library, unless the loader is still filling it. */
+	NodeStore* storeForUpdates();
+
+	/** The first scan opens the transaction which is shared by all scans started before the last one has ended. */
+	void beginScan();
+
+	/** Commits tracks of the scan which has ended. The transaction is kept as long as other scans are running. */
+	void endScan(bool isCancelled);
 
 public slots:
 	/** Load an existing database file or recreate it, if not found. */
@@ -96,12 +272,42 @@ public slots:
 
 	void rebuild(const QStringList &oldLocations, const QStringList &newLocations);
 
+	/** Compares the library with the FileSystem, and reads only files which were added or modified since the last scan. */
+	void rescan();
+
 private slots:
+	/** Read all tracks entries in the database and send them to connected views. Nodes are built in another thread. */
+	void loadFromFileDB(bool sendResetSignal = true);
+
+	/** Loads the library again when the writer has committed a scan, and resyncs remote sources. */
+	void scanHasEnded();
+
+	/** Converts DAOs extracted by the writer into nodes of the library, then deletes them. */
+	void applyUpdatedTracks(const QList<GenericDAO*> &daos, const QList<GenericDAO*> &extractedDAOs, bool isCleaned);
+
+	/** Keeps nodes sent by the current loader, and drops outdated ones. */
+	void appendLoadedNodes(quint32 first, quint32 count);
+
+	/** Sends a chunk of loaded nodes to the views. */
+	void insertLoadedNodes();
+
+	void loaderHasFinished();
+
 	/** Reads an external picture which is close to multimedia files (same folder). */
 	void saveCoverRef(const QString &coverPath, const QString &track);
 
-	/** Reads a file from the filesystem and adds it into the library. */
-	void saveFileRef(const QString &absFilePath);
+	/** Removes files, or whole directories, which were deleted from the filesystem. */
+	void removeFileRefs(const QStringList &absFilePaths);
+
+	/** Deletes rows of a table where a column is one of these paths, or a path under one of them. */
+	void removePaths(const QString &table, const QString &column, const QString &scheme, const QStringList &paths);
+
+	/** Applies changes reported by the FileSystemMonitor: removed paths are deleted, new and modified files are read again. */
+	void updateFileRefs(const QStringList &changedFiles, const QStringList &removedPaths);
+
+	/** Adds a batch of files read from the filesystem into the library. Called by TagReaders, in their threads: the batch is
+	 * queued to the writer without going through the UI thread. */
+	void saveFileRefs(const QList<TrackMetadata> &tracks);
 
 signals:
 	void aboutToLoad();
@@ -110,11 +316,15 @@ signals:
 	void loaded();
 	void progressChanged(const int &);
 
-	void nodeExtracted(GenericDAO *node);
-	void aboutToUpdateNode(GenericDAO *node);
+	/** Nodes are sent in display order, parents before their children, so that views can insert siblings together. */
+	void nodesExtracted(const QVector<LibraryNode> &nodes);
+	void aboutToUpdateNode(const LibraryNode &node);
 
 	//void aboutToUpdateView(const QList<FileHelper*> &olds, const QList<FileHelper*> &news);
 	void aboutToCleanView();
+
+	/** Emitted by the writer when tracks edited by updateTracks() were written. New DAOs are owned by the receiver. */
+	void trackRecordsUpdated(const QList<GenericDAO*> &daos, const QList<GenericDAO*> &extractedDAOs, bool isCleaned);
 };
 
 #endif // SQLDATABASE_H
@@ -0,0 +1,86 @@
+#include "stringpool.h"
+
+#include <QMutexLocker>
+
+StringPool::StringPool()
+	: _requests(0)
+	, _hits(0)
+	, _savedBytes(0)
+{}
+
+/** The pool is used by the loader before any view exists, so the instance has to be created safely from any thread. */
+StringPool* StringPool::instance()
+{
+	static StringPool pool;
+	return &pool;
+}
+
+/** Returns a string equal to s, which shares its data with other equal strings. */
+QString StringPool::intern(const QString &s)
+{
+	if (s.isEmpty()) {
+		return QString();
+	}
+	QMutexLocker locker(&_mutex);
+	_requests++;
+	auto it = _strings.constFind(s);
+	if (it == _strings.constEnd()) {
+		_strings.insert(s);
+		return s;
+	}
+	_hits++;
+	if (it->constData() != s.constData()) {
+		_savedBytes += bytesOf(s);
+	}
+	return *it;
+}
+
+/** Removes strings which aren't used anywhere else. */
+void StringPool::squeeze()
+{
+	QMutexLocker locker(&_mutex);
+	auto it = _strings.begin();
+	while (it != _strings.end()) {
+		// Only copies made by intern() can share data with the pool, and they are made under the same lock
+		if (it->isDetached()) {
+			it = _strings.erase(it);
+		} else {
+			++it;
+		}
+	}
+	_strings.squeeze();
+}
+
+StringPool::Report StringPool::report() const
+{
+	QMutexLocker locker(&_mutex);
+	Report r;
+	r.strings = _strings.size();
+	r.bytes = 0;
+	for (const QString &s : _strings) {
+		r.bytes += bytesOf(s);
+	}
+	r.requests = _requests;
+	r.hits = _hits;
+	r.savedBytes = _savedBytes;
+	return r;
+}
+
+/** Human readable report, for logs. */
+QString StringPool::memoryReport() const
+{
+	Report r = this->report();
+	return QString("StringPool: %1 distinct strings (%2 KiB), %3 of %4 requests shared an existing string, %5 KiB of duplicates saved")
+		.arg(r.strings)
+		.arg(r.bytes / 1024)
+		.arg(r.hits)
+		.arg(r.requests)
+		.arg(r.savedBytes / 1024);
+}
+
+/** Approximate memory used by the data of a string. */
+quint64 StringPool::bytesOf(const QString &s)
+{
+	// Header of the shared data, then UTF-16 characters and the terminating null
+	return sizeof(QArrayData) + (s.capacity() + 1) * sizeof(QChar);
+}
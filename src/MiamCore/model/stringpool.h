@@ -0,0 +1,68 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+#include "../miamcore_global.h"
+
+/**
+ * \brief		The StringPool class keeps a single copy of strings which are repeated in the library, like artists or albums.
+ * \details		QString is implicitly shared: when a string is interned, the copy which is returned shares its data with every
+ *				other equal string which was interned before, and the duplicate can be released. It's used when nodes are loaded,
+ *				when tracks are read from the database and by playlists. Strings which are only referenced by the pool are dropped
+ *				by squeeze(). This class can be used from any thread.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY StringPool
+{
+	Q_DISABLE_COPY(StringPool)
+
+public:
+	/** Counters used to check how much memory is saved. */
+	struct Report
+	{
+		/** Distinct strings in the pool, and the memory they use. */
+		int strings;
+		quint64 bytes;
+
+		/** Calls to intern(), and calls which returned a string which was already in the pool. */
+		quint64 requests;
+		quint64 hits;
+
+		/** Memory of duplicates which could be released because a shared copy was returned instead. */
+		quint64 savedBytes;
+	};
+
+private:
+	mutable QMutex _mutex;
+
+	QSet<QString> _strings;
+
+	quint64 _requests;
+	quint64 _hits;
+	quint64 _savedBytes;
+
+	StringPool();
+
+public:
+	static StringPool* instance();
+
+	/** Returns a string equal to s, which shares its data with other equal strings. */
+	QString intern(const QString &s);
+
+	/** Removes strings which aren't used anywhere else. */
+	void squeeze();
+
+	Report report() const;
+
+	/** Human readable report, for logs. */
+	QString memoryReport() const;
+
+	/** Approximate memory used by the data of a string. */
+	static quint64 bytesOf(const QString &s);
+};
+
+#endif // STRINGPOOL_H
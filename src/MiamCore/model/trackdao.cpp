@@ -1,4 +1,5 @@
 #include "trackdao.h"
+#include "stringpool.h"
 
 TrackDAO::TrackDAO(QObject *parent) :
 	GenericDAO(Miam::IT_Track, parent), _rating(0)
@@ -37,16 +38,16 @@ TrackDAO& TrackDAO::operator=(const TrackDAO& other)
 TrackDAO::~TrackDAO() {}
 
 QString TrackDAO::album() const { return _album; }
-void TrackDAO::setAlbum(const QString &album) { _album = album; }
+void TrackDAO::setAlbum(const QString &album) { _album = StringPool::instance()->intern(album); }
 
 QString TrackDAO::artist() const { return _artist; }
-void TrackDAO::setArtist(const QString &artist) { _artist = artist; }
+void TrackDAO::setArtist(const QString &artist) { _artist = StringPool::instance()->intern(artist); }
 
 QString TrackDAO::artistAlbum() const { return _artistAlbum; }
-void TrackDAO::setArtistAlbum(const QString &artistAlbum) { _artistAlbum = artistAlbum; }
+void TrackDAO::setArtistAlbum(const QString &artistAlbum) { _artistAlbum = StringPool::instance()->intern(artistAlbum); }
 
 QString TrackDAO::disc() const { return _disc; }
-void TrackDAO::setDisc(const QString &disc) { _disc = disc; }
+void TrackDAO::setDisc(const QString &disc) { _disc = StringPool::instance()->intern(disc); }
 
 QString TrackDAO::length() const { return _length; }
 void TrackDAO::setLength(const QString &length) { _length = length; }
@@ -55,7 +56,7 @@ int TrackDAO::rating() const { return _rating; }
 void TrackDAO::setRating(int rating) { _rating = rating; }
 
 QString TrackDAO::source() const { return _source; }
-void TrackDAO::setSource(const QString &source) { _source = source; }
+void TrackDAO::setSource(const QString &source) { _source = StringPool::instance()->intern(source); }
 
 QString TrackDAO::trackNumber(bool twoDigits) const
 {
@@ -66,13 +67,13 @@ QString TrackDAO::trackNumber(bool twoDigits) const
 	}
 }
 
-void TrackDAO::setTrackNumber(const QString &trackNumber) { _trackNumber = trackNumber; }
+void TrackDAO::setTrackNumber(const QString &trackNumber) { _trackNumber = StringPool::instance()->intern(trackNumber); }
 
 QString TrackDAO::uri() const { return _uri; }
 void TrackDAO::setUri(const QString &uri) { _uri = uri; }
 
 QString TrackDAO::year() const { return _year; }
-void TrackDAO::setYear(const QString &year) { _year = year; }
+void TrackDAO::setYear(const QString &year) { _year = StringPool::instance()->intern(year); }
 
 uint TrackDAO::hash() const
 {
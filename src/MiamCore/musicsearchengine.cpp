@@ -1,170 +1,390 @@
 #include "musicsearchengine.h"
 #include "filehelper.h"
 #include "settingsprivate.h"
-#include "model/sqldatabase.h"
 
-#include <QDateTime>
 #include <QDirIterator>
 #include <QFileInfo>
-#include <QThread>
-
-#include <QSqlQuery>
-#include <QSqlError>
-#include <QSqlRecord>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QSet>
+#include <QStorageInfo>
 
 #include <QtDebug>
 
+#include <algorithm>
+#include <functional>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/sysmacros.h>
+#endif
+
+/** State shared by walkers, which may run in parallel on different devices. */
+struct MusicSearchEngine::ScanState
+{
+	int previousEntryCount;
+
+	/** Protects known files and the progress. */
+	QMutex mutex;
+	FileSignatures *knownFiles;
+	int percent;
+
+	QAtomicInt currentEntry;
+	QAtomicInt visitedDirectories;
+	QAtomicInt pendingDirectories;
+
+	ScanState() : previousEntryCount(0), knownFiles(nullptr), percent(1) {}
+};
+
+/** Runs a walker in a thread pool. */
+class WalkerTask : public QRunnable
+{
+private:
+	std::function<void()> _function;
+
+public:
+	explicit WalkerTask(const std::function<void()> &function) : QRunnable(), _function(function) { setAutoDelete(true); }
+
+	virtual void run() override { _function(); }
+};
+
 bool MusicSearchEngine::isScanning = false;
 
-MusicSearchEngine::MusicSearchEngine(QObject *parent) :
-	QObject(parent), _timer(new QTimer(this))
+const int MusicSearchEngine::BATCH_SIZE = 64;
+const int MusicSearchEngine::REFINEMENT_PRIORITY = -1;
+
+MusicSearchEngine::MusicSearchEngine(QObject *parent)
+	: QObject(parent)
+	, _isPaused(false)
 {
-	_timer->setInterval(5000);
-	connect(_timer, &QTimer::timeout, this, &MusicSearchEngine::watchForChanges);
+	qRegisterMetaType<QList<TrackMetadata>>();
+	qRegisterMetaType<FileSignatures>("FileSignatures");
+}
 
-	// Monitor filesystem
-	if (SettingsPrivate::instance()->isFileSystemMonitored()) {
-		setWatchForChanges(true);
+/** Number of entries found by the previous full scan, used to estimate the progress of the next one. */
+void MusicSearchEngine::setEstimatedEntryCount(int entryCount)
+{
+	_estimatedEntryCount.store(entryCount);
+}
+
+/** Suspends the current scan: walkers and TagReaders stop before their next entry. Can be called from any thread. */
+void MusicSearchEngine::pause()
+{
+	QMutexLocker locker(&_pauseMutex);
+	_isPaused = true;
+}
+
+void MusicSearchEngine::resume()
+{
+	QMutexLocker locker(&_pauseMutex);
+	_isPaused = false;
+	_resumed.wakeAll();
+}
+
+/** Stops the current scan. Tracks which were already read are saved, the next scan will read the others. */
+void MusicSearchEngine::cancel()
+{
+	QMutexLocker locker(&_pauseMutex);
+	if (MusicSearchEngine::isScanning) {
+		_isCancelled.store(1);
 	}
+	_resumed.wakeAll();
 }
 
-void MusicSearchEngine::setWatchForChanges(bool b)
+bool MusicSearchEngine::isPaused()
 {
-	if (b) {
-		_timer->start();
-	} else {
-		_timer->stop();
+	QMutexLocker locker(&_pauseMutex);
+	return _isPaused;
+}
+
+/** Clears controls of the previous scan. */
+void MusicSearchEngine::prepareScan()
+{
+	QMutexLocker locker(&_pauseMutex);
+	_isPaused = false;
+	_isCancelled.store(0);
+	MusicSearchEngine::isScanning = true;
+}
+
+/** Blocks while the scan is paused. Returns false if the scan was cancelled. */
+bool MusicSearchEngine::waitWhilePaused()
+{
+	QMutexLocker locker(&_pauseMutex);
+	while (_isPaused && _isCancelled.load() == 0) {
+		_resumed.wait(&_pauseMutex);
 	}
+	return _isCancelled.load() == 0;
 }
 
 void MusicSearchEngine::doSearch(const QStringList &delta)
 {
 	//qDebug() << Q_FUNC_INFO << delta;
-	MusicSearchEngine::isScanning = true;
-	QList<QDir> locations;
-	QStringList pathsToSearch = delta.isEmpty() ? SettingsPrivate::instance()->musicLocations() : delta;
-	for (QString musicPath : pathsToSearch) {
-		QDir location(musicPath);
-		location.setFilter(QDir::AllDirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
-		locations.append(location);
-	}
-
-	int entryCount = 0;
-	// QDirIterator class is very fast to scan large directories
-	for (QDir location : locations) {
-		QDirIterator it(location.absolutePath(), QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-		while (it.hasNext()) {
-			it.next();
-			entryCount++;
-		}
+	this->prepareScan();
+	if (delta.isEmpty()) {
+		this->scanLocations(SettingsPrivate::instance()->musicLocations(), true, nullptr);
+	} else {
+		this->scanLocations(delta, false, nullptr);
+	}
+	if (_isCancelled.load()) {
+		emit searchWasCancelled();
 	}
+	emit searchHasEnded();
+	MusicSearchEngine::isScanning = false;
+}
 
-	int currentEntry = 0;
-	int percent = 1;
-	bool atLeastOneAudioFileWasFound = false;
-	bool isNewDirectory = false;
+/** Compares files in music locations with signatures of the previous scan: only new and modified files are read. */
+void MusicSearchEngine::doRescan(const FileSignatures &knownFiles)
+{
+	this->prepareScan();
+	FileSignatures remainingFiles = knownFiles;
+	this->scanLocations(SettingsPrivate::instance()->musicLocations(), true, &remainingFiles);
 
-	QString coverPath;
-	QString lastFileScannedNextToCover;
+	// Files which were not found anymore have to be removed from the library, unless some locations were not visited
+	if (_isCancelled.load()) {
+		emit searchWasCancelled();
+	} else if (!remainingFiles.isEmpty()) {
+		emit filesRemoved(remainingFiles.keys());
+	}
+	emit searchHasEnded();
+	MusicSearchEngine::isScanning = false;
+}
 
+/** Reads again some files which were reported by the FileSystemMonitor. */
+void MusicSearchEngine::doUpdate(const QStringList &files)
+{
+	this->prepareScan();
 	QStringList suffixes = FileHelper::suffixes(FileHelper::All);
+	QStringList batch;
+	for (QString file : files) {
+		if (suffixes.contains(QFileInfo(file).suffix())) {
+			batch.append(file);
+			if (batch.size() >= BATCH_SIZE) {
+				this->sendToTagReaders(batch);
+				batch.clear();
+			}
+		}
+	}
+	this->sendToTagReaders(batch);
+	_tagReaders.waitForDone();
+	if (_isCancelled.load()) {
+		emit searchWasCancelled();
+	}
+	emit searchHasEnded();
+	MusicSearchEngine::isScanning = false;
+}
 
-	for (QDir location : locations) {
-		QDirIterator it(location.absolutePath(), QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-		while (it.hasNext()) {
-			QString entry = it.next();
-			QFileInfo qFileInfo(entry);
-			currentEntry++;
+/** Files are not parsed by the engine: they are sent to the pool of TagReaders. */
+void MusicSearchEngine::sendToTagReaders(const QStringList &files)
+{
+	FileHelper::IOMode ioMode = SettingsPrivate::instance()->isScanMemoryMapped() ? FileHelper::MappedIO : FileHelper::PrefetchedIO;
+	this->startTagReader(files, ioMode, FileHelper::ReadFast);
+}
 
-			// Directory has changed: we can discard cover
-			if (qFileInfo.isDir()) {
-				if (!coverPath.isEmpty() && !lastFileScannedNextToCover.isEmpty()) {
-					emit scannedCover(coverPath, lastFileScannedNextToCover);
-					coverPath.clear();
-				}
-				isNewDirectory = true;
-				atLeastOneAudioFileWasFound = false;
-				lastFileScannedNextToCover.clear();
-				continue;
-			} else if (qFileInfo.suffix().toLower() == "jpg" || qFileInfo.suffix().toLower() == "png") {
-				if (atLeastOneAudioFileWasFound) {
-					coverPath = qFileInfo.absoluteFilePath();
-					emit scannedCover(coverPath, lastFileScannedNextToCover);
-					coverPath.clear();
-				} else if (isNewDirectory) {
-					coverPath = qFileInfo.absoluteFilePath();
+/** Queues a TagReader. It may be started from a thread of the pool, to read again files which didn't have any length. */
+void MusicSearchEngine::startTagReader(const QStringList &files, FileHelper::IOMode ioMode, FileHelper::ReadMode readMode)
+{
+	if (!files.isEmpty()) {
+		TagReader *tagReader = new TagReader(files, ioMode, [this, ioMode, readMode] (const QList<TrackMetadata> &tracks) {
+			emit tracksScanned(tracks);
+
+			// Tracks are saved with the length which was found, files without any are read again after other batches. The
+			// scan waits for them too, and their new record replaces the first one
+			if (readMode == FileHelper::ReadFast) {
+				QStringList unknownLengths;
+				for (const TrackMetadata &track : tracks) {
+					if (track.isValid && track.length.toInt() <= 0) {
+						unknownLengths.append(track.absFilePath);
+					}
 				}
-			} else if (suffixes.contains(qFileInfo.suffix())) {
-				emit scannedFile(qFileInfo.absoluteFilePath());
-				atLeastOneAudioFileWasFound = true;
-				lastFileScannedNextToCover = qFileInfo.absoluteFilePath();
-				isNewDirectory = false;
+				this->startTagReader(unknownLengths, ioMode, FileHelper::ReadAll);
 			}
+		});
+		tagReader->setGate([this]() -> bool {
+			return this->waitWhilePaused();
+		});
+		tagReader->setReadMode(readMode);
+		_tagReaders.start(tagReader, readMode == FileHelper::ReadAll ? REFINEMENT_PRIORITY : 0);
+	}
+}
 
-			if (currentEntry * 100 / entryCount > percent) {
-				percent = currentEntry * 100 / entryCount;
-				emit progressChanged(percent);
-			}
+/** Identifies the device which stores a path, and guesses if it's a spinning disk. */
+quint64 MusicSearchEngine::deviceOf(const QString &path, bool *isRotational)
+{
+	*isRotational = false;
+#ifdef Q_OS_UNIX
+	struct stat st;
+	if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+		return 0;
+	}
+#ifdef Q_OS_LINUX
+	// Partitions don't have a queue, but their parent disk has one
+	QString sysfs = QString("/sys/dev/block/%1:%2").arg(major(st.st_dev)).arg(minor(st.st_dev));
+	for (QString rotational : { sysfs + "/queue/rotational", sysfs + "/../queue/rotational" }) {
+		QFile f(rotational);
+		if (f.open(QIODevice::ReadOnly)) {
+			*isRotational = f.readAll().trimmed() == "1";
+			break;
 		}
-		atLeastOneAudioFileWasFound = false;
 	}
-	emit searchHasEnded();
-	MusicSearchEngine::isScanning = false;
+#endif
+	return st.st_dev;
+#else
+	return qHash(QStorageInfo(path).rootPath());
+#endif
 }
 
-void MusicSearchEngine::watchForChanges()
+void MusicSearchEngine::scanLocations(const QStringList &locations, bool isFullScan, FileSignatures *knownFiles)
 {
-	// Gather all folders registered on music locations
-	QFileInfoList dirs;
-	for (QString musicPath : SettingsPrivate::instance()->musicLocations()) {
-		QFileInfo location(musicPath);
-		QDirIterator it(location.absoluteFilePath(), QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-		while (it.hasNext()) {
-			QString entry = it.next();
-			QFileInfo qFileInfo(entry);
-			dirs << qFileInfo;
+	ScanState state;
+	// The number of entries of the previous full scan is only relevant when the full library is scanned once again
+	state.previousEntryCount = isFullScan ? _estimatedEntryCount.load() : 0;
+	state.knownFiles = knownFiles;
+
+	// Locations are grouped by device: devices are walked in parallel, but each device by only one thread
+	QMap<quint64, QStringList> locationsByDevice;
+	QSet<quint64> rotationalDevices;
+	for (QString musicPath : locations) {
+		QString absolutePath = QDir(musicPath).absolutePath();
+		bool isRotational = false;
+		quint64 device = deviceOf(absolutePath, &isRotational);
+		locationsByDevice[device].append(absolutePath);
+		if (isRotational) {
+			rotationalDevices.insert(device);
 		}
 	}
+	state.pendingDirectories.store(locations.size());
 
-	SqlDatabase *db = SqlDatabase::instance();
-	db->open();
-	db->exec("PRAGMA journal_mode = MEMORY");
-	db->exec("PRAGMA synchronous = OFF");
-	db->exec("PRAGMA temp_store = 2");
-	db->exec("PRAGMA foreign_keys = 1");
-
-	QStringList newFoldersToAddInLibrary;
-	// Add folders that were not found first
-	for (QFileInfo f : dirs) {
-		QSqlQuery query = db->exec("SELECT * FROM filesystem WHERE path = \"" + f.absoluteFilePath() + "\"");
-		if (!query.next()) {
-			newFoldersToAddInLibrary << f.absoluteFilePath();
-			QSqlQuery prepared(*db);
-			prepared.prepare("INSERT INTO filesystem (path, lastModified) VALUES (?, ?)");
-			prepared.addBindValue(f.absoluteFilePath());
-			prepared.addBindValue(f.lastModified().toTime_t());
-			prepared.exec();
-		}
+	QThreadPool walkers;
+	walkers.setMaxThreadCount(qMax(1, locationsByDevice.size()));
+	QMapIterator<quint64, QStringList> it(locationsByDevice);
+	while (it.hasNext()) {
+		it.next();
+		QStringList deviceLocations = it.value();
+		bool isRotational = rotationalDevices.contains(it.key());
+		walkers.start(new WalkerTask([this, deviceLocations, isRotational, &state]() {
+			this->walk(deviceLocations, isRotational, state);
+		}));
 	}
+	walkers.waitForDone();
 
-	if (!newFoldersToAddInLibrary.isEmpty()) {
-		this->doSearch(newFoldersToAddInLibrary);
+	// Batches which were not started are dropped when the scan was cancelled
+	if (_isCancelled.load()) {
+		_tagReaders.clear();
 	}
 
-	// Process in reverse mode to clean cache: from database file and check if entry exists in database
-	QStringList oldLocations;
-	QSqlQuery cache = db->exec("SELECT * FROM filesystem");
-	while (cache.next()) {
-		QDir d(cache.record().value(0).toString());
-		d.exists();
-		QFileInfo fileInfo(cache.record().value(0).toString());
-		// Remove folder in database because it couldn't be find in the filesystem
-		if (!fileInfo.exists()) {
-			db->exec("DELETE FROM filesystem WHERE path = \"" + fileInfo.absoluteFilePath() + "\"");
-			oldLocations << fileInfo.absoluteFilePath();
-		}
+	// Every track must have been sent to the database before telling the scan is complete
+	_tagReaders.waitForDone();
+	if (isFullScan && _isCancelled.load() == 0) {
+		emit entriesScanned(state.currentEntry.load());
 	}
-	if (!oldLocations.isEmpty()) {
-		db->rebuild(oldLocations, QStringList());
+	emit progressChanged(100);
+}
+
+/** Walks locations which are on the same device. On spinning disks, entries are visited in the order of their inodes. */
+void MusicSearchEngine::walk(const QStringList &locations, bool isRotational, ScanState &state)
+{
+	// Directories are visited only once, in breadth-first order: there's no counting pass before the real one anymore
+	QQueue<QString> directories;
+	for (QString location : locations) {
+		directories.enqueue(location);
+	}
+
+	QStringList suffixes = FileHelper::suffixes(FileHelper::All);
+	auto byInode = [](const FileSignature &a, const FileSignature &b) { return a.inode < b.inode; };
+
+	// Files are not parsed here: they are grouped and sent to the pool of TagReaders
+	QStringList batch;
+
+	while (!directories.isEmpty() && this->waitWhilePaused()) {
+		QString coverPath;
+		QList<FileSignature> audioFiles;
+		QList<FileSignature> subDirectories;
+		int entries = 0;
+
+		// QDirIterator class is very fast to scan large directories
+		QDirIterator it(directories.dequeue(), QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot);
+		while (it.hasNext()) {
+			it.next();
+			QFileInfo qFileInfo = it.fileInfo();
+			entries++;
+
+			// Subdirectories are visited later, symbolic links are not followed
+			if (qFileInfo.isDir()) {
+				if (!qFileInfo.isSymLink()) {
+					FileSignature directory;
+					if (isRotational) {
+						directory = FileSignature::fromFileInfo(qFileInfo);
+					} else {
+						directory.absFilePath = qFileInfo.absoluteFilePath();
+					}
+					subDirectories.append(directory);
+				}
+			} else if (qFileInfo.suffix().toLower() == "jpg" || qFileInfo.suffix().toLower() == "png") {
+				coverPath = qFileInfo.absoluteFilePath();
+			} else if (suffixes.contains(qFileInfo.suffix())) {
+				// Signatures are needed to compare files with the previous scan, and inodes to sort them
+				FileSignature signature;
+				if (state.knownFiles || isRotational) {
+					signature = FileSignature::fromFileInfo(qFileInfo);
+				} else {
+					signature.absFilePath = qFileInfo.absoluteFilePath();
+				}
+				audioFiles.append(signature);
+			}
+		}
+
+		// Reading files in the order of their inodes avoids many seeks on spinning disks
+		if (isRotational) {
+			std::sort(audioFiles.begin(), audioFiles.end(), byInode);
+			std::sort(subDirectories.begin(), subDirectories.end(), byInode);
+		}
+		for (const FileSignature &directory : subDirectories) {
+			directories.enqueue(directory.absFilePath);
+		}
+
+		if (state.knownFiles) {
+			// When rescanning, tags are read again only if the signature of this file has changed
+			QMutexLocker locker(&state.mutex);
+			for (const FileSignature &signature : audioFiles) {
+				auto known = state.knownFiles->find(signature.absFilePath);
+				if (known == state.knownFiles->end() || known.value() != signature) {
+					batch.append(signature.absFilePath);
+				}
+				if (known != state.knownFiles->end()) {
+					state.knownFiles->erase(known);
+				}
+			}
+		} else {
+			for (const FileSignature &signature : audioFiles) {
+				batch.append(signature.absFilePath);
+			}
+		}
+		if (batch.size() >= BATCH_SIZE) {
+			this->sendToTagReaders(batch);
+			batch.clear();
+		}
+
+		// A cover is attached to the album of any audio file of the same directory
+		if (!coverPath.isEmpty() && !audioFiles.isEmpty()) {
+			emit scannedCover(coverPath, audioFiles.last().absFilePath);
+		}
+
+		// Refine the estimation with directories which are known but not yet visited, on every device
+		int currentEntry = state.currentEntry.fetchAndAddOrdered(entries) + entries;
+		int visitedDirectories = state.visitedDirectories.fetchAndAddOrdered(1) + 1;
+		int pendingDirectories = state.pendingDirectories.fetchAndAddOrdered(subDirectories.size() - 1) + subDirectories.size() - 1;
+		qint64 estimatedEntryCount = currentEntry + static_cast<qint64>(pendingDirectories) * currentEntry / visitedDirectories;
+		estimatedEntryCount = qMax(estimatedEntryCount, static_cast<qint64>(state.previousEntryCount));
+		if (estimatedEntryCount > 0) {
+			QMutexLocker locker(&state.mutex);
+			if (currentEntry * 100 / estimatedEntryCount > state.percent) {
+				state.percent = qMin(static_cast<int>(currentEntry * 100 / estimatedEntryCount), 99);
+				emit progressChanged(state.percent);
+			}
+		}
 	}
+	this->sendToTagReaders(batch);
 }
@@ -1,11 +1,15 @@
 #ifndef MUSICSEARCHENGINE_H
 #define MUSICSEARCHENGINE_H
 
+#include <QAtomicInt>
 #include <QDir>
 #include <QFileInfo>
-#include <QTimer>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "miamcore_global.h"
+#include "tagreader.h"
 
 /**
  * \brief		The MusicSearchEngine class
@@ -16,29 +20,94 @@ class MIAMCORE_LIBRARY MusicSearchEngine : public QObject
 {
 	Q_OBJECT
 private:
-	QTimer *_timer;
+	/** Pool of threads which are reading tags, while this engine keeps walking the FileSystem. */
+	QThreadPool _tagReaders;
+
+	/** Number of files sent together to a TagReader, and then to the database. */
+	static const int BATCH_SIZE;
+
+	/** Priority of TagReaders which read the length of files again, when headers weren't enough: other batches go first. */
+	static const int REFINEMENT_PRIORITY;
+
+	/** Set from the database thread before a scan is queued, read from the worker thread. */
+	QAtomicInt _estimatedEntryCount;
+
+	/** Walkers and TagReaders are waiting on this condition while the scan is paused. */
+	QMutex _pauseMutex;
+	QWaitCondition _resumed;
+	bool _isPaused;
+	QAtomicInt _isCancelled;
 
 public:
 	MusicSearchEngine(QObject *parent = 0);
 
 	static bool isScanning;
 
-	void setWatchForChanges(bool b);
+	/** Number of entries found by the previous full scan, used to estimate the progress of the next one. */
+	void setEstimatedEntryCount(int entryCount);
+
+	/** Suspends the current scan: walkers and TagReaders stop before their next entry. Can be called from any thread. */
+	void pause();
+
+	void resume();
+
+	/** Stops the current scan. Tracks which were already read are saved, the next scan will read the others. */
+	void cancel();
+
+	bool isPaused();
+
+private:
+	/** Clears controls of the previous scan. */
+	void prepareScan();
+
+	/** Blocks while the scan is paused. Returns false if the scan was cancelled. */
+	bool waitWhilePaused();
+
+	/** State shared by walkers, which may run in parallel on different devices. */
+	struct ScanState;
+
+	/** Identifies the device which stores a path, and guesses if it's a spinning disk. */
+	static quint64 deviceOf(const QString &path, bool *isRotational);
+
+	/** Walks locations and sends audio files to TagReaders. When signatures are known, unmodified files are skipped and removed from the hash. */
+	void scanLocations(const QStringList &locations, bool isFullScan, FileSignatures *knownFiles);
+
+	/** Walks locations which are on the same device. On spinning disks, entries are visited in the order of their inodes. */
+	void walk(const QStringList &locations, bool isRotational, ScanState &state);
+
+	/** Files are not parsed by the engine: they are sent to the pool of TagReaders. */
+	void sendToTagReaders(const QStringList &files);
+
+	/** Queues a TagReader. It may be started from a thread of the pool, to read again files which didn't have any length. */
+	void startTagReader(const QStringList &files, FileHelper::IOMode ioMode, FileHelper::ReadMode readMode);
 
 public slots:
 	void doSearch(const QStringList &delta = QStringList());
 
-private slots:
-	void watchForChanges();
+	/** Compares files in music locations with signatures of the previous scan: only new and modified files are read. */
+	void doRescan(const FileSignatures &knownFiles);
+
+	/** Reads again some files which were reported by the FileSystemMonitor. */
+	void doUpdate(const QStringList &files);
 
 signals:
 	/** A JPG or a PNG was found next to a valid audio file in the same directory. */
 	void scannedCover(const QString &, const QString &);
 
-	void scannedFile(const QString &);
+	/** A batch of audio files has been read by a TagReader. Emitted from a thread of the pool. */
+	void tracksScanned(const QList<TrackMetadata> &);
 
 	void progressChanged(const int &);
 
+	/** Local files which were in the library have been deleted from the FileSystem. */
+	void filesRemoved(const QStringList &);
+
+	/** A full scan of music locations has been completed, and this is the number of entries which were found. */
+	void entriesScanned(int);
+
+	/** The scan was cancelled, searchHasEnded is emitted right after with tracks which were read. */
+	void searchWasCancelled();
+
 	void searchHasEnded();
 };
 
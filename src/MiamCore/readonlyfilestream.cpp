@@ -0,0 +1,108 @@
+#include "readonlyfilestream.h"
+
+#include <QDir>
+
+const long ReadOnlyFileStream::HEAD_SIZE = 128 * 1024;
+const long ReadOnlyFileStream::TAIL_SIZE = 128 * 1024;
+
+ReadOnlyFileStream::ReadOnlyFileStream(const QString &filePath, Strategy strategy)
+	: TagLib::IOStream()
+	, _file(filePath)
+	, _data(nullptr)
+	, _length(0)
+	, _position(0)
+{
+#ifdef _WIN32
+	_name = QDir::toNativeSeparators(filePath).toStdWString();
+#else
+	_name = QFile::encodeName(filePath);
+#endif
+	// Reads are done by blocks big enough, Qt doesn't need to buffer them again
+	if (!_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+		return;
+	}
+	_length = _file.size();
+	if (strategy == MemoryMapped && _length > 0) {
+		_data = _file.map(0, _length);
+	}
+	// Some filesystems cannot be mapped: prefetch regions where tags are usually stored
+	if (_data == nullptr) {
+		_head = _file.read(qMin(HEAD_SIZE, _length));
+		if (_length > _head.size()) {
+			qint64 tailStart = qMax(static_cast<long>(_head.size()), _length - TAIL_SIZE);
+			if (_file.seek(tailStart)) {
+				_tail = _file.read(_length - tailStart);
+			}
+		}
+	}
+}
+
+ReadOnlyFileStream::~ReadOnlyFileStream()
+{
+	if (_data) {
+		_file.unmap(_data);
+	}
+}
+
+TagLib::FileName ReadOnlyFileStream::name() const
+{
+#ifdef _WIN32
+	return TagLib::FileName(_name.c_str());
+#else
+	return _name.constData();
+#endif
+}
+
+TagLib::ByteVector ReadOnlyFileStream::readBlock(TagLib::ulong length)
+{
+	if (!this->isOpen() || _position >= _length || length == 0) {
+		return TagLib::ByteVector();
+	}
+	long n = qMin(static_cast<long>(length), _length - _position);
+	long tailStart = _length - _tail.size();
+
+	TagLib::ByteVector block;
+	if (_data) {
+		block = TagLib::ByteVector(reinterpret_cast<const char*>(_data + _position), n);
+	} else if (_position + n <= _head.size()) {
+		block = TagLib::ByteVector(_head.constData() + _position, n);
+	} else if (!_tail.isEmpty() && _position >= tailStart) {
+		block = TagLib::ByteVector(_tail.constData() + (_position - tailStart), n);
+	} else {
+		// Big tags (with covers for example) are read in one call too
+		QByteArray bytes;
+		if (_file.seek(_position)) {
+			bytes = _file.read(n);
+		}
+		n = bytes.size();
+		block = TagLib::ByteVector(bytes.constData(), n);
+	}
+	_position += n;
+	return block;
+}
+
+bool ReadOnlyFileStream::isOpen() const
+{
+	return _file.isOpen();
+}
+
+void ReadOnlyFileStream::seek(long offset, Position p)
+{
+	long position;
+	switch (p) {
+	case Current:
+		position = _position + offset;
+		break;
+	case End:
+		position = _length + offset;
+		break;
+	case Beginning:
+	default:
+		position = offset;
+		break;
+	}
+	// Like a regular file, one can seek beyond the end but not before the beginning
+	if (position >= 0) {
+		_position = position;
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef READONLYFILESTREAM_H
+#define READONLYFILESTREAM_H
+
+#include <QByteArray>
+#include <QFile>
+
+#include <taglib/tiostream.h>
+
+#include "miamcore_global.h"
+
+/**
+ * \brief		The ReadOnlyFileStream class lets TagLib parse a file with a few big reads, instead of many small ones.
+ * \details		The file is either mapped in memory, or its header and its trailer (where most tags are stored) are read
+ *				at once when the stream is opened. Other regions are read on demand. Tags cannot be saved with this stream.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY ReadOnlyFileStream : public TagLib::IOStream
+{
+public:
+	enum Strategy {
+		Prefetched		= 0,
+		MemoryMapped	= 1
+	};
+
+private:
+	QFile _file;
+#ifdef _WIN32
+	std::wstring _name;
+#else
+	QByteArray _name;
+#endif
+
+	/** Whole file, when it's mapped in memory. */
+	uchar *_data;
+
+	/** First and last bytes of the file, when it isn't mapped. */
+	QByteArray _head, _tail;
+
+	long _length;
+	long _position;
+
+	/** Bytes which are read when the stream is opened, at the beginning and at the end of the file. */
+	static const long HEAD_SIZE;
+	static const long TAIL_SIZE;
+
+public:
+	ReadOnlyFileStream(const QString &filePath, Strategy strategy);
+
+	virtual ~ReadOnlyFileStream();
+
+	virtual TagLib::FileName name() const override;
+
+	virtual TagLib::ByteVector readBlock(TagLib::ulong length) override;
+
+	virtual bool readOnly() const override { return true; }
+
+	virtual bool isOpen() const override;
+
+	virtual void seek(long offset, Position p = Beginning) override;
+
+	virtual long tell() const override { return _position; }
+
+	virtual long length() override { return _length; }
+
+	/// Writing is not supported
+	virtual void writeBlock(const TagLib::ByteVector &) override {}
+	virtual void insert(const TagLib::ByteVector &, TagLib::ulong = 0, TagLib::ulong = 0) override {}
+	virtual void removeBlock(TagLib::ulong = 0, TagLib::ulong = 0) override {}
+	virtual void truncate(long) override {}
+};
+
+#endif // READONLYFILESTREAM_H
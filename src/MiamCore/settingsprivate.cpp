@@ -261,6 +261,12 @@ bool SettingsPrivate::isReorderArtistsArticle() const
 	return value("reorderArtistsArticle", false).toBool();
 }
 
+/** Returns true if audio files are mapped in memory during scans, instead of being read by big blocks. */
+bool SettingsPrivate::isScanMemoryMapped() const
+{
+	return value("scanMemoryMapped", false).toBool();
+}
+
 /** Returns true if star outline must be displayed in the library. */
 bool SettingsPrivate::isShowNeverScored() const
 {
@@ -700,6 +706,12 @@ void SettingsPrivate::setReorderArtistsArticle(bool b)
 	setValue("reorderArtistsArticle", b);
 }
 
+/** Sets if audio files are mapped in memory during scans. */
+void SettingsPrivate::setScanMemoryMapped(bool b)
+{
+	setValue("scanMemoryMapped", b);
+}
+
 void SettingsPrivate::setSearchAndExcludeLibrary(bool b)
 {
 	LibrarySearchMode lsm;
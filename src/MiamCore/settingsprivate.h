@@ -131,6 +131,9 @@ public:
 	/** Returns true if the article should be displayed after artist's name. */
 	bool isReorderArtistsArticle() const;
 
+	/** Returns true if audio files are mapped in memory during scans, instead of being read by big blocks. */
+	bool isScanMemoryMapped() const;
+
 	/** Returns true if star outline must be displayed in the library. */
 	bool isShowNeverScored() const;
 
@@ -261,6 +264,9 @@ public slots:
 
 	void setReorderArtistsArticle(bool b);
 
+	/** Sets if audio files are mapped in memory during scans. */
+	void setScanMemoryMapped(bool b);
+
 	void setSearchAndExcludeLibrary(bool b);
 	void setShowNeverScored(bool b);
 
@@ -0,0 +1,77 @@
+#include "tagreader.h"
+
+#include "filehelper.h"
+
+#include <QDateTime>
+#include <QFile>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+/** Builds a signature from cached informations and the inode of the file, if available on this system. */
+FileSignature FileSignature::fromFileInfo(const QFileInfo &fileInfo)
+{
+	FileSignature signature;
+	signature.absFilePath = fileInfo.absoluteFilePath();
+	signature.size = fileInfo.size();
+	signature.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+	struct stat st;
+	if (::stat(QFile::encodeName(signature.absFilePath).constData(), &st) == 0) {
+		signature.inode = st.st_ino;
+	}
+#endif
+	return signature;
+}
+
+TagReader::TagReader(const QStringList &files, FileHelper::IOMode ioMode, const Callback &callback)
+	: QRunnable()
+	, _files(files)
+	, _ioMode(ioMode)
+	, _readMode(FileHelper::ReadFast)
+	, _callback(callback)
+{
+	setAutoDelete(true);
+}
+
+/** Opens a file with TagLib and copies everything the library needs. With ReadFast, the length may be unknown. */
+TrackMetadata TagReader::readTags(const QString &absFilePath, FileHelper::IOMode ioMode, FileHelper::ReadMode readMode)
+{
+	TrackMetadata track;
+	track.absFilePath = absFilePath;
+
+	// By default only headers are read, the length of some files is approximate or unknown
+	FileHelper fh(absFilePath, readMode, ioMode);
+	track.signature = FileSignature::fromFileInfo(fh.fileInfo());
+	track.isValid = fh.isValid();
+	track.trackNumber = fh.trackNumber();
+	track.title = fh.title();
+	if (track.title.isEmpty()) {
+		track.title = fh.fileInfo().baseName();
+	}
+	track.artist = fh.artist();
+	track.artistAlbum = fh.artistAlbum();
+	track.album = fh.album();
+	track.year = fh.year();
+	track.length = fh.length();
+	track.disc = fh.discNumber();
+	track.rating = fh.rating();
+	track.hasCover = fh.hasCover();
+	return track;
+}
+
+void TagReader::run()
+{
+	QList<TrackMetadata> tracks;
+	tracks.reserve(_files.size());
+	for (QString file : _files) {
+		if (_gate && !_gate()) {
+			break;
+		}
+		tracks.append(readTags(file, _ioMode, _readMode));
+	}
+	if (_callback) {
+		_callback(tracks);
+	}
+}
@@ -0,0 +1,113 @@
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QRunnable>
+#include <QStringList>
+
+#include <functional>
+
+#include "filehelper.h"
+#include "miamcore_global.h"
+
+/**
+ * \brief		The FileSignature struct is used to detect if a local file has changed since the last scan, without reading it.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+struct MIAMCORE_LIBRARY FileSignature
+{
+	QString absFilePath;
+	qint64 size;
+	qint64 lastModified;
+	quint64 inode;
+
+	FileSignature() : size(0), lastModified(0), inode(0) {}
+
+	/** Builds a signature from cached informations and the inode of the file, if available on this system. */
+	static FileSignature fromFileInfo(const QFileInfo &fileInfo);
+
+	inline bool operator==(const FileSignature &other) const {
+		return size == other.size && lastModified == other.lastModified && inode == other.inode;
+	}
+	inline bool operator!=(const FileSignature &other) const { return !(*this == other); }
+};
+
+/** Register this struct to send it with queued connections. */
+Q_DECLARE_METATYPE(FileSignature)
+
+/** Signatures of files, indexed by their absolute path. */
+typedef QHash<QString, FileSignature> FileSignatures;
+
+/**
+ * \brief		The TrackMetadata struct is a plain copy of relevant tags extracted from a local file.
+ * \details		Unlike TrackDAO, it's not a QObject: records can be built in any thread and sent by value to the database.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+struct MIAMCORE_LIBRARY TrackMetadata
+{
+	QString absFilePath;
+	FileSignature signature;
+	QString album;
+	QString artist;
+	QString artistAlbum;
+	QString length;
+	QString title;
+	QString trackNumber;
+	QString year;
+	int disc;
+	int rating;
+	bool hasCover;
+	bool isValid;
+
+	TrackMetadata() : disc(0), rating(-1), hasCover(false), isValid(false) {}
+};
+
+/** Register this struct to send it with queued connections. */
+Q_DECLARE_METATYPE(TrackMetadata)
+
+/**
+ * \brief		The TagReader class is a task which reads tags for a batch of files in a thread pool.
+ * \details		When all files have been processed, a callback is called from the pool thread with the whole batch.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMCORE_LIBRARY TagReader : public QRunnable
+{
+public:
+	typedef std::function<void(const QList<TrackMetadata> &)> Callback;
+
+	/** Called before each file: may block while the scan is paused, returns false when it was cancelled. */
+	typedef std::function<bool()> Gate;
+
+private:
+	QStringList _files;
+
+	FileHelper::IOMode _ioMode;
+
+	FileHelper::ReadMode _readMode;
+
+	Callback _callback;
+
+	Gate _gate;
+
+public:
+	TagReader(const QStringList &files, FileHelper::IOMode ioMode, const Callback &callback);
+
+	/** Opens a file with TagLib and copies everything the library needs. With ReadFast, the length may be unknown. */
+	static TrackMetadata readTags(const QString &absFilePath, FileHelper::IOMode ioMode = FileHelper::DefaultIO,
+								  FileHelper::ReadMode readMode = FileHelper::ReadFast);
+
+	inline void setGate(const Gate &gate) { _gate = gate; }
+
+	/** Only headers are read by default. ReadAll scans the stream, to get the length of files which don't have one in headers. */
+	inline void setReadMode(FileHelper::ReadMode readMode) { _readMode = readMode; }
+
+	virtual void run() override;
+};
+
+#endif // TAGREADER_H
@@ -11,6 +11,7 @@ SOURCES += \
     changehierarchybutton.cpp \
     discitem.cpp \
     extendedtabbar.cpp \
+    libraryfilter.cpp \
     libraryfilterlineedit.cpp \
     libraryfilterproxymodel.cpp \
     libraryheader.cpp \
@@ -23,8 +24,7 @@ SOURCES += \
     miamitemmodel.cpp \
     separatoritem.cpp \
     scrollbar.cpp \
-    trackitem.cpp \
-    yearitem.cpp
+    trackitem.cpp
 
 HEADERS += \
     deprecated/circleprogressbar.h \
@@ -34,6 +34,7 @@ HEADERS += \
     discitem.h \
     extendedtabbar.h \
     extendedtabwidget.h \
+    libraryfilter.h \
     libraryfilterlineedit.h \
     libraryfilterproxymodel.h \
     libraryheader.h \
@@ -47,7 +48,6 @@ HEADERS += \
     separatoritem.h \
     scrollbar.h \
     trackitem.h \
-    yearitem.h \
     miamlibrary_global.hpp
 
 FORMS += \
@@ -3,18 +3,18 @@
 
 #include <QRegularExpression>
 
-AlbumItem::AlbumItem(const AlbumDAO *dao) :
-	QStandardItem(dao->title())
+AlbumItem::AlbumItem(const LibraryNode &node) :
+	QStandardItem(node.title())
 {
-	if (dao->titleNormalized().isEmpty() || !dao->titleNormalized().contains(QRegularExpression("[\\w]"))) {
+	if (node.titleNormalized().isEmpty() || !node.titleNormalized().contains(QRegularExpression("[\\w]"))) {
 		setData("0", Miam::DF_NormalizedString);
 	} else {
-		setData(dao->titleNormalized(), Miam::DF_NormalizedString);
+		setData(node.titleNormalized(), Miam::DF_NormalizedString);
 	}
-	setData(dao->year(), Miam::DF_Year);
-	setData(dao->cover(), Miam::DF_CoverPath);
-	setData(dao->icon(), Miam::DF_IconPath);
-	setData(!dao->icon().isEmpty(), Miam::DF_IsRemote);
+	setData(node.year(), Miam::DF_Year);
+	setData(node.cover(), Miam::DF_CoverPath);
+	setData(node.icon(), Miam::DF_IconPath);
+	setData(!node.icon().isEmpty(), Miam::DF_IsRemote);
 }
 
 QString AlbumItem::coverPath() const
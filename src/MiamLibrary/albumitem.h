@@ -2,7 +2,7 @@
 #define ALBUMITEM_H
 
 #include <QStandardItem>
-#include <model/albumdao.h>
+#include <model/librarynode.h>
 
 #include "miamlibrary_global.hpp"
 
@@ -14,7 +14,7 @@
 class MIAMLIBRARY_LIBRARY AlbumItem : public QStandardItem
 {
 public:
-	explicit AlbumItem(const AlbumDAO *dao);
+	explicit AlbumItem(const LibraryNode &node);
 
 	QString coverPath() const;
 
@@ -3,15 +3,15 @@
 
 #include <QRegularExpression>
 
-ArtistItem::ArtistItem(const ArtistDAO *dao)
-	: QStandardItem(dao->title())
+ArtistItem::ArtistItem(const LibraryNode &node)
+	: QStandardItem(node.title())
 {
-	if (dao->titleNormalized().isEmpty() || !dao->titleNormalized().contains(QRegularExpression("[\\w]"))) {
+	if (node.titleNormalized().isEmpty() || !node.titleNormalized().contains(QRegularExpression("[\\w]"))) {
 		setData("0", Miam::DF_NormalizedString);
 	} else {
-		setData(dao->titleNormalized(), Miam::DF_NormalizedString);
+		setData(node.titleNormalized(), Miam::DF_NormalizedString);
 	}
-	setData(dao->customData(), Miam::DF_CustomDisplayText);
+	setData(node.customData(), Miam::DF_CustomDisplayText);
 }
 
 int ArtistItem::type() const
@@ -2,7 +2,7 @@
 #define ARTISTITEM_H
 
 #include <QStandardItem>
-#include <model/artistdao.h>
+#include <model/librarynode.h>
 
 #include "miamlibrary_global.hpp"
 
@@ -14,7 +14,7 @@
 class MIAMLIBRARY_LIBRARY ArtistItem : public QStandardItem
 {
 public:
-	ArtistItem(const ArtistDAO *dao);
+	ArtistItem(const LibraryNode &node);
 
 	virtual int type() const override;
 };
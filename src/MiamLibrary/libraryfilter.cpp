@@ -0,0 +1,66 @@
+#include "libraryfilter.h"
+
+LibraryFilter::LibraryFilter(const Snapshot &snapshot, const QRegExp &regExp, const QBitArray &previousMatchingItems, QObject *parent)
+	: QObject(parent)
+	, QRunnable()
+	, _snapshot(snapshot)
+	, _regExp(regExp)
+	, _previousMatchingItems(previousMatchingItems)
+{
+	// Deleted by its owner, in the thread of the views
+	setAutoDelete(false);
+}
+
+void LibraryFilter::run()
+{
+	const int size = _snapshot.size();
+	const int previousSize = qMin(size, _previousMatchingItems.size());
+
+	// First pass: items matching on their own
+	QBitArray matchingItems(size);
+	for (int i = 0; i < size; i++) {
+		if (_isCancelled.load() != 0) {
+			emit finished();
+			return;
+		}
+		if (_snapshot.removedItems.testBit(i) || (i < previousSize && !_previousMatchingItems.testBit(i))) {
+			continue;
+		}
+		if (_snapshot.texts.at(i).contains(_regExp)) {
+			matchingItems.setBit(i);
+		}
+	}
+
+	// Second pass, forward: an item is accepted when an ancestor is matching, because parents are before their children
+	QBitArray acceptedItems = matchingItems;
+	for (int i = 0; i < size; i++) {
+		qint32 parent = _snapshot.parents.at(i);
+		if (parent >= 0 && acceptedItems.testBit(parent) && !_snapshot.removedItems.testBit(i)) {
+			acceptedItems.setBit(i);
+		}
+	}
+
+	// Third pass, backward: accepted items are propagated to their ancestors, once all their descendants were visited
+	for (int i = size - 1; i >= 0; i--) {
+		qint32 parent = _snapshot.parents.at(i);
+		if (parent >= 0 && acceptedItems.testBit(i)) {
+			acceptedItems.setBit(parent);
+		}
+	}
+
+	// Separators are accepted if any top level item which is grouped below is accepted
+	for (const QPair<qint32, QVector<qint32>> &separator : _snapshot.separators) {
+		for (qint32 item : separator.second) {
+			if (acceptedItems.testBit(item)) {
+				acceptedItems.setBit(separator.first);
+				break;
+			}
+		}
+	}
+
+	if (_isCancelled.load() == 0) {
+		_matchingItems = matchingItems;
+		_acceptedItems = acceptedItems;
+	}
+	emit finished();
+}
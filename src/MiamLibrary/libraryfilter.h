@@ -0,0 +1,82 @@
+#ifndef LIBRARYFILTER_H
+#define LIBRARYFILTER_H
+
+#include <QAtomicInt>
+#include <QBitArray>
+#include <QObject>
+#include <QPair>
+#include <QRegExp>
+#include <QRunnable>
+#include <QVector>
+
+#include "miamlibrary_global.hpp"
+
+/**
+ * \brief		The LibraryFilter class evaluates a filter on every item of the library in a thread pool.
+ * \details		It works on a snapshot of the flattened tree: parents, and texts which are tested. Texts are copied, so the
+ *				library can be loaded again meanwhile, and the snapshot is shared with the model until the latter is modified.
+ *				Parents are always before their children in the snapshot, so the whole tree is evaluated with a few linear passes.
+ *				A filter can be cancelled when one is typing again: its results are never used.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class MIAMLIBRARY_LIBRARY LibraryFilter : public QObject, public QRunnable
+{
+	Q_OBJECT
+public:
+	/** Flattened tree of items, as it was when the filter was started. */
+	struct Snapshot
+	{
+		/** Role of texts which are tested. */
+		int role;
+		QVector<qint32> parents;
+		QVector<QString> texts;
+		QBitArray removedItems;
+
+		/** Separators, with top level items which are grouped below. */
+		QVector<QPair<qint32, QVector<qint32>>> separators;
+
+		Snapshot() : role(-1) {}
+
+		inline int size() const { return parents.size(); }
+	};
+
+private:
+	Snapshot _snapshot;
+
+	QRegExp _regExp;
+
+	/** Items which were matching the previous filter. When the new text contains the previous one, only them are tested. */
+	QBitArray _previousMatchingItems;
+
+	QBitArray _matchingItems;
+	QBitArray _acceptedItems;
+
+	QAtomicInt _isCancelled;
+
+public:
+	LibraryFilter(const Snapshot &snapshot, const QRegExp &regExp, const QBitArray &previousMatchingItems, QObject *parent = nullptr);
+
+	/** Items which are accepted: matching, or with a matching ancestor or descendant. */
+	inline const QBitArray &acceptedItems() const { return _acceptedItems; }
+
+	/** Stops the filter as soon as possible. */
+	inline void cancel() { _isCancelled.store(1); }
+
+	inline bool isCancelled() const { return _isCancelled.load() != 0; }
+
+	/** Items matching the filter on their own. */
+	inline const QBitArray &matchingItems() const { return _matchingItems; }
+
+	inline const QRegExp &regExp() const { return _regExp; }
+
+	inline int role() const { return _snapshot.role; }
+
+	virtual void run() override;
+
+signals:
+	/** Emitted from the thread pool, when results are complete or when the filter was cancelled. */
+	void finished();
+};
+
+#endif // LIBRARYFILTER_H
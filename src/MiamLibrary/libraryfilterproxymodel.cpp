@@ -1,13 +1,34 @@
 #include "libraryfilterproxymodel.h"
+#include "libraryitemmodel.h"
 
 #include <settingsprivate.h>
 #include <model/sqldatabase.h>
 
 #include <QtDebug>
 
+#include <algorithm>
+
 LibraryFilterProxyModel::LibraryFilterProxyModel(QObject *parent) :
 	MiamSortFilterProxyModel(parent)
-{}
+{
+	connect(this, &QAbstractItemModel::modelAboutToBeReset, this, [=]() {
+		_highlightedItems.clear();
+	});
+}
+
+/** Counts leaves under an item of the source model, which are accepted by the filter. */
+int LibraryFilterProxyModel::countLeaves(const QModelIndex &sourceIndex) const
+{
+	if (!sourceIndex.isValid()) {
+		return 0;
+	}
+	QModelIndexList children = this->acceptedChildren(sourceIndex);
+	int leaves = 0;
+	for (const QModelIndex &child : children) {
+		leaves += this->countLeaves(child);
+	}
+	return (leaves == 0) ? 1 : leaves;
+}
 
 /** Redefined to override Qt::FontRole. */
 QVariant LibraryFilterProxyModel::data(const QModelIndex &index, int role) const
@@ -19,49 +40,73 @@ QVariant LibraryFilterProxyModel::data(const QModelIndex &index, int role) const
 	}
 }
 
-bool LibraryFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+/** Appends tracks under an item of the source model, which are accepted by the filter, in the order of this proxy.
+ * Collapsed items are not fetched. */
+void LibraryFilterProxyModel::findTracks(const QModelIndex &sourceIndex, QStringList &tracks) const
 {
-	if (filterAcceptsRowItself(sourceRow, sourceParent)) {
-		return true;
+	if (!sourceIndex.isValid()) {
+		return;
 	}
-
-	// Accept if any of the parents is accepted on it's own merits
-	QModelIndex parent = sourceParent;
-	while (parent.isValid()) {
-		if (filterAcceptsRowItself(parent.row(), parent.parent())) {
-			return true;
+	QModelIndexList children = this->acceptedChildren(sourceIndex);
+	if (children.isEmpty()) {
+		LibraryItemModel *model = static_cast<LibraryItemModel*>(sourceModel());
+		if (model->itemType(sourceIndex) == Miam::IT_Track) {
+			tracks << sourceIndex.data(Miam::DF_URI).toString();
 		}
-		parent = parent.parent();
+		return;
 	}
 
-	// Accept if any of the children is accepted on it's own merits
-	if (hasAcceptedChildren(sourceRow, sourceParent)) {
+	// Same comparison as QSortFilterProxyModel, which swaps arguments in descending order
+	if (sortOrder() == Qt::AscendingOrder) {
+		std::stable_sort(children.begin(), children.end(), [this](const QModelIndex &a, const QModelIndex &b) {
+			return this->lessThan(a, b);
+		});
+	} else {
+		std::stable_sort(children.begin(), children.end(), [this](const QModelIndex &a, const QModelIndex &b) {
+			return this->lessThan(b, a);
+		});
+	}
+	for (const QModelIndex &child : children) {
+		this->findTracks(child, tracks);
+	}
+}
+
+bool LibraryFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+	if (SettingsPrivate::instance()->librarySearchMode() == SettingsPrivate::LSM_HighlightOnly) {
 		return true;
 	}
 
-	// Accept separators if any top level items and its children are accepted
-	QStandardItemModel *model = qobject_cast<QStandardItemModel*>(sourceModel());
-	QStandardItem *item = model->itemFromIndex(model->index(sourceRow, 0, sourceParent));
-	if (item && item->type() == Miam::IT_Separator) {
-		for (QModelIndex index : _topLevelItems.values(static_cast<SeparatorItem*>(item))) {
-			if (filterAcceptsRow(index.row(), sourceParent)) {
-				return true;
-			}
-		}
+	// The filter was evaluated once for the whole tree: rows are only looked up
+	LibraryItemModel *model = static_cast<LibraryItemModel*>(sourceModel());
+	return model->isAccepted(model->index(sourceRow, 0, sourceParent));
+}
+
+/** Redefined to evaluate the filter on the whole tree at once, in a thread pool. */
+void LibraryFilterProxyModel::filterLibrary(const QString &filter)
+{
+	// Convert stars into [1-5], ..., [5-5] regular expression
+	QRegExp regExp;
+	int role = Qt::DisplayRole;
+	if (filter.contains(QRegExp("^(\\*){1,5}$"))) {
+		role = Miam::DF_Rating;
+		regExp = QRegExp("[" + QString::number(filter.size()) + "-5]", Qt::CaseInsensitive, QRegExp::RegExp);
+	} else if (!filter.isEmpty()) {
+		regExp = QRegExp(filter, Qt::CaseInsensitive, QRegExp::FixedString);
 	}
-	return (SettingsPrivate::instance()->librarySearchMode() == SettingsPrivate::LSM_HighlightOnly);
+
+	// Rows are not filtered here: the model updates this proxy when results are available
+	LibraryItemModel *model = static_cast<LibraryItemModel*>(sourceModel());
+	model->filterItems(regExp, role);
 }
 
 /** Redefined for custom sorting. */
 bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelIndex &idxRight) const
 {
 	bool result = false;
-	QStandardItemModel *model = qobject_cast<QStandardItemModel *>(this->sourceModel());
-	QStandardItem *left = model->itemFromIndex(idxLeft);
-	QStandardItem *right = model->itemFromIndex(idxRight);
-
-	int lType = left->type();
-	int rType = right->type();
+	LibraryItemModel *model = static_cast<LibraryItemModel*>(this->sourceModel());
+	int lType = model->itemType(idxLeft);
+	int rType = model->itemType(idxRight);
 	switch (lType) {
 	case Miam::IT_Artist:
 		result = QSortFilterProxyModel::lessThan(idxLeft, idxRight);
@@ -69,8 +114,8 @@ bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelI
 
 	case Miam::IT_Album:
 		if (rType == Miam::IT_Album) {
-			int lYear = left->data(Miam::DF_Year).toInt();
-			int rYear = right->data(Miam::DF_Year).toInt();
+			int lYear = idxLeft.data(Miam::DF_Year).toInt();
+			int rYear = idxRight.data(Miam::DF_Year).toInt();
 			if (SettingsPrivate::instance()->insertPolicy() == SettingsPrivate::IP_Artists && lYear >= 0 && rYear >= 0) {
 				if (sortOrder() == Qt::AscendingOrder) {
 					if (lYear == rYear) {
@@ -91,8 +136,8 @@ bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelI
 
 	case Miam::IT_Disc:
 		if (rType == Miam::IT_Disc) {
-			int dLeft = left->data(Miam::DF_DiscNumber).toInt();
-			int dRight = right->data(Miam::DF_DiscNumber).toInt();
+			int dLeft = idxLeft.data(Miam::DF_DiscNumber).toInt();
+			int dRight = idxRight.data(Miam::DF_DiscNumber).toInt();
 			result = (dLeft < dRight && sortOrder() == Qt::AscendingOrder) ||
 					  (dRight < dLeft && sortOrder() == Qt::DescendingOrder);
 		}
@@ -102,19 +147,19 @@ bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelI
 		// Separators have a different sorting order when Hierarchical Order starts with Years
 		if (SettingsPrivate::instance()->insertPolicy() == SettingsPrivate::IP_Years) {
 			if (sortOrder() == Qt::AscendingOrder) {
-				result = left->data(Miam::DF_NormalizedString).toInt() <= right->data(Miam::DF_NormalizedString).toInt();
+				result = idxLeft.data(Miam::DF_NormalizedString).toInt() <= idxRight.data(Miam::DF_NormalizedString).toInt();
 			} else {
-				result = left->data(Miam::DF_NormalizedString).toInt() + 10 <= right->data(Miam::DF_NormalizedString).toInt();
+				result = idxLeft.data(Miam::DF_NormalizedString).toInt() + 10 <= idxRight.data(Miam::DF_NormalizedString).toInt();
 			}
 		} else {
 			// Special case if an artist's name has only one character, be sure to put it after the separator
 			// Example: M (or -M-, or Mathieu Chedid)
-			if (QString::compare(left->data(Miam::DF_NormalizedString).toString(),
-								 right->data(Miam::DF_NormalizedString).toString().left(1)) == 0) {
+			if (QString::compare(idxLeft.data(Miam::DF_NormalizedString).toString(),
+								 idxRight.data(Miam::DF_NormalizedString).toString().left(1)) == 0) {
 				result = (sortOrder() == Qt::AscendingOrder);
-			} else if (left->data(Miam::DF_NormalizedString).toString() == "0" && sortOrder() == Qt::DescendingOrder) {
+			} else if (idxLeft.data(Miam::DF_NormalizedString).toString() == "0" && sortOrder() == Qt::DescendingOrder) {
 				// Again a very special case to keep the separator for "Various" on top of siblings
-				result = "9" < right->data(Miam::DF_NormalizedString).toString().left(1);
+				result = "9" < idxRight.data(Miam::DF_NormalizedString).toString().left(1);
 			} else {
 				result = QSortFilterProxyModel::lessThan(idxLeft, idxRight);
 			}
@@ -123,16 +168,16 @@ bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelI
 
 	// Sort tracks by their numbers
 	case Miam::IT_Track: {
-		int dLeft = left->data(Miam::DF_DiscNumber).toInt();
-		int lTrackNumber = left->data(Miam::DF_TrackNumber).toInt();
-		int dRight = right->data(Miam::DF_DiscNumber).toInt();
+		int dLeft = idxLeft.data(Miam::DF_DiscNumber).toInt();
+		int lTrackNumber = idxLeft.data(Miam::DF_TrackNumber).toInt();
+		int dRight = idxRight.data(Miam::DF_DiscNumber).toInt();
 		if (rType == Miam::IT_Track) {
-			int rTrackNumber = right->data(Miam::DF_TrackNumber).toInt();
+			int rTrackNumber = idxRight.data(Miam::DF_TrackNumber).toInt();
 			if (dLeft == dRight) {
 				// If there are both remote and local tracks under the same album, display first tracks from hard disk
 				// Otherwise tracks will be displayed like #1 - local, #1 - remote, #2 - local, #2 - remote, etc
-				bool lIsRemote = left->data(Miam::DF_IsRemote).toBool();
-				bool rIsRemote = right->data(Miam::DF_IsRemote).toBool();
+				bool lIsRemote = idxLeft.data(Miam::DF_IsRemote).toBool();
+				bool rIsRemote = idxRight.data(Miam::DF_IsRemote).toBool();
 				if ((lIsRemote && rIsRemote) || (!lIsRemote && !rIsRemote)) {
 					result = (lTrackNumber < rTrackNumber && sortOrder() == Qt::AscendingOrder) ||
 						(rTrackNumber < lTrackNumber && sortOrder() == Qt::DescendingOrder);
@@ -153,8 +198,8 @@ bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelI
 		break;
 	}
 	case Miam::IT_Year: {
-		int lYear = left->data(Miam::DF_NormalizedString).toInt();
-		int rYear = right->data(Miam::DF_NormalizedString).toInt();
+		int lYear = idxLeft.data(Miam::DF_NormalizedString).toInt();
+		int rYear = idxRight.data(Miam::DF_NormalizedString).toInt();
 		result = (lYear < rYear && sortOrder() == Qt::AscendingOrder) ||
 				  (rYear > lYear && sortOrder() == Qt::DescendingOrder);
 		break;
@@ -166,32 +211,61 @@ bool LibraryFilterProxyModel::lessThan(const QModelIndex &idxLeft, const QModelI
 	return result;
 }
 
-bool LibraryFilterProxyModel::filterAcceptsRowItself(int sourceRow, const QModelIndex &sourceParent) const
+/** Redefined to mark items of the model, even those which were not fetched yet. */
+void LibraryFilterProxyModel::highlightMatchingText(const QString &text)
 {
-	return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+	// Adapt filter if one is typing '*'. The filter role isn't changed: it would filter every row again
+	QRegExp regExp;
+	int role;
+	if (text.contains(QRegExp("^(\\*){1,5}$"))) {
+		role = Miam::DF_Rating;
+		regExp = QRegExp("[" + QString::number(text.size()) + "-5]", Qt::CaseInsensitive, QRegExp::RegExp);
+	} else {
+		role = Qt::DisplayRole;
+		regExp = QRegExp(text, Qt::CaseInsensitive, QRegExp::FixedString);
+	}
+
+	// Mark items with a bold font
+	LibraryItemModel *model = static_cast<LibraryItemModel*>(sourceModel());
+	QSet<QChar> lettersToHighlight;
+	_highlightedItems = model->highlightedItems(regExp, role, &lettersToHighlight);
+	this->updateHighlightedItems();
+	emit aboutToHighlightLetters(lettersToHighlight);
 }
 
-bool LibraryFilterProxyModel::hasAcceptedChildren(int sourceRow, const QModelIndex &sourceParent) const
+bool LibraryFilterProxyModel::isHighlighted(const QModelIndex &sourceIndex) const
 {
-	QModelIndex item = sourceModel()->index(sourceRow, 0, sourceParent);
-	if (!item.isValid()) {
+	if (!sourceIndex.isValid()) {
 		return false;
 	}
+	quintptr item = sourceIndex.internalId();
+	return item < (quintptr)_highlightedItems.size() && _highlightedItems.testBit(item);
+}
 
-	// Check if there are children
-	int childCount = item.model()->rowCount(item);
-	if (childCount == 0) {
-		return false;
+/** Children of an item of the source model which are accepted by the filter, even those which were not fetched yet. */
+QModelIndexList LibraryFilterProxyModel::acceptedChildren(const QModelIndex &sourceIndex) const
+{
+	LibraryItemModel *model = static_cast<LibraryItemModel*>(sourceModel());
+	QModelIndexList children = model->childIndexes(sourceIndex);
+	if (SettingsPrivate::instance()->librarySearchMode() == SettingsPrivate::LSM_HighlightOnly) {
+		return children;
 	}
-
-	for (int i = 0; i < childCount; ++i) {
-		if (filterAcceptsRowItself(i, item)) {
-			return true;
-		}
-		// Recursive call
-		if (hasAcceptedChildren(i, item)) {
-			return true;
+	QModelIndexList accepted;
+	for (const QModelIndex &child : children) {
+		if (model->isAccepted(child)) {
+			accepted.append(child);
 		}
 	}
-	return false;
+	return accepted;
+}
+
+/** Filters rows again with the last results of the model. Rows are only sorted again if some of them may come back. */
+void LibraryFilterProxyModel::updateFilter(bool isNarrowed)
+{
+	// Rows are only hidden when the text is growing: their order is still valid. Otherwise, rows which are accepted again
+	// are appended by QSortFilterProxyModel at the end of their parent, because dynamic sort is disabled
+	this->invalidateFilter();
+	if (!isNarrowed) {
+		this->sort(0, this->sortOrder());
+	}
 }
@@ -1,39 +1,63 @@
 #ifndef LIBRARYFILTERPROXYMODEL_H
 #define LIBRARYFILTERPROXYMODEL_H
 
-#include <QStandardItem>
 #include <miamsortfilterproxymodel.h>
 
+#include <QBitArray>
+
 #include "miamcore_global.h"
-#include "separatoritem.h"
 #include "miamlibrary_global.hpp"
 
 /**
  * \brief		The LibraryFilterProxyModel class is used to filter Library by looking in all items
- * \details		When filtering, the method filterAcceptsRow will not stop if a search term was not found in a node. The algorithm
- *				will continue recursively until all subnodes and leaves are evaluated.
+ * \details		When filtering, an item is accepted if itself, one of its parents or one of its children is matching. The source
+ *				model evaluates the filter for the whole tree at once in a thread pool, so filterAcceptsRow only has to look up
+ *				the result.
  * \author      Matthieu Bachelier
  * \copyright   GNU General Public License v3
  */
 class MIAMLIBRARY_LIBRARY LibraryFilterProxyModel : public MiamSortFilterProxyModel
 {
 	Q_OBJECT
+private:
+	/** Items marked in LSM_HighlightOnly mode, by position in the source model (which is the internal id of its indexes). */
+	QBitArray _highlightedItems;
+
 public:
 	explicit LibraryFilterProxyModel(QObject *parent = 0);
 
+	/** Counts leaves under an item of the source model, which are accepted by the filter. */
+	int countLeaves(const QModelIndex &sourceIndex) const;
+
 	/** Redefined to override Qt::FontRole. */
 	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
+	/** Appends tracks under an item of the source model, which are accepted by the filter, in the order of this proxy.
+	 * Collapsed items are not fetched. */
+	void findTracks(const QModelIndex &sourceIndex, QStringList &tracks) const;
+
+	/** Redefined to mark items of the model, even those which were not fetched yet. */
+	virtual void highlightMatchingText(const QString &text) override;
+
+	virtual bool isHighlighted(const QModelIndex &sourceIndex) const override;
+
 protected:
 	/** Redefined from QSortFilterProxyModel. */
 	virtual bool filterAcceptsRow(int sourceRow, const QModelIndex &parent) const override;
 
+	/** Redefined to evaluate the filter on the whole tree at once, in a thread pool. */
+	virtual void filterLibrary(const QString &filter) override;
+
 	/** Redefined for custom sorting. */
 	virtual bool lessThan(const QModelIndex &idxLeft, const QModelIndex &idxRight) const override;
 
 private:
-	bool filterAcceptsRowItself(int sourceRow, const QModelIndex &sourceParent) const;
-	bool hasAcceptedChildren(int sourceRow, const QModelIndex &sourceParent) const;
+	/** Children of an item of the source model which are accepted by the filter, even those which were not fetched yet. */
+	QModelIndexList acceptedChildren(const QModelIndex &sourceIndex) const;
+
+public slots:
+	/** Filters rows again with the last results of the model. Rows are only sorted again if some of them may come back. */
+	void updateFilter(bool isNarrowed);
 };
 
 #endif // LIBRARYFILTERPROXYMODEL_H
@@ -16,7 +16,7 @@
 
 #include <QtDebug>
 
-LibraryItemDelegate::LibraryItemDelegate(LibraryTreeView *libraryTreeView, QSortFilterProxyModel *proxy)
+LibraryItemDelegate::LibraryItemDelegate(LibraryTreeView *libraryTreeView, MiamSortFilterProxyModel *proxy)
 	: MiamItemDelegate(proxy)
 	, _libraryTreeView(libraryTreeView)
 {
@@ -38,7 +38,7 @@ void LibraryItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &o
 	painter->save();
 	auto settings = SettingsPrivate::instance();
 	painter->setFont(settings->font(SettingsPrivate::FF_Library));
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxy->mapToSource(index));
+	QModelIndex sourceIndex = _proxy->mapToSource(index);
 	QStyleOptionViewItem o = option;
 	initStyleOption(&o, index);
 	o.palette = QApplication::palette();
@@ -50,31 +50,31 @@ void LibraryItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &o
 
 	// Removes the dotted rectangle to the focused item
 	o.state &= ~QStyle::State_HasFocus;
-	switch (item->type()) {
+	switch (static_cast<LibraryItemModel*>(_libraryModel)->itemType(sourceIndex)) {
 	case Miam::IT_Album:
 		this->paintRect(painter, o);
-		this->drawAlbum(painter, o, static_cast<AlbumItem*>(item));
+		this->drawAlbum(painter, o, sourceIndex);
 		break;
 	case Miam::IT_Artist:
 		this->paintRect(painter, o);
-		this->drawArtist(painter, o, static_cast<ArtistItem*>(item));
+		this->drawArtist(painter, o, sourceIndex);
 		break;
 	case Miam::IT_Disc:
 		this->paintRect(painter, o);
-		this->drawDisc(painter, o, static_cast<DiscItem*>(item));
+		this->drawDisc(painter, o, sourceIndex);
 		break;
 	case Miam::IT_Separator:
-		this->drawLetter(painter, o, static_cast<SeparatorItem*>(item));
+		this->drawLetter(painter, o, sourceIndex);
 		break;
 	case Miam::IT_Track: {
 		SettingsPrivate::LibrarySearchMode lsm = settings->librarySearchMode();
-		if (settings->isBigCoverEnabled() && ((_proxy->filterRegExp().isEmpty() && lsm == SettingsPrivate::LSM_Filter) ||
+		if (settings->isBigCoverEnabled() && ((!static_cast<LibraryItemModel*>(_libraryModel)->isFiltered() && lsm == SettingsPrivate::LSM_Filter) ||
 				lsm == SettingsPrivate::LSM_HighlightOnly)) {
-			this->paintCoverOnTrack(painter, o, static_cast<TrackItem*>(item));
+			this->paintCoverOnTrack(painter, o, sourceIndex);
 		} else {
 			this->paintRect(painter, o);
 		}
-		this->drawTrack(painter, o, static_cast<TrackItem*>(item));
+		this->drawTrack(painter, o, sourceIndex);
 		break;
 	}
 	default:
@@ -88,8 +88,8 @@ void LibraryItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &o
 QSize LibraryItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
 	SettingsPrivate *settings = SettingsPrivate::instance();
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxy->mapToSource(index));
-	if (settings->isCoversEnabled() && item->type() == Miam::IT_Album) {
+	LibraryItemModel *model = static_cast<LibraryItemModel*>(_libraryModel);
+	if (settings->isCoversEnabled() && model->itemType(_proxy->mapToSource(index)) == Miam::IT_Album) {
 		QFontMetrics fmf(settings->font(SettingsPrivate::FF_Library));
 		return QSize(option.rect.width(), qMax(fmf.height(), settings->coverSize() + 2));
 	} else {
@@ -98,7 +98,7 @@ QSize LibraryItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QM
 }
 
 /** Albums have covers usually. */
-void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &option, AlbumItem *item) const
+void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const
 {
 	/// XXX: reload cover with high resolution when one has increased coverSize (every 64px)
 	static QImageReader imageReader;
@@ -106,9 +106,8 @@ void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &opt
 
 	QString coverPath;
 	if (settings->isCoversEnabled() && _showCovers) {
-		coverPath = item->data(Miam::DF_CoverPath).toString();
-		//qDebug() << Q_FUNC_INFO << item->icon().isNull() << coverPath;
-		if (!coverPath.isEmpty() && item->icon().isNull()) {
+		coverPath = index.data(Miam::DF_CoverPath).toString();
+		if (!coverPath.isEmpty() && index.data(Qt::DecorationRole).isNull()) {
 		//if (!_loadedCovers.contains(item) && !coverPath.isEmpty()) {
 			FileHelper fh(coverPath);
 			// If it's an inner cover, load it
@@ -122,7 +121,7 @@ void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &opt
 					if (p.loadFromData(cover->byteArray(), cover->format())) {
 						p = p.scaled(_coverSize, _coverSize);
 						if (!p.isNull()) {
-							item->setIcon(p);
+							_libraryModel->setData(index, QIcon(p), Qt::DecorationRole);
 							//_loadedCovers.insert(item, true);
 						}
 					} else {
@@ -135,7 +134,7 @@ void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &opt
 				//qDebug() << Q_FUNC_INFO << "loading external cover from harddrive";
 				imageReader.setFileName(QDir::fromNativeSeparators(coverPath));
 				imageReader.setScaledSize(QSize(_coverSize, _coverSize));
-				item->setIcon(QPixmap::fromImage(imageReader.read()));
+				_libraryModel->setData(index, QIcon(QPixmap::fromImage(imageReader.read())), Qt::DecorationRole);
 				//_loadedCovers.insert(item, true);
 			}
 		}
@@ -170,7 +169,7 @@ void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &opt
 	}
 
 	// Add an icon on the right if album is from some remote location
-	bool isRemote = item->data(Miam::DF_IsRemote).toBool();
+	bool isRemote = index.data(Miam::DF_IsRemote).toBool();
 	int offsetWidth = 0;
 	if (isRemote) {
 		int iconSize = 31;
@@ -178,7 +177,7 @@ void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &opt
 							 (option.rect.height() - iconSize)/ 2 + option.rect.y() + 2,
 							 iconSize,
 							 iconSize);
-		QPixmap iconRemote(item->iconPath());
+		QPixmap iconRemote(index.data(Miam::DF_IconPath).toString());
 		painter->save();
 		painter->setOpacity(0.5);
 		painter->drawPixmap(iconRemoteRect, iconRemote);
@@ -204,10 +203,10 @@ void LibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &opt
 	QFontMetrics fmf(settings->font(SettingsPrivate::FF_Library));
 	QString s = fmf.elidedText(option.text, Qt::ElideRight, rectText.width());
 
-	this->paintText(painter, option, rectText, s, item);
+	this->paintText(painter, option, rectText, s, index);
 }
 
-void LibraryItemDelegate::drawArtist(QPainter *painter, QStyleOptionViewItem &option, ArtistItem *item) const
+void LibraryItemDelegate::drawArtist(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const
 {
 	auto settings = SettingsPrivate::instance();
 	QFontMetrics fmf(settings->font(SettingsPrivate::FF_Library));
@@ -217,7 +216,7 @@ void LibraryItemDelegate::drawArtist(QPainter *painter, QStyleOptionViewItem &op
 	if (QGuiApplication::isLeftToRight()) {
 		QPoint topLeft(option.rect.x() + 5, option.rect.y());
 		rectText = QRect(topLeft, option.rect.bottomRight());
-		QString custom = item->data(Miam::DF_CustomDisplayText).toString();
+		QString custom = index.data(Miam::DF_CustomDisplayText).toString();
 		if (!custom.isEmpty() && settings->isReorderArtistsArticle()) {
 			/// XXX: paint articles like ", the" in gray? Could be nice
 			s = fmf.elidedText(custom, Qt::ElideRight, rectText.width());
@@ -228,10 +227,10 @@ void LibraryItemDelegate::drawArtist(QPainter *painter, QStyleOptionViewItem &op
 		rectText = QRect(option.rect.x(), option.rect.y(), option.rect.width() - 5, option.rect.height());
 		s = fmf.elidedText(option.text, Qt::ElideRight, rectText.width());
 	}
-	this->paintText(painter, option, rectText, s, item);
+	this->paintText(painter, option, rectText, s, index);
 }
 
-void LibraryItemDelegate::drawDisc(QPainter *painter, QStyleOptionViewItem &option, DiscItem *item) const
+void LibraryItemDelegate::drawDisc(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const
 {
 	option.state = QStyle::State_None;
 	QPointF p1 = option.rect.bottomLeft(), p2 = option.rect.bottomRight();
@@ -239,17 +238,17 @@ void LibraryItemDelegate::drawDisc(QPainter *painter, QStyleOptionViewItem &opti
 	p2.setX(p2.x() - 2);
 	painter->setPen(Qt::gray);
 	painter->drawLine(p1, p2);
-	QStyledItemDelegate::paint(painter, option, item->index());
+	QStyledItemDelegate::paint(painter, option, index);
 }
 
-void LibraryItemDelegate::drawTrack(QPainter *painter, QStyleOptionViewItem &option, TrackItem *track) const
+void LibraryItemDelegate::drawTrack(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &track) const
 {
 	/// XXX: it will be a piece of cake to add an option that one can customize how track number will be displayed
 	/// QString title = settings->libraryItemTitle();
 	/// for example: zero padding
 	auto settings = SettingsPrivate::instance();
 	if (settings->isStarDelegates()) {
-		int r = track->data(Miam::DF_Rating).toInt();
+		int r = track.data(Miam::DF_Rating).toInt();
 		QStyleOptionViewItem copy(option);
 		copy.rect = QRect(0, option.rect.y(), option.rect.x(), option.rect.height());
 		/// XXX: create an option to display stars right to the text, and fade them if text is too large
@@ -265,19 +264,19 @@ void LibraryItemDelegate::drawTrack(QPainter *painter, QStyleOptionViewItem &opt
 	MiamItemDelegate::drawTrack(painter, option, track);
 }
 
-void LibraryItemDelegate::paintCoverOnTrack(QPainter *painter, const QStyleOptionViewItem &opt, const TrackItem *track) const
+void LibraryItemDelegate::paintCoverOnTrack(QPainter *painter, const QStyleOptionViewItem &opt, const QModelIndex &track) const
 {
 	SettingsPrivate *settings = SettingsPrivate::instance();
-	const QImage *image = _libraryTreeView->expandedCover(static_cast<AlbumItem*>(track->parent()));
+	const QImage *image = _libraryTreeView->expandedCover(track.parent());
 	if (image && !image->isNull()) {
 		// Copy QStyleOptionViewItem to be able to expand it to the left, and take the maximum available space
 		QStyleOptionViewItem option(opt);
 		option.rect.setX(0);
 
-		int totalHeight = track->model()->rowCount(track->parent()->index()) * option.rect.height();
+		int totalHeight = _libraryModel->rowCount(track.parent()) * option.rect.height();
 		QImage scaled;
 		QRect subRect;
-		int row = _proxy->mapFromSource(track->index()).row();
+		int row = _proxy->mapFromSource(track).row();
 		if (totalHeight > option.rect.width()) {
 			scaled = image->scaledToWidth(option.rect.width());
 			subRect = option.rect.translated(option.rect.width() - scaled.width(), -option.rect.y() + option.rect.height() * row);
@@ -346,7 +345,7 @@ void LibraryItemDelegate::paintCoverOnTrack(QPainter *painter, const QStyleOptio
 }
 
 /** Check if color needs to be inverted then paint text. */
-void LibraryItemDelegate::paintText(QPainter *p, const QStyleOptionViewItem &opt, const QRect &rectText, const QString &text, const QStandardItem *item) const
+void LibraryItemDelegate::paintText(QPainter *p, const QStyleOptionViewItem &opt, const QRect &rectText, const QString &text, const QModelIndex &index) const
 {
 	p->save();
 	if (text.isEmpty()) {
@@ -361,7 +360,7 @@ void LibraryItemDelegate::paintText(QPainter *p, const QStyleOptionViewItem &opt
 				p->setPen(opt.palette.highlightedText().color());
 			}
 		}
-		if (item->data(Miam::DF_Highlighted).toBool()) {
+		if (_proxy->isHighlighted(index)) {
 			QFont f = p->font();
 			f.setBold(true);
 			p->setFont(f);
@@ -3,10 +3,8 @@
 
 #include "miamitemdelegate.h"
 #include "libraryfilterproxymodel.h"
-#include "discitem.h"
 #include "separatoritem.h"
 #include "trackitem.h"
-#include "yearitem.h"
 
 #include <QPainter>
 #include <QPropertyAnimation>
@@ -28,7 +26,7 @@ private:
 	LibraryTreeView *_libraryTreeView;
 
 public:
-	explicit LibraryItemDelegate(LibraryTreeView *libraryTreeView, QSortFilterProxyModel *proxy);
+	explicit LibraryItemDelegate(LibraryTreeView *libraryTreeView, MiamSortFilterProxyModel *proxy);
 
 	/** Redefined. */
 	virtual void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
@@ -38,18 +36,18 @@ public:
 
 protected:
 	/** Albums have covers usually. */
-	virtual void drawAlbum(QPainter *painter, QStyleOptionViewItem &option, AlbumItem *item) const override;
+	virtual void drawAlbum(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
-	virtual void drawArtist(QPainter *painter, QStyleOptionViewItem &option, ArtistItem *item) const override;
+	virtual void drawArtist(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
-	void drawDisc(QPainter *painter, QStyleOptionViewItem &option, DiscItem *item) const;
+	void drawDisc(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const;
 
-	virtual void drawTrack(QPainter *painter, QStyleOptionViewItem &option, TrackItem *track) const override;
+	virtual void drawTrack(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &track) const override;
 
-	void paintCoverOnTrack(QPainter *painter, const QStyleOptionViewItem &option, const TrackItem *track) const;
+	void paintCoverOnTrack(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &track) const;
 
 	/** Check if color needs to be inverted then paint text. */
-	void paintText(QPainter *painter, const QStyleOptionViewItem &option, const QRect &rectText, const QString &text, const QStandardItem *item) const;
+	void paintText(QPainter *painter, const QStyleOptionViewItem &option, const QRect &rectText, const QString &text, const QModelIndex &index) const;
 
 public slots:
 	void displayIcon(bool b);
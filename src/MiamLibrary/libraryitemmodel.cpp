@@ -1,56 +1,270 @@
 #include "libraryitemmodel.h"
 
 #include <settingsprivate.h>
-#include <model/albumdao.h>
-#include <model/artistdao.h>
 #include <model/sqldatabase.h>
-#include <model/trackdao.h>
-#include <model/yeardao.h>
-#include "albumitem.h"
-#include "artistitem.h"
-#include "trackitem.h"
-#include "yearitem.h"
 
-#include <functional>
+#include <QRegularExpression>
+#include <QThreadPool>
 
 #include <QtDebug>
 
 LibraryItemModel::LibraryItemModel(QObject *parent)
-	: MiamItemModel(parent)
+	: QAbstractItemModel(parent)
 	, _proxy(new LibraryFilterProxyModel(this))
+	, _filterRole(Qt::DisplayRole)
+	, _filter(nullptr)
+	, _isFilterNarrowing(false)
 {
-	setColumnCount(1);
 	_proxy->setSourceModel(this);
-	_proxy->setTopLevelItems(this->topLevelItems());
+	connect(this, &LibraryItemModel::itemsFiltered, _proxy, &LibraryFilterProxyModel::updateFilter);
 }
 
-void LibraryItemModel::clearCache()
+LibraryItemModel::~LibraryItemModel()
 {
-	_hash.clear();
+	// A filter which is still running deletes itself
+	if (_filter) {
+		_filter->cancel();
+	}
+}
+
+bool LibraryItemModel::canFetchMore(const QModelIndex &parent) const
+{
+	if (!parent.isValid()) {
+		return false;
+	}
+	qint32 item = itemOf(parent);
+	return !isFetched(item) && !_children.at(item).isEmpty();
+}
+
+int LibraryItemModel::columnCount(const QModelIndex &) const
+{
+	return 1;
+}
+
+QVariant LibraryItemModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid()) {
+		return QVariant();
+	}
+	return this->itemData(itemOf(index), role);
+}
+
+void LibraryItemModel::fetchMore(const QModelIndex &parent)
+{
+	if (!canFetchMore(parent)) {
+		return;
+	}
+	qint32 item = itemOf(parent);
+	beginInsertRows(parent, 0, _children.at(item).size() - 1);
+	_items[item].flags |= IF_Fetched;
+	endInsertRows();
+}
+
+Qt::ItemFlags LibraryItemModel::flags(const QModelIndex &index) const
+{
+	if (!index.isValid()) {
+		return Qt::NoItemFlags;
+	}
+	return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
+}
+
+bool LibraryItemModel::hasChildren(const QModelIndex &parent) const
+{
+	if (parent.column() > 0) {
+		return false;
+	}
+	return !childrenOf(itemOf(parent)).isEmpty();
+}
+
+QVariant LibraryItemModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (section == 0 && orientation == Qt::Horizontal) {
+		return _headerData.value(role == Qt::EditRole ? Qt::DisplayRole : role);
+	}
+	return QAbstractItemModel::headerData(section, orientation, role);
+}
+
+QModelIndex LibraryItemModel::index(int row, int column, const QModelIndex &parent) const
+{
+	qint32 p = itemOf(parent);
+	if (row < 0 || column != 0 || !isFetched(p)) {
+		return QModelIndex();
+	}
+	const QVector<qint32> &children = childrenOf(p);
+	if (row >= children.size()) {
+		return QModelIndex();
+	}
+	return createIndex(row, 0, children.at(row));
+}
+
+QModelIndex LibraryItemModel::parent(const QModelIndex &child) const
+{
+	if (!child.isValid()) {
+		return QModelIndex();
+	}
+	return indexOf(_items.at(itemOf(child)).parent);
+}
+
+int LibraryItemModel::rowCount(const QModelIndex &parent) const
+{
+	if (parent.column() > 0) {
+		return 0;
+	}
+	qint32 p = itemOf(parent);
+	return isFetched(p) ? childrenOf(p).size() : 0;
+}
+
+/** Only covers of albums can be set. */
+bool LibraryItemModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+	if (!index.isValid() || role != Qt::DecorationRole) {
+		return false;
+	}
+	qint32 item = itemOf(index);
+	if (_items.at(item).type != Miam::IT_Album) {
+		return false;
+	}
+	_covers.insert(item, qvariant_cast<QIcon>(value));
+	emit dataChanged(index, index, QVector<int>() << role);
+	return true;
+}
+
+bool LibraryItemModel::setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role)
+{
+	if (section != 0 || orientation != Qt::Horizontal) {
+		return false;
+	}
+	_headerData.insert(role == Qt::EditRole ? Qt::DisplayRole : role, value);
+	emit headerDataChanged(orientation, section, section);
+	return true;
 }
 
 /** For every item in the library, gets the top level letter attached to it. */
+/** Children of an item, even those which were not fetched yet. These indexes can only be used to read data. */
+QModelIndexList LibraryItemModel::childIndexes(const QModelIndex &parent) const
+{
+	QModelIndexList indexes;
+	if (parent.column() > 0) {
+		return indexes;
+	}
+	const QVector<qint32> &children = childrenOf(itemOf(parent));
+	indexes.reserve(children.size());
+	for (qint32 child : children) {
+		indexes.append(createIndex(_items.at(child).row, 0, child));
+	}
+	return indexes;
+}
+
 QChar LibraryItemModel::currentLetter(const QModelIndex &iTop) const
 {
-	QStandardItem *item = itemFromIndex(_proxy->mapToSource(iTop));
+	QModelIndex m = _proxy->mapToSource(iTop);
+	if (!m.isValid()) {
+		return QChar();
+	}
 
 	// Special item "Various" (on top) has no Normalized String
-	if (item && item->type() == Miam::IT_Separator && iTop.data(Miam::DF_NormalizedString).toString() == "0") {
+	if (this->itemType(m) == Miam::IT_Separator && m.data(Miam::DF_NormalizedString).toString() == "0") {
 		return QChar();
-	} else if (!iTop.isValid()) {
+	}
+
+	// An item without a valid parent is a top level item, therefore we can extract the letter.
+	while (m.parent().isValid()) {
+		m = m.parent();
+	}
+	QString normalizedText = m.data(Miam::DF_NormalizedString).toString();
+	if (normalizedText.isEmpty()) {
 		return QChar();
 	} else {
-		QModelIndex m = iTop;
-		// An item without a valid parent is a top level item, therefore we can extract the letter.
-		while (m.parent().isValid()) {
-			m = m.parent();
+		return normalizedText.toUpper().at(0);
+	}
+}
+
+/** Starts to evaluate a filter on every item, even those which were not fetched yet, and cancels the previous one. */
+void LibraryItemModel::filterItems(const QRegExp &regExp, int role)
+{
+	if (_filter) {
+		_filter->cancel();
+		_filter = nullptr;
+	}
+	if (regExp.isEmpty()) {
+		bool isNarrowed = _filterRegExp.isEmpty();
+		_filterRegExp = regExp;
+		_filterRole = role;
+		_matchingItems.clear();
+		_acceptedItems.clear();
+		emit itemsFiltered(isNarrowed);
+		return;
+	}
+
+	// When the new text contains the previous one, only items which were matching may still match
+	QBitArray previousMatchingItems;
+	if (_filterRegExp.isEmpty()) {
+		_isFilterNarrowing = true;
+	} else if (role == _filterRole &&
+			regExp.patternSyntax() == QRegExp::FixedString && _filterRegExp.patternSyntax() == QRegExp::FixedString &&
+			regExp.caseSensitivity() == _filterRegExp.caseSensitivity() &&
+			regExp.pattern().contains(_filterRegExp.pattern(), regExp.caseSensitivity())) {
+		previousMatchingItems = _matchingItems;
+		_isFilterNarrowing = true;
+	} else {
+		_isFilterNarrowing = false;
+	}
+
+	this->updateFilterSnapshot(role);
+	_filter = new LibraryFilter(_filterSnapshot, regExp, previousMatchingItems);
+	connect(_filter, &LibraryFilter::finished, this, &LibraryItemModel::applyFilter);
+	connect(_filter, &LibraryFilter::finished, _filter, &QObject::deleteLater);
+	QThreadPool::globalInstance()->start(_filter);
+}
+
+/** Finds items matching an expression, and their parents, by position in the model. Items are not modified. */
+QBitArray LibraryItemModel::highlightedItems(const QRegExp &regExp, int role, QSet<QChar> *letters) const
+{
+	QBitArray items(_items.size());
+	if (regExp.isEmpty()) {
+		return items;
+	}
+	for (qint32 i = 0; i < _items.size(); i++) {
+		const Item &item = _items.at(i);
+		if ((item.flags & IF_Removed) || item.type == Miam::IT_Separator || !itemData(i, role).toString().contains(regExp)) {
+			continue;
 		}
-		if (m.isValid() && !m.data(Miam::DF_NormalizedString).toString().isEmpty()) {
-			return m.data(Miam::DF_NormalizedString).toString().toUpper().at(0);
-		} else {
-			return QChar();
+
+		// For every item marked, mark also its parents until one was already marked
+		qint32 m = i;
+		for (;;) {
+			items.setBit(m);
+			qint32 parent = _items.at(m).parent;
+			if (parent < 0) {
+				QString normalizedText = itemData(m, Miam::DF_NormalizedString).toString();
+				if (!normalizedText.isEmpty()) {
+					letters->insert(normalizedText.toUpper().at(0));
+				}
+				break;
+			} else if (items.testBit(parent)) {
+				break;
+			}
+			m = parent;
 		}
 	}
+	return items;
+}
+
+Miam::ItemType LibraryItemModel::itemType(const QModelIndex &index) const
+{
+	if (!index.isValid()) {
+		return Miam::IT_UnknownType;
+	}
+	return static_cast<Miam::ItemType>(_items.at(itemOf(index)).type);
+}
+
+QModelIndex LibraryItemModel::letterIndex(const QString &letter) const
+{
+	qint32 separator = _letters.value(letter, -1);
+	if (separator < 0 || !isAttached(separator)) {
+		return QModelIndex();
+	}
+	return indexOf(separator);
 }
 
 LibraryFilterProxyModel* LibraryItemModel::proxy() const
@@ -68,136 +282,550 @@ void LibraryItemModel::rebuildSeparators()
 		filters = s->libraryFilteredByArticles();
 	}
 
+	// Delete separators first, and always remove rows in reverse order
+	QList<qint32> separators = _letters.values();
+	std::sort(separators.begin(), separators.end(), [this] (qint32 a, qint32 b) {
+		return _items.at(a).row > _items.at(b).row;
+	});
+	for (qint32 separator : separators) {
+		this->removeItem(separator);
+	}
+	_separators.clear();
+
 	// Reset custom displayed text, like "Artist, the"
-	QHashIterator<SeparatorItem*, QModelIndex> i(_topLevelItems);
-	while (i.hasNext()) {
-		i.next();
-		if (auto item = itemFromIndex(i.value())) {
-			if (!i.value().data(Miam::DF_CustomDisplayText).toString().isEmpty()) {
-				item->setData(QString(), Miam::DF_CustomDisplayText);
-				// Recompute standard normalized name: "The Artist" -> "theartist"
-				item->setData(db->normalizeField(item->text()), Miam::DF_NormalizedString);
-			} else if (!filters.isEmpty()) {
-				for (QString filter : filters) {
-					QString text = item->text();
-					if (text.startsWith(filter + " ", Qt::CaseInsensitive)) {
-						text = text.mid(filter.length() + 1);
-						item->setData(text + ", " + filter, Miam::DF_CustomDisplayText);
-						item->setData(db->normalizeField(text), Miam::DF_NormalizedString);
-						break;
-					}
-				}
+	_names.clear();
+	for (qint32 item : _topLevelItems) {
+		_items[item].data = -1;
+		const LibraryNode &node = _items.at(item).node;
+		if (_items.at(item).type == Miam::IT_Year) {
+			continue;
+		}
+		Names names;
+		QString text = node.title();
+		for (QString filter : filters) {
+			if (text.startsWith(filter + " ", Qt::CaseInsensitive)) {
+				text = text.mid(filter.length() + 1);
+				names.customDisplayText = text + ", " + filter;
+				break;
 			}
 		}
+		// Recompute standard normalized name when an article was moved by the loader: "The Artist" -> "theartist"
+		if (!names.customDisplayText.isEmpty() || !node.customData().isEmpty()) {
+			names.normalizedText = db->normalizeField(text);
+			_names.insert(item, names);
+		}
 	}
-
-	// Delete separators first
-	QSet<int> setRows;
-	QHashIterator<QString, SeparatorItem*> it(_letters);
-	while (it.hasNext()) {
-		it.next();
-		setRows << it.value()->index().row();
-	}
-
-	// Always remove items (rows) in reverse order
-	QList<int> rows = setRows.toList();
-	std::sort(rows.begin(), rows.end(), std::greater<int>());
-	for (int row : rows) {
-		auto item = takeItem(row);
-		removeRow(row);
-		delete item;
+	if (!_topLevelItems.isEmpty()) {
+		emit dataChanged(index(0, 0), index(_topLevelItems.size() - 1, 0));
 	}
-	_letters.clear();
-	_topLevelItems.clear();
 
 	// Insert once again new separators
-	for (int row = 0; row < rowCount(); row++) {
-		auto item = this->item(row);
-		if (item->type() != Miam::IT_Separator) {
-			if (auto separator = this->insertSeparator(item)) {
-				_topLevelItems.insert(separator, item->index());
-			}
+	QVector<qint32> newSeparators;
+	for (qint32 item : QVector<qint32>(_topLevelItems)) {
+		int separatorCount = _separators.size();
+		qint32 separator = this->insertSeparator(item);
+		if (_separators.size() > separatorCount) {
+			newSeparators.append(separator);
 		}
 	}
+	if (!newSeparators.isEmpty()) {
+		beginInsertRows(QModelIndex(), _topLevelItems.size(), _topLevelItems.size() + newSeparators.size() - 1);
+		for (qint32 separator : newSeparators) {
+			_items[separator].row = _topLevelItems.size();
+			_topLevelItems.append(separator);
+		}
+		endInsertRows();
+	}
 }
 
 void LibraryItemModel::reset()
 {
-	_letters.clear();
+	beginResetModel();
+	_items.clear();
+	_children.clear();
 	_topLevelItems.clear();
+	_separators.clear();
 	_hash.clear();
+	_letters.clear();
 	_tracks.clear();
+	_names.clear();
+	_covers.clear();
+	_matchingItems.clear();
+	_acceptedItems.clear();
+	_filterSnapshot = LibraryFilter::Snapshot();
+	if (_filter) {
+		_filter->cancel();
+		_filter = nullptr;
+	}
 
-	removeRows(0, rowCount());
 	switch (SettingsPrivate::instance()->insertPolicy()) {
 	case SettingsPrivate::IP_Artists:
-		horizontalHeaderItem(0)->setText(tr("  Artists \\ Albums"));
+		_headerData.insert(Qt::DisplayRole, tr("  Artists \\ Albums"));
 		break;
 	case SettingsPrivate::IP_Albums:
-		horizontalHeaderItem(0)->setText(tr("  Albums"));
+		_headerData.insert(Qt::DisplayRole, tr("  Albums"));
 		break;
 	case SettingsPrivate::IP_ArtistsAlbums:
-		horizontalHeaderItem(0)->setText(tr("  Artists – Albums"));
+		_headerData.insert(Qt::DisplayRole, tr("  Artists – Albums"));
 		break;
 	case SettingsPrivate::IP_Years:
-		horizontalHeaderItem(0)->setText(tr("  Years"));
+		_headerData.insert(Qt::DisplayRole, tr("  Years"));
 		break;
 	}
+	endResetModel();
+	emit headerDataChanged(Qt::Horizontal, 0, 0);
 }
 
-void LibraryItemModel::cleanDanglingNodes()
+/** Top level items grouped by a separator. */
+QModelIndexList LibraryItemModel::topLevelItems(const QModelIndex &separator) const
 {
-	/// XXX: there's an empty row sometimes caused by extra SeparatorItem
-	this->rebuildSeparators();
+	QModelIndexList indexes;
+	if (this->itemType(separator) != Miam::IT_Separator) {
+		return indexes;
+	}
+	for (qint32 item : _separators.at(_items.at(itemOf(separator)).data).topLevelItems) {
+		if (isAttached(item)) {
+			indexes.append(indexOf(item));
+		}
+	}
+	return indexes;
 }
 
-/** Find and insert a node in the hierarchy of items. */
-void LibraryItemModel::insertNode(GenericDAO *node)
+/** Appends a record which is not attached to its parent yet. */
+qint32 LibraryItemModel::appendItem(const LibraryNode &node, int type, qint32 parent)
 {
-	if (!node || (node && _hash.contains(node->hash()))) {
-		return;
+	Item item;
+	item.node = node;
+	item.parent = parent;
+	item.row = -1;
+	item.data = -1;
+	item.type = type;
+	item.flags = 0;
+	_items.append(item);
+	_children.append(QVector<qint32>());
+	return _items.size() - 1;
+}
+
+/** Tests every descendant of an item with the last filter, even those which were not fetched yet. */
+bool LibraryItemModel::hasMatchingDescendant(qint32 item) const
+{
+	for (qint32 child : childrenOf(item)) {
+		if (this->isMatching(child) || this->hasMatchingDescendant(child)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LibraryItemModel::isAccepted(qint32 item) const
+{
+	if (_filterRegExp.isEmpty()) {
+		return true;
+	} else if (item < _acceptedItems.size()) {
+		return _acceptedItems.testBit(item);
+	}
+
+	// Items appended since the last evaluation are tested on their own, with their ancestors and their descendants
+	if (_items.at(item).type == Miam::IT_Separator) {
+		for (qint32 topLevelItem : _separators.at(_items.at(item).data).topLevelItems) {
+			if (this->isAccepted(topLevelItem)) {
+				return true;
+			}
+		}
+		return this->isMatching(item);
+	}
+	for (qint32 m = item; m >= 0; m = _items.at(m).parent) {
+		if (this->isMatching(m)) {
+			return true;
+		}
+	}
+	return this->hasMatchingDescendant(item);
+}
+
+QVariant LibraryItemModel::itemData(qint32 i, int role) const
+{
+	const Item &item = _items.at(i);
+	if (item.type == Miam::IT_Separator) {
+		const Separator &separator = _separators.at(item.data);
+		switch (role) {
+		case Qt::DisplayRole:
+		case Qt::EditRole:
+			return separator.text;
+		case Miam::DF_NormalizedString:
+			return separator.normalizedText;
+		default:
+			return QVariant();
+		}
+	}
+
+	const LibraryNode &node = item.node;
+	switch (role) {
+	case Qt::DisplayRole:
+	case Qt::EditRole:
+		if (item.type == Miam::IT_Year && node.year() == 0) {
+			return tr("Unknown");
+		}
+		return node.title();
+	case Miam::DF_NormalizedString:
+		if (_names.contains(i)) {
+			return _names.value(i).normalizedText;
+		} else if (item.flags & IF_Various) {
+			return QString("0");
+		} else if (item.type != Miam::IT_Track) {
+			return node.titleNormalized();
+		}
+		break;
+	case Miam::DF_CustomDisplayText:
+		if (_names.contains(i)) {
+			return _names.value(i).customDisplayText;
+		} else if (item.type == Miam::IT_Artist) {
+			return node.customData();
+		}
+		break;
+	case Miam::DF_IsRemote:
+		if (item.type == Miam::IT_Album) {
+			return !node.icon().isEmpty();
+		} else if (item.type == Miam::IT_Track) {
+			return !node.uri().startsWith("file://");
+		}
+		break;
+	default:
+		break;
 	}
 
-	QStandardItem *nodeItem = nullptr;
-	if (TrackDAO *dao = qobject_cast<TrackDAO*>(node)) {
-		nodeItem = new TrackItem(dao);
-		if (_tracks.contains(dao->uri())) {
-			QStandardItem *rowToDelete = _tracks.value(dao->uri());
-			// Clean unused nodes
-			this->removeNode(rowToDelete->index());
+	if (item.type == Miam::IT_Album) {
+		switch (role) {
+		case Qt::DecorationRole:
+			if (_covers.contains(i)) {
+				return _covers.value(i);
+			}
+			break;
+		case Miam::DF_Year:
+			return node.year();
+		case Miam::DF_CoverPath:
+			return node.cover();
+		case Miam::DF_IconPath:
+			return node.icon();
+		default:
+			break;
+		}
+	} else if (item.type == Miam::IT_Track) {
+		switch (role) {
+		case Miam::DF_URI:
+			return node.uri();
+		case Miam::DF_TrackNumber:
+			return node.trackNumber();
+		case Miam::DF_DiscNumber:
+			return node.disc();
+		case Miam::DF_TrackLength:
+			return node.length();
+		case Miam::DF_Rating:
+			if (node.rating() != -1) {
+				return node.rating();
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return QVariant();
+}
+
+/** Finds or creates the separator of a top level item. Returns -1 if this item isn't grouped. */
+qint32 LibraryItemModel::insertSeparator(qint32 item)
+{
+	QString letter;
+	QString normalizedText;
+	// Items are grouped every ten years in this particular case
+	if (SettingsPrivate::instance()->insertPolicy() == SettingsPrivate::IP_Years) {
+		int year = itemData(item, Qt::DisplayRole).toInt();
+		if (year == 0) {
+			return -1;
+		}
+		letter = QString::number(year - year % 10);
+		normalizedText = letter;
+	} else {
+		// Other types of hierarchy, separators are built from letters
+		QString text = itemData(item, Miam::DF_CustomDisplayText).toString();
+		if (text.isEmpty()) {
+			text = itemData(item, Qt::DisplayRole).toString();
 		}
-		_tracks.insert(dao->uri(), nodeItem);
-	} else if (AlbumDAO *dao = qobject_cast<AlbumDAO*>(node)) {
-		AlbumItem *album = static_cast<AlbumItem*>(_hash.value(dao->hash()));
-		if (album) {
-			nodeItem = album;
+		QString c = text.left(1).normalized(QString::NormalizationForm_KD).toUpper().remove(QRegExp("[^A-Z\\s]"));
+		if (c.contains(QRegExp("\\w"))) {
+			letter = c;
+			normalizedText = letter.toLower();
 		} else {
-			nodeItem = new AlbumItem(dao);
+			letter = tr("Various");
+			normalizedText = "0";
+		}
+	}
+
+	qint32 separator = _letters.value(letter, -1);
+	if (separator < 0) {
+		separator = this->appendItem(LibraryNode(), Miam::IT_Separator, -1);
+		Separator s;
+		s.text = letter;
+		s.normalizedText = normalizedText;
+		_items[separator].data = _separators.size();
+		_separators.append(s);
+		_letters.insert(letter, separator);
+	}
+	_separators[_items.at(separator).data].topLevelItems.append(item);
+	_items[item].data = separator;
+	return separator;
+}
+
+/** Recursively remove an item and its parent if the latter has no more children. */
+void LibraryItemModel::removeItem(qint32 item)
+{
+	qint32 parent = _items.at(item).parent;
+	int row = _items.at(item).row;
+
+	// Rows under a collapsed item were never announced
+	bool isVisible = isFetched(parent);
+	if (isVisible) {
+		beginRemoveRows(indexOf(parent), row, row);
+	}
+	QVector<qint32> &siblings = childrenOf(parent);
+	siblings.remove(row);
+	for (int r = row; r < siblings.size(); r++) {
+		_items[siblings.at(r)].row = r;
+	}
+	this->forgetItem(item);
+	if (isVisible) {
+		endRemoveRows();
+	}
+
+	if (parent >= 0 && _children.at(parent).isEmpty()) {
+		this->removeItem(parent);
+	}
+}
+
+/** Removes an item and its descendants from caches, and marks them as removed. */
+void LibraryItemModel::forgetItem(qint32 i)
+{
+	Item &item = _items[i];
+	item.flags |= IF_Removed;
+	item.row = -1;
+	if (i < _filterSnapshot.size()) {
+		_filterSnapshot.removedItems.setBit(i);
+		_filterSnapshot.texts[i].clear();
+	}
+	if (item.type == Miam::IT_Separator) {
+		_letters.remove(_separators.at(item.data).text);
+	} else {
+		uint h = item.node.hash();
+		if (_hash.value(h, -1) == i) {
+			_hash.remove(h);
 		}
-	} else if (ArtistDAO *dao = qobject_cast<ArtistDAO*>(node)) {
-		ArtistItem *artist = static_cast<ArtistItem*>(_hash.value(dao->hash()));
-		if (artist) {
-			nodeItem = artist;
+		if (item.type == Miam::IT_Track && _tracks.value(item.node.uri(), -1) == i) {
+			_tracks.remove(item.node.uri());
+		}
+		if (item.parent < 0 && item.data >= 0) {
+			_separators[_items.at(item.data).data].topLevelItems.removeOne(i);
+		}
+		_covers.remove(i);
+		_names.remove(i);
+	}
+	for (qint32 child : _children.at(i)) {
+		this->forgetItem(child);
+	}
+	_children[i].clear();
+}
+
+/** Appends new items to the snapshot, or builds it again for another role. */
+void LibraryItemModel::updateFilterSnapshot(int role)
+{
+	if (_filterSnapshot.role != role) {
+		_filterSnapshot = LibraryFilter::Snapshot();
+		_filterSnapshot.role = role;
+	}
+
+	int first = _filterSnapshot.size();
+	_filterSnapshot.parents.resize(_items.size());
+	_filterSnapshot.texts.resize(_items.size());
+	_filterSnapshot.removedItems.resize(_items.size());
+	for (qint32 i = first; i < _items.size(); i++) {
+		const Item &item = _items.at(i);
+		_filterSnapshot.parents[i] = item.parent;
+		if (item.flags & IF_Removed) {
+			_filterSnapshot.removedItems.setBit(i);
 		} else {
-			nodeItem = new ArtistItem(dao);
+			_filterSnapshot.texts[i] = itemData(i, role).toString();
+		}
+	}
+
+	// Only a few separators: they're copied every time
+	_filterSnapshot.separators.clear();
+	for (qint32 separator : _letters) {
+		_filterSnapshot.separators.append(qMakePair(separator, _separators.at(_items.at(separator).data).topLevelItems));
+	}
+}
+
+/** Keeps results of the last filter which was started, and drops outdated ones. */
+void LibraryItemModel::applyFilter()
+{
+	LibraryFilter *filter = static_cast<LibraryFilter*>(sender());
+	if (filter != _filter) {
+		return;
+	}
+	_filter = nullptr;
+	_filterRegExp = filter->regExp();
+	_filterRole = filter->role();
+	_matchingItems = filter->matchingItems();
+	_acceptedItems = filter->acceptedItems();
+	emit itemsFiltered(_isFilterNarrowing);
+}
+
+/** Removes separators which are not grouping any item anymore. */
+void LibraryItemModel::cleanDanglingNodes()
+{
+	for (qint32 separator : _letters.values()) {
+		if (_separators.at(_items.at(separator).data).topLevelItems.isEmpty()) {
+			this->removeItem(separator);
 		}
-	} else if (YearDAO *dao = qobject_cast<YearDAO*>(node)) {
-		nodeItem = new YearItem(dao);
 	}
+}
+
+/** Find and insert nodes in the hierarchy of items. */
+void LibraryItemModel::insertNodes(const QVector<LibraryNode> &nodes)
+{
+	// Items whose parent was already fetched are grouped by parent, and each group is inserted with a single notification.
+	// Other items are attached to their parent directly: nothing is notified before their parent is expanded.
+	// A visible parent which had no child yet has nothing to fetch: it's marked as fetched and its first children are
+	// inserted, otherwise views would never know that it can be expanded.
+	QVector<qint32> parents;
+	QHash<qint32, QVector<qint32>> pendingRows;
+
+	auto flush = [this, &parents, &pendingRows] () {
+		for (qint32 parent : parents) {
+			const QVector<qint32> items = pendingRows.value(parent);
+			QVector<qint32> &children = childrenOf(parent);
+			beginInsertRows(indexOf(parent), children.size(), children.size() + items.size() - 1);
+			for (qint32 item : items) {
+				_items[item].row = children.size();
+				children.append(item);
+			}
+			endInsertRows();
+		}
+		parents.clear();
+		pendingRows.clear();
+	};
+	auto append = [this, &parents, &pendingRows] (qint32 parent, qint32 item) {
+		if (!isFetched(parent) && childrenOf(parent).isEmpty() && isAttached(parent) && isFetched(_items.at(parent).parent)) {
+			_items[parent].flags |= IF_Fetched;
+		}
+		if (!isFetched(parent)) {
+			QVector<qint32> &children = childrenOf(parent);
+			_items[item].row = children.size();
+			children.append(item);
+			return;
+		}
+		auto it = pendingRows.find(parent);
+		if (it == pendingRows.end()) {
+			parents.append(parent);
+			it = pendingRows.insert(parent, QVector<qint32>());
+		}
+		it->append(item);
+	};
+
+	static const QRegularExpression word("[\\w]");
+	for (const LibraryNode &node : nodes) {
+		if (!node.isValid()) {
+			continue;
+		}
+		uint h = node.hash();
+		if (_hash.contains(h)) {
+			continue;
+		}
+
+		int type = node.type();
+		switch (type) {
+		case Miam::IT_Album:
+		case Miam::IT_Artist:
+		case Miam::IT_Track:
+		case Miam::IT_Year:
+			break;
+		default:
+			continue;
+		}
+
+		qint32 parent = -1;
+		LibraryNode parentNode = node.parentNode();
+		if (parentNode.isValid()) {
+			parent = _hash.value(parentNode.hash(), -1);
+			if (parent < 0) {
+				continue;
+			}
+		}
+
+		if (type == Miam::IT_Track) {
+			qint32 trackToReplace = _tracks.value(node.uri(), -1);
+			if (trackToReplace >= 0) {
+				// Pending rows are inserted first, because empty parents are removed too
+				flush();
+				if (_items.at(trackToReplace).parent == parent) {
+					// Same album: the handle is replaced in place
+					_hash.remove(_items.at(trackToReplace).node.hash());
+					_items[trackToReplace].node = node;
+					_hash.insert(h, trackToReplace);
+					if (trackToReplace < _filterSnapshot.size()) {
+						_filterSnapshot.texts[trackToReplace] = itemData(trackToReplace, _filterSnapshot.role).toString();
+					}
+					if (trackToReplace < _matchingItems.size()) {
+						_matchingItems.setBit(trackToReplace, this->isMatching(trackToReplace));
+					}
+					if (isFetched(parent)) {
+						QModelIndex index = indexOf(trackToReplace);
+						emit dataChanged(index, index);
+					}
+					continue;
+				}
+				// Clean unused nodes
+				this->removeItem(trackToReplace);
+			}
+		}
 
-	if (node->parentNode()) {
-		if (QStandardItem *parentItem = _hash.value(node->parentNode()->hash())) {
-			parentItem->appendRow(nodeItem);
+		qint32 item = this->appendItem(node, type, parent);
+		if ((type == Miam::IT_Artist || type == Miam::IT_Album) &&
+				(node.titleNormalized().isEmpty() || !node.titleNormalized().contains(word))) {
+			_items[item].flags |= IF_Various;
 		}
-	} else if (nodeItem){
-		invisibleRootItem()->appendRow(nodeItem);
-		if (nodeItem->type() != Miam::IT_Separator) {
-			if ( SeparatorItem *separator = this->insertSeparator(nodeItem)) {
-				_topLevelItems.insert(separator, nodeItem->index());
+		append(parent, item);
+		if (parent < 0) {
+			int separatorCount = _separators.size();
+			qint32 separator = this->insertSeparator(item);
+			if (_separators.size() > separatorCount) {
+				append(-1, separator);
 			}
 		}
+		_hash.insert(h, item);
+		if (type == Miam::IT_Track) {
+			_tracks.insert(node.uri(), item);
+		}
+	}
+	flush();
+}
+
+void LibraryItemModel::updateNode(const LibraryNode &node)
+{
+	if (node.type() != Miam::IT_Album) {
+		return;
+	}
+	qint32 item = _hash.value(node.hash(), -1);
+	if (item < 0) {
+		return;
+	}
+	_items[item].node = node;
+	_covers.remove(item);
+	if (item < _filterSnapshot.size()) {
+		_filterSnapshot.texts[item] = itemData(item, _filterSnapshot.role).toString();
+	}
+	if (item < _matchingItems.size()) {
+		_matchingItems.setBit(item, this->isMatching(item));
 	}
-	if (nodeItem) {
-		_hash.insert(node->hash(), nodeItem);
+	if (isFetched(_items.at(item).parent)) {
+		QModelIndex index = indexOf(item);
+		emit dataChanged(index, index);
 	}
 }
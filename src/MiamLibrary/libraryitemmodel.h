@@ -1,47 +1,221 @@
 #ifndef LIBRARYITEMMODEL_H
 #define LIBRARYITEMMODEL_H
 
+#include <QAbstractItemModel>
+#include <QBitArray>
+#include <QHash>
+#include <QIcon>
+#include <QRegExp>
 #include <QSet>
-#include <model/genericdao.h>
-#include <filehelper.h>
-#include "miamitemmodel.h"
-#include "separatoritem.h"
+#include <QVector>
+#include <model/librarynode.h>
 #include "miamlibrary_global.hpp"
 
+#include "libraryfilter.h"
 #include "libraryfilterproxymodel.h"
 
 /**
- * \brief		The LibraryItemModel class is used to cache information from the database, in order to increase performance.
+ * \brief		The LibraryItemModel class is a tree of handles to nodes loaded from the database.
+ * \details		Each row is a small record in an array: a LibraryNode handle, its parent and its row. Roles are computed on demand
+ *				from nodes, only covers of albums and a few flags are kept in this model. Records are never moved, so their position
+ *				in the array is the internal id of model indexes.
+ *				Children of a collapsed item are not announced to views until it's expanded, with canFetchMore() and fetchMore().
+ *				Since a parent is always appended before its children, the filter is evaluated for the whole tree with a few
+ *				linear passes over a snapshot of this array, in a thread pool. Results are kept in bitsets which are only looked
+ *				up by the proxy, which filters its rows again without sorting them when the text is growing.
  * \author      Matthieu Bachelier
  * \copyright   GNU General Public License v3
  */
-class MIAMLIBRARY_LIBRARY LibraryItemModel : public MiamItemModel
+class MIAMLIBRARY_LIBRARY LibraryItemModel : public QAbstractItemModel
 {
 	Q_OBJECT
 private:
+	enum ItemFlag : quint16 {
+		IF_Fetched		= 0x1,
+		IF_Removed		= 0x2,
+		IF_Various		= 0x4
+	};
+
+	/** Parent is -1 for top level items. For separators, the handle is invalid and data is an index in _separators.
+	 * For other top level items, data is their separator, and -1 elsewhere. */
+	struct Item
+	{
+		LibraryNode node;
+		qint32 parent;
+		qint32 row;
+		qint32 data;
+		qint16 type;
+		quint16 flags;
+	};
+
+	/** Letters (or decades) which are grouping top level items. */
+	struct Separator
+	{
+		QString text;
+		QString normalizedText;
+		QVector<qint32> topLevelItems;
+	};
+
+	/** Texts of top level items computed again when one has changed grammatical articles in options. */
+	struct Names
+	{
+		QString customDisplayText;
+		QString normalizedText;
+	};
+
+	QVector<Item> _items;
+
+	/** Children of every item, in the same order as _items. */
+	QVector<QVector<qint32>> _children;
+	QVector<qint32> _topLevelItems;
+
+	QVector<Separator> _separators;
+
+	/** This hash is a cache, used to insert nodes in this tree at the right location. */
+	QHash<uint, qint32> _hash;
+
+	QHash<QString, qint32> _letters;
+	QHash<QString, qint32> _tracks;
+	QHash<qint32, Names> _names;
+	QHash<qint32, QIcon> _covers;
+
+	QHash<int, QVariant> _headerData;
+
 	LibraryFilterProxyModel *_proxy;
 
+	/** Last filter evaluated on the whole tree. */
+	QRegExp _filterRegExp;
+	int _filterRole;
+
+	/** Items matching the filter on their own, and items which are accepted: matching, or with a matching ancestor or
+	 * descendant. Items appended after the last evaluation are beyond the size of these arrays. */
+	QBitArray _matchingItems;
+	QBitArray _acceptedItems;
+
+	/** Copy of items for filters, extended with new items when a filter is started. */
+	LibraryFilter::Snapshot _filterSnapshot;
+
+	/** Filter which is running, if any. */
+	LibraryFilter *_filter;
+
+	/** True if the running filter can only hide items which are currently accepted. */
+	bool _isFilterNarrowing;
+
 public:
 	explicit LibraryItemModel(QObject *parent = nullptr);
 
-	void clearCache();
+	virtual ~LibraryItemModel();
+
+	virtual bool canFetchMore(const QModelIndex &parent) const override;
+
+	virtual int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+	virtual void fetchMore(const QModelIndex &parent) override;
+
+	virtual Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+	virtual bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+
+	virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+	virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+
+	virtual QModelIndex parent(const QModelIndex &child) const override;
+
+	virtual int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+	/** Only covers of albums can be set. */
+	virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 
-	virtual QChar currentLetter(const QModelIndex &index) const override;
+	virtual bool setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role = Qt::EditRole) override;
 
-	virtual LibraryFilterProxyModel* proxy() const override;
+	/** Children of an item, even those which were not fetched yet. These indexes can only be used to read data. */
+	QModelIndexList childIndexes(const QModelIndex &parent) const;
+
+	QChar currentLetter(const QModelIndex &index) const;
+
+	/** Starts to evaluate a filter on every item, even those which were not fetched yet, and cancels the previous one.
+	 * An empty expression accepts everything immediately. itemsFiltered() is emitted when results are available. */
+	void filterItems(const QRegExp &regExp, int role);
+
+	/** Finds items matching an expression, and their parents, by position in the model. Letters of top level items which
+	 * were found are appended too. Items themselves are not modified. */
+	QBitArray highlightedItems(const QRegExp &regExp, int role, QSet<QChar> *letters) const;
+
+	/** Returns true if an item, one of its ancestors or one of its descendants matches the last filter. */
+	inline bool isAccepted(const QModelIndex &index) const { return !index.isValid() || this->isAccepted(itemOf(index)); }
+
+	inline bool isFiltered() const { return !_filterRegExp.isEmpty(); }
+
+	Miam::ItemType itemType(const QModelIndex &index) const;
+
+	QModelIndex letterIndex(const QString &letter) const;
+
+	LibraryFilterProxyModel* proxy() const;
 
 	/** Rebuild the list of separators when one has changed grammatical articles in options. */
 	void rebuildSeparators();
 
 	void reset();
 
-	inline QMultiHash<SeparatorItem*, QModelIndex> topLevelItems() const { return _topLevelItems; }
+	/** Top level items grouped by a separator. */
+	QModelIndexList topLevelItems(const QModelIndex &separator) const;
+
+private:
+	/** Appends a record which is not attached to its parent yet. */
+	qint32 appendItem(const LibraryNode &node, int type, qint32 parent);
+
+	inline QVector<qint32> &childrenOf(qint32 parent) { return parent < 0 ? _topLevelItems : _children[parent]; }
+	inline const QVector<qint32> &childrenOf(qint32 parent) const { return parent < 0 ? _topLevelItems : _children.at(parent); }
+
+	/** Tests every descendant of an item with the last filter, even those which were not fetched yet. */
+	bool hasMatchingDescendant(qint32 item) const;
+
+	bool isAccepted(qint32 item) const;
+
+	inline bool isMatching(qint32 item) const { return itemData(item, _filterRole).toString().contains(_filterRegExp); }
+
+	QVariant itemData(qint32 item, int role) const;
+
+	inline QModelIndex indexOf(qint32 item) const { return item < 0 ? QModelIndex() : createIndex(_items.at(item).row, 0, item); }
+
+	/** Returns -1 for the root. */
+	inline qint32 itemOf(const QModelIndex &index) const { return index.isValid() ? static_cast<qint32>(index.internalId()) : -1; }
+
+	/** Finds or creates the separator of a top level item. Returns -1 if this item isn't grouped. */
+	qint32 insertSeparator(qint32 item);
+
+	inline bool isAttached(qint32 item) const { return _items.at(item).row >= 0; }
+
+	inline bool isFetched(qint32 item) const { return item < 0 || (_items.at(item).flags & IF_Fetched); }
+
+	/** Recursively remove an item and its parent if the latter has no more children. */
+	void removeItem(qint32 item);
+
+	/** Removes an item and its descendants from caches, and marks them as removed. */
+	void forgetItem(qint32 item);
+
+	/** Appends new items to the snapshot, or builds it again for another role. */
+	void updateFilterSnapshot(int role);
+
+private slots:
+	/** Keeps results of the last filter which was started, and drops outdated ones. */
+	void applyFilter();
 
 public slots:
+	/** Removes separators which are not grouping any item anymore. */
 	void cleanDanglingNodes();
 
-	/** Find and insert a node in the hierarchy of items. */
-	void insertNode(GenericDAO *node);
+	/** Find and insert nodes in the hierarchy of items. */
+	void insertNodes(const QVector<LibraryNode> &nodes);
+
+	void updateNode(const LibraryNode &node);
+
+signals:
+	/** Emitted once results of a filter are available. When narrowed, items can only have been hidden. */
+	void itemsFiltered(bool isNarrowed);
 };
 
 #endif // LIBRARYITEMMODEL_H
@@ -3,6 +3,7 @@
 #include <library/jumptowidget.h>
 #include <cover.h>
 #include <filehelper.h>
+#include <musicsearchengine.h>
 #include <settings.h>
 #include <settingsprivate.h>
 #include "deprecated/circleprogressbar.h"
@@ -44,6 +45,19 @@ LibraryTreeView::LibraryTreeView(QWidget *parent)
 	properties->addSeparator();
 	properties->addAction(actionOpenTagEditor);
 
+	// A running scan can be paused, resumed or cancelled from the progress bar
+	MusicSearchEngine *engine = SqlDatabase::instance()->musicSearchEngine();
+	QAction *actionPauseScan = new QAction(tr("Pause the scan"), _circleProgressBar);
+	QAction *actionResumeScan = new QAction(tr("Resume the scan"), _circleProgressBar);
+	QAction *actionCancelScan = new QAction(tr("Cancel the scan"), _circleProgressBar);
+	_circleProgressBar->addAction(actionPauseScan);
+	_circleProgressBar->addAction(actionResumeScan);
+	_circleProgressBar->addAction(actionCancelScan);
+	_circleProgressBar->setContextMenuPolicy(Qt::ActionsContextMenu);
+	connect(actionPauseScan, &QAction::triggered, this, [=]() { engine->pause(); });
+	connect(actionResumeScan, &QAction::triggered, this, [=]() { engine->resume(); });
+	connect(actionCancelScan, &QAction::triggered, this, [=]() { engine->cancel(); });
+
 	sortByColumn(0, Qt::AscendingOrder);
 	setTextElideMode(Qt::ElideRight);
 
@@ -67,9 +81,9 @@ LibraryTreeView::LibraryTreeView(QWidget *parent)
 	});
 	connect(_jumpToWidget, &JumpToWidget::aboutToScrollTo, this, [=](const QString &letter) {
 		delegate->displayIcon(false);
-		QStandardItem *item = _libraryModel->letterItem(letter);
-		if (item) {
-			this->scrollTo(_proxyModel->mapFromSource(item->index()), PositionAtTop);
+		QModelIndex index = _libraryModel->letterIndex(letter);
+		if (index.isValid()) {
+			this->scrollTo(_proxyModel->mapFromSource(index), PositionAtTop);
 		}
 		delegate->displayIcon(true);
 	});
@@ -77,30 +91,20 @@ LibraryTreeView::LibraryTreeView(QWidget *parent)
 	connect(_proxyModel, &MiamSortFilterProxyModel::aboutToHighlightLetters, _jumpToWidget, &JumpToWidget::highlightLetters);
 }
 
-const QImage *LibraryTreeView::expandedCover(AlbumItem *album) const
+const QImage *LibraryTreeView::expandedCover(const QModelIndex &album) const
 {
-	// proxy, etc
-	//if (_expandedCovers.contains(album)) {
-	//	qDebug() << _expandedCovers.value(album);
-		return _expandedCovers.value(album, nullptr);
-	//} else {
-	//	return nullptr;
-	//}
+	return _expandedCovers.value(album.internalId(), nullptr);
 }
 
 /** Reimplemented. */
 void LibraryTreeView::findAll(const QModelIndex &index, QStringList &tracks) const
 {
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxyModel->mapToSource(index));
-	if (item && item->hasChildren()) {
-		for (int i = 0; i < item->rowCount(); i++) {
-			// Recursive call on children
-			this->findAll(index.child(i, 0), tracks);
-		}
-		tracks.removeDuplicates();
-	} else if (item && item->type() == Miam::IT_Track) {
-		tracks << item->data(Miam::DF_URI).toString();
+	if (!index.isValid()) {
+		return;
 	}
+	// Items of the model are walked directly: collapsed items are not fetched
+	_libraryModel->proxy()->findTracks(_proxyModel->mapToSource(index), tracks);
+	tracks.removeDuplicates();
 }
 
 void LibraryTreeView::findMusic(const QString &text)
@@ -110,21 +114,17 @@ void LibraryTreeView::findMusic(const QString &text)
 
 void LibraryTreeView::removeExpandedCover(const QModelIndex &index)
 {
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxyModel->mapToSource(index));
-	if (item->type() == Miam::IT_Album && SettingsPrivate::instance()->isBigCoverEnabled()) {
-		AlbumItem *album = static_cast<AlbumItem*>(item);
-		QImage *image = _expandedCovers.value(album);
-		delete image;
-		_expandedCovers.remove(album);
+	QModelIndex album = _proxyModel->mapToSource(index);
+	if (_libraryModel->itemType(album) == Miam::IT_Album && SettingsPrivate::instance()->isBigCoverEnabled()) {
+		delete _expandedCovers.take(album.internalId());
 	}
 }
 
 void LibraryTreeView::setExpandedCover(const QModelIndex &index)
 {
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxyModel->mapToSource(index));
-	if (item->type() == Miam::IT_Album && SettingsPrivate::instance()->isBigCoverEnabled()) {
-		AlbumItem *albumItem = static_cast<AlbumItem*>(item);
-		QString coverPath = albumItem->coverPath();
+	QModelIndex album = _proxyModel->mapToSource(index);
+	if (_libraryModel->itemType(album) == Miam::IT_Album && SettingsPrivate::instance()->isBigCoverEnabled()) {
+		QString coverPath = album.data(Miam::DF_CoverPath).toString();
 		if (coverPath.isEmpty()) {
 			return;
 		}
@@ -140,7 +140,8 @@ void LibraryTreeView::setExpandedCover(const QModelIndex &index)
 		} else {
 			image = new QImage(coverPath);
 		}
-		_expandedCovers.insert(albumItem, image);
+		delete _expandedCovers.take(album.internalId());
+		_expandedCovers.insert(album.internalId(), image);
 	}
 }
 
@@ -159,7 +160,7 @@ void LibraryTreeView::createConnectionsToDB()
 		connect(db, &SqlDatabase::aboutToLoad, this, &LibraryTreeView::reset);
 		connect(db, &SqlDatabase::loaded, this, &LibraryTreeView::endPopulateTree);
 		connect(db, &SqlDatabase::progressChanged, _circleProgressBar, &QProgressBar::setValue);
-		connect(db, &SqlDatabase::nodeExtracted, _libraryModel, &LibraryItemModel::insertNode);
+		connect(db, &SqlDatabase::nodesExtracted, _libraryModel, &LibraryItemModel::insertNodes);
 		connect(db, &SqlDatabase::aboutToUpdateNode, _libraryModel, &LibraryItemModel::updateNode);
 		connect(db, &SqlDatabase::aboutToCleanView, _libraryModel, &LibraryItemModel::cleanDanglingNodes);
 		db->load();
@@ -170,13 +171,13 @@ void LibraryTreeView::createConnectionsToDB()
 /** Redefined to display a small context menu in the view. */
 void LibraryTreeView::contextMenuEvent(QContextMenuEvent *event)
 {
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxyModel->mapToSource(this->indexAt(event->pos())));
-	if (item) {
+	QModelIndex index = _proxyModel->mapToSource(this->indexAt(event->pos()));
+	if (index.isValid()) {
 		for (QAction *action : properties->actions()) {
 			action->setText(QApplication::translate("LibraryTreeView", action->text().toStdString().data()));
 			action->setFont(SettingsPrivate::instance()->font(SettingsPrivate::FF_Menu));
 		}
-		if (item->type() != Miam::IT_Separator) {
+		if (_libraryModel->itemType(index) != Miam::IT_Separator) {
 			properties->exec(event->globalPos());
 		}
 	}
@@ -205,16 +206,8 @@ void LibraryTreeView::paintEvent(QPaintEvent *event)
 /** Recursive count for leaves only. */
 int LibraryTreeView::count(const QModelIndex &index) const
 {
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxyModel->mapToSource(index));
-	if (item) {
-		int tmp = 0;
-		for (int i = 0; i < item->rowCount(); i++) {
-			tmp += count(index.child(i, 0));
-		}
-		return (tmp == 0) ? 1 : tmp;
-	} else {
-		return 0;
-	}
+	// Items of the model are walked directly: collapsed items are not fetched
+	return _libraryModel->proxy()->countLeaves(_proxyModel->mapToSource(index));
 }
 
 /** Reimplemented. */
@@ -257,6 +250,8 @@ void LibraryTreeView::reset()
 		_proxyModel->setFilterRegExp(QString());
 		this->verticalScrollBar()->setValue(0);
 	}
+	qDeleteAll(_expandedCovers);
+	_expandedCovers.clear();
 	_libraryModel->reset();
 }
 
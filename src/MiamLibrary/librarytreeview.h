@@ -12,7 +12,6 @@
 #include <QMenu>
 #include <QShortcut>
 #include <QSortFilterProxyModel>
-#include <QStandardItemModel>
 #include <QTimer>
 #include "miamlibrary_global.hpp"
 
@@ -21,12 +20,6 @@ class CircleProgressBar;
 class JumpToWidget;
 class LibraryFilterLineEdit;
 class LibraryFilterProxyModel;
-class ArtistItem;
-class AlbumItem;
-class DiscItem;
-class SeparatorItem;
-class TrackItem;
-class YearItem;
 
 /**
  * \brief		The LibraryTreeView class is displaying tracks in a tree.
@@ -39,7 +32,7 @@ class MIAMLIBRARY_LIBRARY LibraryTreeView : public TreeView
 	Q_OBJECT
 
 private:
-	/** The model used by this treeView is a simple QStandardItemModel. Hard work has been delegated to Proxy and ItemDelegate for the rending. */
+	/** The model used by this treeView only keeps handles to nodes. Hard work has been delegated to Proxy and ItemDelegate for the rending. */
 	LibraryItemModel *_libraryModel;
 
 	/** Shortcut widget to navigate quickly in a big treeview. */
@@ -51,8 +44,8 @@ private:
 	 */
 	CircleProgressBar *_circleProgressBar;
 
-	/** Cache of expanded albums and their covers. */
-	QMap<AlbumItem*, QImage*> _expandedCovers;
+	/** Cache of expanded albums and their covers, by internal id of albums in the source model. */
+	QHash<quintptr, QImage*> _expandedCovers;
 
 	/** This view uses a proxy to specify how items in the Tree should be ordered together. */
 	MiamSortFilterProxyModel *_proxyModel;
@@ -69,7 +62,7 @@ public:
 
 	void createConnectionsToDB();
 
-	const QImage *expandedCover(AlbumItem *album) const;
+	const QImage *expandedCover(const QModelIndex &album) const;
 
 	/** Reimplemented. */
 	virtual void findAll(const QModelIndex &index, QStringList &tracks) const override;
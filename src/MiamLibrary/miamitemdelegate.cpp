@@ -6,17 +6,17 @@
 
 qreal MiamItemDelegate::_iconOpacity = 1.0;
 
-MiamItemDelegate::MiamItemDelegate(QSortFilterProxyModel *proxy)
+MiamItemDelegate::MiamItemDelegate(MiamSortFilterProxyModel *proxy)
 	: QStyledItemDelegate(proxy), _proxy(proxy), _timer(new QTimer(this))
 {
 	_coverSize = SettingsPrivate::instance()->coverSize();
-	_libraryModel = qobject_cast<QStandardItemModel*>(_proxy->sourceModel());
+	_libraryModel = _proxy->sourceModel();
 	_showCovers = SettingsPrivate::instance()->isCoversEnabled();
 	_timer->setTimerType(Qt::PreciseTimer);
 	_timer->setInterval(10);
 }
 
-void MiamItemDelegate::drawLetter(QPainter *painter, QStyleOptionViewItem &option, SeparatorItem *item) const
+void MiamItemDelegate::drawLetter(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const
 {
 	// One cannot interact with an alphabetical separator
 	option.state = QStyle::State_None;
@@ -26,16 +26,16 @@ void MiamItemDelegate::drawLetter(QPainter *painter, QStyleOptionViewItem &optio
 	p2.setX(p2.x() - 2);
 	painter->setPen(Qt::gray);
 	painter->drawLine(p1, p2);
-	QStyledItemDelegate::paint(painter, option, item->index());
+	QStyledItemDelegate::paint(painter, option, index);
 }
 
-void MiamItemDelegate::drawTrack(QPainter *painter, QStyleOptionViewItem &option, TrackItem *track) const
+void MiamItemDelegate::drawTrack(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &track) const
 {
-	int trackNumber = track->data(Miam::DF_TrackNumber).toInt();
+	int trackNumber = track.data(Miam::DF_TrackNumber).toInt();
 	if (trackNumber > 0) {
-		option.text = QString("%1").arg(trackNumber, 2, 10, QChar('0')).append(". ").append(track->text());
+		option.text = QString("%1").arg(trackNumber, 2, 10, QChar('0')).append(". ").append(track.data().toString());
 	} else {
-		option.text = track->text();
+		option.text = track.data().toString();
 	}
 	QFontMetrics fmf(SettingsPrivate::instance()->font(SettingsPrivate::FF_Library));
 	option.textElideMode = Qt::ElideRight;
@@ -72,7 +72,7 @@ void MiamItemDelegate::paintRect(QPainter *painter, const QStyleOptionViewItem &
 }
 
 /** Check if color needs to be inverted then paint text. */
-void MiamItemDelegate::paintText(QPainter *p, const QStyleOptionViewItem &opt, const QRect &rectText, const QString &text, const QStandardItem *item) const
+void MiamItemDelegate::paintText(QPainter *p, const QStyleOptionViewItem &opt, const QRect &rectText, const QString &text, const QModelIndex &index) const
 {
 	p->save();
 	if (text.isEmpty()) {
@@ -87,7 +87,7 @@ void MiamItemDelegate::paintText(QPainter *p, const QStyleOptionViewItem &opt, c
 				p->setPen(opt.palette.highlightedText().color());
 			}
 		}
-		if (item->data(Miam::DF_Highlighted).toBool()) {
+		if (_proxy->isHighlighted(index)) {
 			QFont f = p->font();
 			f.setBold(true);
 			p->setFont(f);
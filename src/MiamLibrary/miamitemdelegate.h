@@ -2,7 +2,7 @@
 #define MIAMITEMDELEGATE_H
 
 #include <QStyledItemDelegate>
-#include <QSortFilterProxyModel>
+#include <miamsortfilterproxymodel.h>
 #include <QTimer>
 #include "albumitem.h"
 #include "artistitem.h"
@@ -24,8 +24,8 @@ class MIAMLIBRARY_LIBRARY MiamItemDelegate : public QStyledItemDelegate
 protected:
 	static qreal _iconOpacity;
 
-	QStandardItemModel *_libraryModel;
-	QSortFilterProxyModel *_proxy;
+	QAbstractItemModel *_libraryModel;
+	MiamSortFilterProxyModel *_proxy;
 	bool _showCovers;
 
 	/** This timer is used to animate album cover when one is scrolling.
@@ -36,20 +36,20 @@ protected:
 	int _coverSize;
 
 public:
-	explicit MiamItemDelegate(QSortFilterProxyModel *proxy);
+	explicit MiamItemDelegate(MiamSortFilterProxyModel *proxy);
 
 protected:
-	virtual void drawAlbum(QPainter *painter, QStyleOptionViewItem &option, AlbumItem *item) const = 0;
+	virtual void drawAlbum(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const = 0;
 
-	virtual void drawArtist(QPainter *painter, QStyleOptionViewItem &option, ArtistItem *item) const = 0;
+	virtual void drawArtist(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const = 0;
 
-	void drawLetter(QPainter *painter, QStyleOptionViewItem &option, SeparatorItem *item) const;
+	void drawLetter(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const;
 
-	virtual void drawTrack(QPainter *painter, QStyleOptionViewItem &option, TrackItem *track) const;
+	virtual void drawTrack(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &track) const;
 
 	void paintRect(QPainter *painter, const QStyleOptionViewItem &option) const;
 
-	void paintText(QPainter *p, const QStyleOptionViewItem &opt, const QRect &rectText, const QString &text, const QStandardItem *item) const;
+	void paintText(QPainter *p, const QStyleOptionViewItem &opt, const QRect &rectText, const QString &text, const QModelIndex &index) const;
 };
 
 #endif // MIAMITEMDELEGATE_H
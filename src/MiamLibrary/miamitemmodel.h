@@ -3,7 +3,8 @@
 
 #include <QStandardItemModel>
 #include <QSortFilterProxyModel>
-#include <model/genericdao.h>
+#include <QVector>
+#include <model/librarynode.h>
 #include "separatoritem.h"
 
 #include "miamlibrary_global.hpp"
@@ -45,9 +46,9 @@ protected:
 	void removeNode(const QModelIndex &node);
 
 public slots:
-	virtual void insertNode(GenericDAO *node) = 0;
+	virtual void insertNodes(const QVector<LibraryNode> &nodes) = 0;
 
-	virtual void updateNode(GenericDAO *node);
+	virtual void updateNode(const LibraryNode &node);
 };
 
 #endif // MIAMITEMMODEL_H
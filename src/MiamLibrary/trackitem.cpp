@@ -1,18 +1,18 @@
 #include "trackitem.h"
 #include "miamcore_global.h"
 
-TrackItem::TrackItem(const TrackDAO *dao) :
-	QStandardItem(dao->title())
+TrackItem::TrackItem(const LibraryNode &node) :
+	QStandardItem(node.title())
 {
-	setData(dao->uri(), Miam::DF_URI);
-	//setData(dao->titleNormalized(), Miam::DF_NormalizedString);
-	setData(dao->trackNumber(), Miam::DF_TrackNumber);
-	setData(dao->disc().toInt(), Miam::DF_DiscNumber);
-	setData(dao->length(), Miam::DF_TrackLength);
-	if (dao->rating() != -1) {
-		setData(dao->rating(), Miam::DF_Rating);
+	setData(node.uri(), Miam::DF_URI);
+	//setData(node.titleNormalized(), Miam::DF_NormalizedString);
+	setData(node.trackNumber(), Miam::DF_TrackNumber);
+	setData(node.disc(), Miam::DF_DiscNumber);
+	setData(node.length(), Miam::DF_TrackLength);
+	if (node.rating() != -1) {
+		setData(node.rating(), Miam::DF_Rating);
 	}
-	setData(!dao->uri().startsWith("file://"), Miam::DF_IsRemote);
+	setData(!node.uri().startsWith("file://"), Miam::DF_IsRemote);
 }
 
 int TrackItem::type() const
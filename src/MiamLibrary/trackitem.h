@@ -2,7 +2,7 @@
 #define TRACKITEM_H
 
 #include <QStandardItem>
-#include "model/trackdao.h"
+#include "model/librarynode.h"
 #include "miamlibrary_global.hpp"
 
 /**
@@ -13,7 +13,7 @@
 class MIAMLIBRARY_LIBRARY TrackItem : public QStandardItem
 {
 public:
-	explicit TrackItem(const TrackDAO *dao);
+	explicit TrackItem(const LibraryNode &node);
 
 	virtual int type() const override;
 };
@@ -79,7 +79,7 @@ CustomizeOptionsDialog::CustomizeOptionsDialog(PluginManager *pluginManager, QWi
 	settings->isFileSystemMonitored() ? radioButtonEnableMonitorFS->setChecked(true) : radioButtonDisableMonitorFS->setChecked(true);
 	connect(radioButtonEnableMonitorFS, &QRadioButton::toggled, this, [=](bool b) {
 		settings->setMonitorFileSystem(b);
-		SqlDatabase::instance()->musicSearchEngine()->setWatchForChanges(b);
+		SqlDatabase::instance()->setWatchForChanges(b);
 	});
 
 	// Second panel: languages
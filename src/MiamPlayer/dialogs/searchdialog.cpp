@@ -202,8 +202,7 @@ void SearchDialog::clear()
 
 void SearchDialog::artistWasDoubleClicked(const QModelIndex &artistIndex)
 {
-	SqlDatabase *db = SqlDatabase::instance();
-	QSqlQuery selectTracks(*db);
+	QSqlQuery selectTracks(SqlDatabase::instance()->readConnection());
 	selectTracks.prepare("SELECT t.uri FROM tracks t INNER JOIN albums al ON t.albumId = al.id " \
 		"INNER JOIN artists a ON t.artistId = a.id WHERE a.id = ? ORDER BY al.year");
 	QString artistId = artistIndex.data(DT_Identifier).toString();
@@ -222,8 +221,7 @@ void SearchDialog::artistWasDoubleClicked(const QModelIndex &artistIndex)
 
 void SearchDialog::albumWasDoubleClicked(const QModelIndex &albumIndex)
 {
-	SqlDatabase *db = SqlDatabase::instance();
-	QSqlQuery selectTracks(*db);
+	QSqlQuery selectTracks(SqlDatabase::instance()->readConnection());
 	selectTracks.prepare("SELECT t.uri FROM tracks t INNER JOIN albums al ON t.albumId = al.id WHERE al.id = ?");
 	QString albumId = albumIndex.data(DT_Identifier).toString();
 	selectTracks.addBindValue(albumId);
@@ -285,13 +283,12 @@ void SearchDialog::localSearch(const QString &text)
 		return;
 	}
 
-	auto _db = SqlDatabase::instance();
+	// Names are looked up in the full-text index, with the read-only connection of this thread
+	auto db = SqlDatabase::instance();
 
 	/// XXX: Factorize this, 3 times the (almost) same code
-	QSqlQuery qSearchForArtists(*_db);
-	qSearchForArtists.prepare("SELECT DISTINCT a.name, a.id FROM artists a WHERE a.name like :t LIMIT 5");
-	qSearchForArtists.bindValue(":t", "%" + text + "%");
-	if (qSearchForArtists.exec()) {
+	QSqlQuery qSearchForArtists = db->searchLibrary(Miam::IT_Artist, text, 5);
+	if (qSearchForArtists.isActive()) {
 		QList<QStandardItem*> artistList;
 		while (qSearchForArtists.next()) {
 			QStandardItem *artist = new QStandardItem(qSearchForArtists.record().value(0).toString());
@@ -302,10 +299,8 @@ void SearchDialog::localSearch(const QString &text)
 		this->processResults(Artist, artistList);
 	}
 
-	QSqlQuery qSearchForAlbums(*_db);
-	qSearchForAlbums.prepare("SELECT DISTINCT alb.name, art.name, alb.id FROM albums alb INNER JOIN artists art ON alb.artistId = art.id WHERE alb.name like :t LIMIT 5");
-	qSearchForAlbums.bindValue(":t", "%" + text + "%");
-	if (qSearchForAlbums.exec()) {
+	QSqlQuery qSearchForAlbums = db->searchLibrary(Miam::IT_Album, text, 5);
+	if (qSearchForAlbums.isActive()) {
 		QList<QStandardItem*> albumList;
 		while (qSearchForAlbums.next()) {
 			QStandardItem *album = new QStandardItem(qSearchForAlbums.record().value(0).toString() + " – " + qSearchForAlbums.record().value(1).toString());
@@ -316,10 +311,8 @@ void SearchDialog::localSearch(const QString &text)
 		this->processResults(Album, albumList);
 	}
 
-	QSqlQuery qSearchForTracks(*_db);
-	qSearchForTracks.prepare("SELECT DISTINCT t.title, COALESCE(t.artistAlbum, art.name), uri FROM tracks t INNER JOIN artists art ON t.artistId = art.id WHERE t.title like :t LIMIT 5");
-	qSearchForTracks.bindValue(":t", "%" + text + "%");
-	if (qSearchForTracks.exec()) {
+	QSqlQuery qSearchForTracks = db->searchLibrary(Miam::IT_Track, text, 5);
+	if (qSearchForTracks.isActive()) {
 		QList<QStandardItem*> trackList;
 		while (qSearchForTracks.next()) {
 			QSqlRecord r = qSearchForTracks.record();
@@ -1,6 +1,7 @@
 #include "playlistmodel.h"
 
 #include "model/sqldatabase.h"
+#include "model/stringpool.h"
 #include "filehelper.h"
 #include "settingsprivate.h"
 #include "starrating.h"
@@ -14,6 +15,7 @@
 
 #include <QtDebug>
 
+#include "playlist.h"
 #include "playlistheaderview.h"
 
 PlaylistModel::PlaylistModel(QObject *parent)
@@ -62,6 +64,8 @@ bool PlaylistModel::insertMedias(int rowIndex, const QList<QMediaContent> &track
 bool PlaylistModel::insertMedias(int rowIndex, const QStringList &tracks)
 {
 	int c = this->rowCount();
+	QList<QPersistentModelIndex> remoteLines;
+	QStringList remoteTracks;
 	for (int i = 0; i < tracks.size(); i++) {
 		QString trackStr = tracks.at(i);
 		if (trackStr.startsWith("file")) {
@@ -76,11 +80,25 @@ bool PlaylistModel::insertMedias(int rowIndex, const QStringList &tracks)
 			/// A new class like TrackLoader should be created. It could be a unique place to dispatch URIs to relevant plugins which can load remote tracks
 			/// TrackDAO track = TrackLoader::instance()->loadFromUri(uri)
 			/// However, to avoid too much requests to remove server, it might be useful to update the line only before playback started
-			TrackDAO track = SqlDatabase::instance()->selectTrackByURI(trackStr);
-			//qDebug() << "remote track to be fully reloaded" << trackStr;
+			// Lines are inserted at once with their URI, and filled when tracks have been read on the database thread
+			TrackDAO track;
+			track.setUri(trackStr);
+			track.setTitle(trackStr);
 			this->createLine(rowIndex + i, track);
+			remoteLines << QPersistentModelIndex(this->index(rowIndex + i, 0));
+			remoteTracks << trackStr;
 		}
 	}
+	if (!remoteTracks.isEmpty()) {
+		SqlDatabase::instance()->selectTracksByURI(remoteTracks, this, [this, remoteLines] (const QList<TrackDAO> &tracks) {
+			for (int i = 0; i < tracks.size(); i++) {
+				// Lines may have been moved or removed meanwhile, and unknown tracks keep their URI
+				if (remoteLines.at(i).isValid() && !tracks.at(i).uri().isEmpty()) {
+					this->updateLine(remoteLines.at(i).row(), tracks.at(i));
+				}
+			}
+		});
+	}
 	return c < this->rowCount();
 }
 
@@ -96,42 +114,62 @@ bool PlaylistModel::insertMedias(int rowIndex, const QList<TrackDAO> &tracks)
 
 void PlaylistModel::createLine(int row, const TrackDAO &track)
 {
-	QStandardItem *trackItem = new QStandardItem;
-	if (!track.trackNumber().isEmpty()) {
+	QList<QStandardItem *> items;
+	for (int column = 0; column <= Playlist::COL_TRACK_DAO; column++) {
+		items << new QStandardItem;
+	}
+	this->fillLine(items, track);
+
+	this->insertRow(row, items);
+	_mediaPlaylist->insertMedia(row, QMediaContent(QUrl(track.uri())));
+}
+
+/** Sets the content of each column of a line, which may be in this model already. */
+void PlaylistModel::fillLine(const QList<QStandardItem*> &items, const TrackDAO &track)
+{
+	QStandardItem *trackItem = items.at(Playlist::COL_TRACK_NUMBER);
+	if (track.trackNumber().isEmpty()) {
+		trackItem->setText(QString());
+	} else {
 		trackItem->setText(QString("%1").arg(track.trackNumber().toInt(), 2, 10, QChar('0')));
 	}
-	QStandardItem *titleItem = new QStandardItem(track.title());
-	QStandardItem *albumItem = new QStandardItem(track.album());
-	QStandardItem *lengthItem = new QStandardItem(track.length());
-	QStandardItem *artistItem = new QStandardItem(track.artist());
-	QStandardItem *ratingItem = new QStandardItem;
+	items.at(Playlist::COL_TITLE)->setText(track.title());
+	items.at(Playlist::COL_ALBUM)->setText(track.album());
+	items.at(Playlist::COL_LENGTH)->setText(track.length());
+	items.at(Playlist::COL_ARTIST)->setText(track.artist());
+	QStandardItem *ratingItem = items.at(Playlist::COL_RATINGS);
 	StarRating r(track.rating());
 	ratingItem->setData(QVariant::fromValue(r), Qt::DisplayRole);
 	ratingItem->setData(true, RemoteMedia);
 	ratingItem->setToolTip(tr("You cannot modify remote medias"));
 
-	QStandardItem *yearItem = new QStandardItem(track.year());
-	QStandardItem *iconItem = new QStandardItem;
-	if (!track.icon().isEmpty()) {
+	items.at(Playlist::COL_YEAR)->setText(track.year());
+	QStandardItem *iconItem = items.at(Playlist::COL_ICON);
+	if (track.icon().isEmpty()) {
+		iconItem->setIcon(QIcon());
+	} else {
 		iconItem->setIcon(QIcon(track.icon()));
 	}
 	iconItem->setToolTip(track.source());
-	QUrl url(track.uri());
 
-	QStandardItem *trackDAO = new QStandardItem;
-	trackDAO->setData(QVariant::fromValue(track), Qt::DisplayRole);
+	items.at(Playlist::COL_TRACK_DAO)->setData(QVariant::fromValue(track), Qt::DisplayRole);
 
 	trackItem->setTextAlignment(Qt::AlignCenter);
-	lengthItem->setTextAlignment(Qt::AlignCenter);
+	items.at(Playlist::COL_LENGTH)->setTextAlignment(Qt::AlignCenter);
 	ratingItem->setTextAlignment(Qt::AlignCenter);
-	yearItem->setTextAlignment(Qt::AlignCenter);
-
-	QList<QStandardItem *> items;
-	items << trackItem << titleItem << albumItem << lengthItem << artistItem << ratingItem \
-		  << yearItem << iconItem << trackDAO;
+	items.at(Playlist::COL_YEAR)->setTextAlignment(Qt::AlignCenter);
+}
 
-	this->insertRow(row, items);
-	_mediaPlaylist->insertMedia(row, QMediaContent(url));
+/** Replaces the content of a line. */
+void PlaylistModel::updateLine(int row, const TrackDAO &track)
+{
+	QList<QStandardItem*> items;
+	for (int column = 0; column <= Playlist::COL_TRACK_DAO; column++) {
+		items << this->item(row, column);
+	}
+	if (!items.contains(nullptr)) {
+		this->fillLine(items, track);
+	}
 }
 
 void PlaylistModel::insertMedia(int rowIndex, const FileHelper &fileHelper)
@@ -151,12 +189,16 @@ void PlaylistModel::insertMedia(int rowIndex, const FileHelper &fileHelper)
 			title = fileHelper.title();
 		}
 
-		// Then, construct a new row with correct informations
+		// Then, construct a new row with correct informations. Tags repeated in many files are shared with the library
+		StringPool *pool = StringPool::instance();
+		QString album = pool->intern(fileHelper.album());
+		QString artist = pool->intern(fileHelper.artist());
+		QString year = pool->intern(fileHelper.year());
 		trackItem = new QStandardItem(fileHelper.trackNumber());
 		titleItem = new QStandardItem(title);
-		albumItem = new QStandardItem(fileHelper.album());
+		albumItem = new QStandardItem(album);
 		lengthItem = new QStandardItem(fileHelper.length());
-		artistItem = new QStandardItem(fileHelper.artist());
+		artistItem = new QStandardItem(artist);
 		ratingItem = new QStandardItem;
 		int rating = fileHelper.rating();
 		if (rating > 0) {
@@ -164,18 +206,18 @@ void PlaylistModel::insertMedia(int rowIndex, const FileHelper &fileHelper)
 			ratingItem->setData(QVariant::fromValue(r), Qt::DisplayRole);
 			ratingItem->setData(false, RemoteMedia);
 		}
-		yearItem = new QStandardItem(fileHelper.year());
+		yearItem = new QStandardItem(year);
 
 
 		QString absPath = fileHelper.fileInfo().absoluteFilePath();
 		TrackDAO track;
 		track.setTrackNumber(fileHelper.trackNumber());
 		track.setTitle(fileHelper.title());
-		track.setAlbum(fileHelper.album());
+		track.setAlbum(album);
 		track.setLength(fileHelper.length());
-		track.setArtist(fileHelper.artist());
+		track.setArtist(artist);
 		track.setRating(fileHelper.rating());
-		track.setYear(fileHelper.year());
+		track.setYear(year);
 		track.setId(QString::number(qHash(absPath)));
 		track.setUri(QUrl::fromLocalFile(absPath).toString());
 		trackDAO->setData(QVariant::fromValue(track), Qt::DisplayRole);
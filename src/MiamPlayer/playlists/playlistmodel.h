@@ -57,6 +57,12 @@ public:
 private:
 	void createLine(int row, const TrackDAO &track);
 
+	/** Sets the content of each column of a line, which may be in this model already. */
+	void fillLine(const QList<QStandardItem*> &items, const TrackDAO &track);
+
+	/** Replaces the content of a line. */
+	void updateLine(int row, const TrackDAO &track);
+
 	void insertMedia(int rowIndex, const FileHelper &fileHelper);
 };
 
@@ -428,11 +428,7 @@ void TagEditor::displayCover()
 	joinedTracks.append("\"\"");
 
 	// Fill the comboBox for the absolute path to the cover (if exists)
-	SqlDatabase *db = SqlDatabase::instance();
-	if (!db->isOpen()) {
-		db->open();
-	}
-	QSqlQuery coverPathQuery = db->exec("SELECT DISTINCT cover FROM tracks WHERE uri IN (" + joinedTracks + ")");
+	QSqlQuery coverPathQuery = SqlDatabase::instance()->readConnection().exec("SELECT DISTINCT cover FROM tracks WHERE uri IN (" + joinedTracks + ")");
 	QSet<QString> coversPath;
 	while (coverPathQuery.next()) {
 		coversPath << coverPathQuery.record().value(0).toString();
@@ -6,4 +6,5 @@ SUBDIRS += \
     MiamCore \
     MiamLibrary \
     MiamUniqueLibrary \
-    MiamPlayer
+    MiamPlayer \
+    MiamTests
@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    fieldnormalizer \
+    libraryloader \
+    readonlyfilestream
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_fieldnormalizer
+
+SOURCES += \
+    tst_fieldnormalizer.cpp
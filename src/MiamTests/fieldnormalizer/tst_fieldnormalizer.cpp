@@ -0,0 +1,130 @@
+#include <model/fieldnormalizer.h>
+
+#include <QRegularExpression>
+#include <QtTest>
+
+/**
+ * \brief		The FieldNormalizerTest class checks that FieldNormalizer gives the same names as the regular expression it
+ *				has replaced, since normalized names identify artists and albums already stored in databases.
+ * \details		The corpus has names found in tags, and every character of the Basic Multilingual Plane on its own and
+ *				between ASCII characters. Both implementations are measured on a list of names like those of a library.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class FieldNormalizerTest : public QObject
+{
+	Q_OBJECT
+private:
+	QStringList _library;
+
+	/** Names built for benchmarks. */
+	static const int LIBRARY_SIZE;
+
+	/** Previous implementation of SqlDatabase::normalizeField(). */
+	static QString normalizeWithRegExp(const QString &s);
+
+private slots:
+	void initTestCase();
+
+	void sameNames_data();
+	void sameNames();
+
+	void sameCharacters();
+
+	void normalize_data();
+	void normalize();
+};
+
+const int FieldNormalizerTest::LIBRARY_SIZE = 20000;
+
+/** Previous implementation of SqlDatabase::normalizeField(). */
+QString FieldNormalizerTest::normalizeWithRegExp(const QString &s)
+{
+	static QRegularExpression regExp("[^\\w]");
+	QString sNormed = s.toLower().normalized(QString::NormalizationForm_KD).remove(regExp).trimmed();
+	if (sNormed.isEmpty()) {
+		return s.toLower().remove(" ").trimmed();
+	} else {
+		return sNormed;
+	}
+}
+
+void FieldNormalizerTest::initTestCase()
+{
+	// Mostly ASCII names, and some which need to be folded, all different
+	static const QStringList artists = { "The Beatles", "Sigur Rós", "Björk", "Motörhead", "Mötley Crüe", "AC/DC",
+		"Beyoncé", "Daft Punk", "Queensrÿche", "Pink Floyd", "Led Zeppelin", "坂本龍一", "Radiohead", "Émilie Simon" };
+	static const QStringList words = { "Live", "Greatest Hits", "Remastered", "Café", "Night", "Señorita", "Deluxe Edition",
+		"Vol. 2", "Straße", "Dreams" };
+	_library.reserve(LIBRARY_SIZE);
+	for (int i = 0; i < LIBRARY_SIZE; i++) {
+		_library << QString("%1 - %2 %3").arg(artists.at(i % artists.size()), words.at(i % words.size())).arg(i);
+	}
+}
+
+void FieldNormalizerTest::sameNames_data()
+{
+	QTest::addColumn<QString>("name");
+	static const QStringList names = {
+		"", " ", "   ", "-", "!!!", "...", "_", "The Beatles", "  Spaces   Around  ", "AC/DC", "Guns N' Roses",
+		"Sigur Rós", "Björk", "Motörhead", "Mötley Crüe", "Queensrÿche", "Émilie Simon", "Françoise Hardy",
+		"Straße", "Æon Flux", "Œuvre", "Ångström", "Øystein", "Łódź", "İstanbul", "Ⅻ Monkeys", "ﬁnal", "ＦＵＬＬ ｗｉｄｔｈ",
+		"½ Dozen", "²nd", "Ǆ", "ǅ", "ǆ", "Ελληνικά", "Кино", "עברית", "العربية", "坂本龍一", "ポルノグラフィティ",
+		"방탄소년단", "Việt Nam", "Mötley Crüe 😀", "𝐁𝐨𝐥𝐝", "𠀀𠀁", "Café́", "é", " No Break",
+		"ⅠⅡ", "Tab\tName", "Line\nName", "ß", "ẞ", "ﬀ", "™", "℃", "№ 9", "①②③"
+	};
+	for (int i = 0; i < names.size(); i++) {
+		QTest::newRow(qPrintable(QString::number(i))) << names.at(i);
+	}
+}
+
+void FieldNormalizerTest::sameNames()
+{
+	QFETCH(QString, name);
+	QCOMPARE(FieldNormalizer::normalize(name), normalizeWithRegExp(name));
+
+	// Non-ASCII results are cached: the second call must give the same name
+	QCOMPARE(FieldNormalizer::normalize(name), normalizeWithRegExp(name));
+}
+
+/** Tables of characters are built for each block of 256 characters: every one of them is checked. */
+void FieldNormalizerTest::sameCharacters()
+{
+	for (int u = 0; u <= 0xffff; u++) {
+		QChar c(u);
+		if (c.isSurrogate()) {
+			continue;
+		}
+		for (QString name : { QString(c), QString("Ab%1 9").arg(c) }) {
+			QString expected = normalizeWithRegExp(name);
+			QString actual = FieldNormalizer::normalize(name);
+			QVERIFY2(actual == expected, qPrintable(QString("U+%1: \"%2\" instead of \"%3\"")
+				.arg(u, 4, 16, QChar('0')).arg(actual, expected)));
+		}
+	}
+}
+
+void FieldNormalizerTest::normalize_data()
+{
+	QTest::addColumn<bool>("isRegExp");
+	QTest::newRow("regexp") << true;
+	QTest::newRow("fieldnormalizer") << false;
+}
+
+void FieldNormalizerTest::normalize()
+{
+	QFETCH(bool, isRegExp);
+	QBENCHMARK {
+		for (const QString &name : _library) {
+			if (isRegExp) {
+				normalizeWithRegExp(name);
+			} else {
+				FieldNormalizer::normalize(name);
+			}
+		}
+	}
+}
+
+QTEST_MAIN(FieldNormalizerTest)
+
+#include "tst_fieldnormalizer.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_libraryloader
+
+SOURCES += \
+    tst_libraryloader.cpp
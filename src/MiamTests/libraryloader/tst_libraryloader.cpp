@@ -0,0 +1,214 @@
+#include <model/libraryloader.h>
+#include <model/librarysnapshot.h>
+#include <model/nodestore.h>
+#include <settingsprivate.h>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/**
+ * \brief		The LibraryLoaderTest class measures how long the library takes to be loaded at startup.
+ * \details		A library of artists, albums and tracks is generated in a temporary database. Queries which were run before
+ *				the loader (one per artist and one per album) are measured against the single streamed query of the
+ *				loader, and against a snapshot of the same library.
+ *				Settings are read in the test location of QStandardPaths, so nodes are grouped by artists.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class LibraryLoaderTest : public QObject
+{
+	Q_OBJECT
+private:
+	QTemporaryDir _dir;
+	QString _databaseName;
+
+	static const int ARTIST_COUNT;
+	static const int ALBUMS_PER_ARTIST;
+	static const int TRACKS_PER_ALBUM;
+
+	static const QString CONNECTION_NAME;
+
+	/** Every node of the generated library: artists, albums and tracks. */
+	static quint32 nodeCount();
+
+private slots:
+	void initTestCase();
+
+	void cleanupTestCase();
+
+	/** Queries which were run by SqlDatabase::loadFromFileDB() before the loader. */
+	void loadWithQueriesPerAlbum();
+
+	void loadWithStreamedQuery();
+
+	void loadFromSnapshot();
+};
+
+const int LibraryLoaderTest::ARTIST_COUNT = 2000;
+const int LibraryLoaderTest::ALBUMS_PER_ARTIST = 5;
+const int LibraryLoaderTest::TRACKS_PER_ALBUM = 12;
+
+const QString LibraryLoaderTest::CONNECTION_NAME = "libraryLoaderTest";
+
+/** Every node of the generated library: artists, albums and tracks. */
+quint32 LibraryLoaderTest::nodeCount()
+{
+	return ARTIST_COUNT * (1 + ALBUMS_PER_ARTIST * (1 + TRACKS_PER_ALBUM));
+}
+
+void LibraryLoaderTest::initTestCase()
+{
+	QStandardPaths::setTestModeEnabled(true);
+	if (SettingsPrivate::instance()->insertPolicy() != SettingsPrivate::IP_Artists) {
+		QSKIP("settings of the test location don't group nodes by artists");
+	}
+	QVERIFY(_dir.isValid());
+	_databaseName = _dir.path() + "/mp.db";
+
+	// Same tables and indexes as SqlDatabase::updateSchema()
+	QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION_NAME);
+	db.setDatabaseName(_databaseName);
+	QVERIFY(db.open());
+	QSqlQuery schema(db);
+	QVERIFY(schema.exec("CREATE TABLE hosts (id INTEGER PRIMARY KEY, name varchar(255) NOT NULL UNIQUE)"));
+	QVERIFY(schema.exec("CREATE TABLE artists (id INTEGER PRIMARY KEY, name varchar(255), normalizedName varchar(255) NOT NULL UNIQUE, " \
+		"icon varchar(255), hostId INTEGER)"));
+	QVERIFY(schema.exec("CREATE TABLE albums (id INTEGER PRIMARY KEY, name varchar(255), normalizedName varchar(255) NOT NULL, " \
+		"year INTEGER, cover varchar(255), artistId INTEGER NOT NULL, icon varchar(255), hostId INTEGER, UNIQUE(artistId, normalizedName))"));
+	QVERIFY(schema.exec("CREATE TABLE tracks (id INTEGER PRIMARY KEY, uri varchar(255) NOT NULL UNIQUE, trackNumber INTEGER, " \
+		"title varchar(255), artistId INTEGER, albumId INTEGER, artistAlbum varchar(255), length INTEGER, " \
+		"rating INTEGER, disc INTEGER, internalCover INTEGER DEFAULT 0, icon varchar(255), hostId INTEGER)"));
+	QVERIFY(schema.exec("CREATE TABLE properties (key varchar(255) PRIMARY KEY ASC, value varchar(255))"));
+	QVERIFY(schema.exec("CREATE INDEX albumsByArtist ON albums (artistId, id)"));
+	QVERIFY(schema.exec("CREATE INDEX albumsByYear ON albums (year, artistId, id)"));
+	QVERIFY(schema.exec("CREATE INDEX tracksByAlbum ON tracks (albumId, artistId)"));
+	QVERIFY(schema.exec("CREATE INDEX tracksByArtist ON tracks (artistId)"));
+
+	QVERIFY(db.transaction());
+	QSqlQuery insertArtist(db);
+	insertArtist.prepare("INSERT INTO artists (id, name, normalizedName) VALUES (?, ?, ?)");
+	QSqlQuery insertAlbum(db);
+	insertAlbum.prepare("INSERT INTO albums (id, name, normalizedName, year, artistId) VALUES (?, ?, ?, ?, ?)");
+	QSqlQuery insertTrack(db);
+	insertTrack.prepare("INSERT INTO tracks (uri, trackNumber, title, artistId, albumId, length, rating, disc) " \
+		"VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+	int albumId = 0;
+	for (int artistId = 1; artistId <= ARTIST_COUNT; artistId++) {
+		QString artist = QString("Artist %1").arg(artistId);
+		insertArtist.addBindValue(artistId);
+		insertArtist.addBindValue(artist);
+		insertArtist.addBindValue(QString("artist%1").arg(artistId));
+		QVERIFY2(insertArtist.exec(), qPrintable(insertArtist.lastError().text()));
+		for (int a = 0; a < ALBUMS_PER_ARTIST; a++) {
+			albumId++;
+			insertAlbum.addBindValue(albumId);
+			insertAlbum.addBindValue(QString("Album %1").arg(albumId));
+			insertAlbum.addBindValue(QString("album%1").arg(albumId));
+			insertAlbum.addBindValue(1970 + albumId % 50);
+			insertAlbum.addBindValue(artistId);
+			QVERIFY2(insertAlbum.exec(), qPrintable(insertAlbum.lastError().text()));
+			for (int t = 1; t <= TRACKS_PER_ALBUM; t++) {
+				insertTrack.addBindValue(QString("file:///music/%1/%2/%3.mp3").arg(artistId).arg(albumId).arg(t));
+				insertTrack.addBindValue(t);
+				insertTrack.addBindValue(QString("Track %1").arg(t));
+				insertTrack.addBindValue(artistId);
+				insertTrack.addBindValue(albumId);
+				insertTrack.addBindValue(180 + t);
+				insertTrack.addBindValue(-1);
+				insertTrack.addBindValue(1);
+				QVERIFY2(insertTrack.exec(), qPrintable(insertTrack.lastError().text()));
+			}
+		}
+	}
+	QVERIFY(db.commit());
+}
+
+void LibraryLoaderTest::cleanupTestCase()
+{
+	QSqlDatabase::database(CONNECTION_NAME).close();
+	QSqlDatabase::removeDatabase(CONNECTION_NAME);
+}
+
+/** Queries which were run by SqlDatabase::loadFromFileDB() before the loader. */
+void LibraryLoaderTest::loadWithQueriesPerAlbum()
+{
+	QSqlDatabase db = QSqlDatabase::database(CONNECTION_NAME);
+	QBENCHMARK {
+		quint32 nodes = 0;
+		QSqlQuery qArtists("SELECT id, name, normalizedName FROM artists", db);
+		while (qArtists.next()) {
+			uint artistId = qArtists.value(0).toUInt();
+			qArtists.value(1).toString();
+			qArtists.value(2).toString();
+			nodes++;
+
+			QSqlQuery qAlbums(db);
+			qAlbums.prepare("SELECT a.name, a.normalizedName, a.year, a.cover, h.name, a.icon, a.id FROM albums a " \
+				"LEFT JOIN hosts h ON a.hostId = h.id WHERE a.artistId = ?");
+			qAlbums.addBindValue(artistId);
+			QVERIFY(qAlbums.exec());
+			while (qAlbums.next()) {
+				for (int i = 0; i < 6; i++) {
+					qAlbums.value(i).toString();
+				}
+				uint albumId = qAlbums.value(6).toUInt();
+				nodes++;
+
+				QSqlQuery qTracks(db);
+				qTracks.prepare("SELECT uri, trackNumber, title, art.name AS artist, alb.name AS album, artistAlbum, length, rating, disc, " \
+					"internalCover, h.name, t.icon FROM tracks t INNER JOIN albums alb ON t.albumId = alb.id " \
+					"INNER JOIN artists art ON t.artistId = art.id LEFT JOIN hosts h ON t.hostId = h.id " \
+					"WHERE t.artistId = ? AND t.albumId = ?");
+				qTracks.addBindValue(artistId);
+				qTracks.addBindValue(albumId);
+				QVERIFY(qTracks.exec());
+				while (qTracks.next()) {
+					for (int i = 0; i < 12; i++) {
+						qTracks.value(i).toString();
+					}
+					nodes++;
+				}
+			}
+		}
+		QCOMPARE(nodes, nodeCount());
+	}
+}
+
+void LibraryLoaderTest::loadWithStreamedQuery()
+{
+	// Without any library version, the loader doesn't read nor save a snapshot
+	QSqlQuery(QSqlDatabase::database(CONNECTION_NAME)).exec("DELETE FROM properties WHERE key = 'libraryVersion'");
+	QBENCHMARK {
+		QSharedPointer<NodeStore> store(new NodeStore);
+		LibraryLoader loader(_databaseName, store);
+		loader.run();
+		QCOMPARE(store->size(), nodeCount());
+	}
+}
+
+void LibraryLoaderTest::loadFromSnapshot()
+{
+	QSqlQuery(QSqlDatabase::database(CONNECTION_NAME)).exec("INSERT OR REPLACE INTO properties (key, value) VALUES ('libraryVersion', 1)");
+	QFile::remove(LibrarySnapshot::filePathForDatabase(_databaseName));
+	{
+		QSharedPointer<NodeStore> store(new NodeStore);
+		LibraryLoader loader(_databaseName, store);
+		loader.run();
+	}
+	QVERIFY(QFile::exists(LibrarySnapshot::filePathForDatabase(_databaseName)));
+
+	QBENCHMARK {
+		QSharedPointer<NodeStore> store(new NodeStore);
+		LibraryLoader loader(_databaseName, store);
+		loader.run();
+		QCOMPARE(store->size(), nodeCount());
+	}
+}
+
+QTEST_MAIN(LibraryLoaderTest)
+
+#include "tst_libraryloader.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_readonlyfilestream
+
+SOURCES += \
+    tst_readonlyfilestream.cpp
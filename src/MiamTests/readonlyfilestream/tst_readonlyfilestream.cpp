@@ -0,0 +1,104 @@
+#include <filehelper.h>
+#include <tagreader.h>
+
+#include <QDirIterator>
+#include <QtTest>
+
+/**
+ * \brief		The ReadOnlyFileStreamTest class compares the streams used to read tags during scans with the one of TagLib.
+ * \details		No audio file is shipped with the sources: files are read in the directory given by MIAM_TEST_MUSIC_DIR, and
+ *				every test is skipped without it. Files are read once before benchmarks, so every mode is measured with the
+ *				same cache of the system.
+ * \author      Matthieu Bachelier
+ * \copyright   GNU General Public License v3
+ */
+class ReadOnlyFileStreamTest : public QObject
+{
+	Q_OBJECT
+private:
+	QStringList _files;
+
+	/** Number of files which are read, at most. */
+	static const int MAX_FILES;
+
+private slots:
+	void initTestCase();
+
+	/** Prefetched and mapped streams must give the same tags as the regular stream of TagLib. */
+	void sameTags_data();
+	void sameTags();
+
+	void readTags_data();
+	void readTags();
+};
+
+const int ReadOnlyFileStreamTest::MAX_FILES = 2000;
+
+void ReadOnlyFileStreamTest::initTestCase()
+{
+	QString dir = QString::fromLocal8Bit(qgetenv("MIAM_TEST_MUSIC_DIR"));
+	if (dir.isEmpty()) {
+		QSKIP("MIAM_TEST_MUSIC_DIR is not set");
+	}
+	QDirIterator it(dir, FileHelper::suffixes(FileHelper::Standard, true), QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext() && _files.size() < MAX_FILES) {
+		_files << it.next();
+	}
+	if (_files.isEmpty()) {
+		QSKIP("no audio file in MIAM_TEST_MUSIC_DIR");
+	}
+	for (QString file : _files) {
+		TagReader::readTags(file, FileHelper::DefaultIO);
+	}
+}
+
+void ReadOnlyFileStreamTest::sameTags_data()
+{
+	QTest::addColumn<int>("ioMode");
+	QTest::newRow("prefetched") << static_cast<int>(FileHelper::PrefetchedIO);
+	QTest::newRow("mapped") << static_cast<int>(FileHelper::MappedIO);
+}
+
+void ReadOnlyFileStreamTest::sameTags()
+{
+	QFETCH(int, ioMode);
+	for (QString file : _files) {
+		TrackMetadata expected = TagReader::readTags(file, FileHelper::DefaultIO, FileHelper::ReadAll);
+		TrackMetadata actual = TagReader::readTags(file, static_cast<FileHelper::IOMode>(ioMode), FileHelper::ReadAll);
+		QCOMPARE(actual.isValid, expected.isValid);
+		QCOMPARE(actual.title, expected.title);
+		QCOMPARE(actual.artist, expected.artist);
+		QCOMPARE(actual.artistAlbum, expected.artistAlbum);
+		QCOMPARE(actual.album, expected.album);
+		QCOMPARE(actual.year, expected.year);
+		QCOMPARE(actual.trackNumber, expected.trackNumber);
+		QCOMPARE(actual.disc, expected.disc);
+		QCOMPARE(actual.length, expected.length);
+		QCOMPARE(actual.rating, expected.rating);
+		QCOMPARE(actual.hasCover, expected.hasCover);
+	}
+}
+
+void ReadOnlyFileStreamTest::readTags_data()
+{
+	QTest::addColumn<int>("ioMode");
+	QTest::newRow("default") << static_cast<int>(FileHelper::DefaultIO);
+	QTest::newRow("prefetched") << static_cast<int>(FileHelper::PrefetchedIO);
+	QTest::newRow("mapped") << static_cast<int>(FileHelper::MappedIO);
+}
+
+/** Reads headers only, like a scan does. */
+void ReadOnlyFileStreamTest::readTags()
+{
+	QFETCH(int, ioMode);
+	FileHelper::IOMode mode = static_cast<FileHelper::IOMode>(ioMode);
+	QBENCHMARK {
+		for (QString file : _files) {
+			TagReader::readTags(file, mode);
+		}
+	}
+}
+
+QTEST_MAIN(ReadOnlyFileStreamTest)
+
+#include "tst_readonlyfilestream.moc"
@@ -0,0 +1,31 @@
+QT += multimedia sql testlib widgets
+
+TEMPLATE = app
+
+CONFIG += c++11 testcase
+
+CONFIG(debug, debug|release) {
+    win32: LIBS += -L$$OUT_PWD/../../MiamCore/debug/ -lMiamCore
+    OBJECTS_DIR = debug/.obj
+    MOC_DIR = debug/.moc
+}
+CONFIG(release, debug|release) {
+    win32: LIBS += -L$$OUT_PWD/../../MiamCore/release/ -lMiamCore
+    OBJECTS_DIR = release/.obj
+    MOC_DIR = release/.moc
+}
+unix {
+    LIBS += -L$$OUT_PWD/../../MiamCore/ -lmiam-core
+    QMAKE_CXXFLAGS += -std=c++11
+}
+unix:!macx {
+    LIBS += -ltag
+}
+macx {
+    LIBS += -L$$PWD/../../lib/osx/ -ltag
+    QMAKE_CXXFLAGS += -mmacosx-version-min=10.10
+}
+
+3rdpartyDir  = $$PWD/../MiamCore/3rdparty
+INCLUDEPATH += $$PWD/../MiamCore $$3rdpartyDir
+DEPENDPATH += $$PWD/../MiamCore $$3rdpartyDir
@@ -36,7 +36,7 @@ void ListView::createConnectionsToDB()
 		_model->proxy()->setDynamicSortFilter(true);
 	});
 	connect(db, &SqlDatabase::aboutToLoad, this, &ListView::reset);
-	connect(db, &SqlDatabase::nodeExtracted, _model, &UniqueLibraryItemModel::insertNode);
+	connect(db, &SqlDatabase::nodesExtracted, _model, &UniqueLibraryItemModel::insertNodes);
 	connect(db, &SqlDatabase::aboutToUpdateNode, _model, &UniqueLibraryItemModel::updateNode);
 	//connect(db, &SqlDatabase::aboutToCleanView, _model, &UniqueLibraryItemModel::cleanDanglingNodes);
 	db->load();
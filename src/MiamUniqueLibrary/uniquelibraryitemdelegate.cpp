@@ -3,11 +3,11 @@
 #include <settingsprivate.h>
 #include <QApplication>
 #include <QPainter>
-#include <QStandardItem>
+#include <QStandardItemModel>
 
 #include <QtDebug>
 
-UniqueLibraryItemDelegate::UniqueLibraryItemDelegate(JumpToWidget *jumpTo, QSortFilterProxyModel *proxy)
+UniqueLibraryItemDelegate::UniqueLibraryItemDelegate(JumpToWidget *jumpTo, MiamSortFilterProxyModel *proxy)
 	: MiamItemDelegate(proxy)
 	, _jumpTo(jumpTo)
 {}
@@ -19,7 +19,7 @@ void UniqueLibraryItemDelegate::paint(QPainter *painter, const QStyleOptionViewI
 	painter->save();
 	auto settings = SettingsPrivate::instance();
 	painter->setFont(settings->font(SettingsPrivate::FF_Library));
-	QStandardItem *item = _libraryModel->itemFromIndex(_proxy->mapToSource(index));
+	QStandardItem *item = qobject_cast<QStandardItemModel*>(_libraryModel)->itemFromIndex(_proxy->mapToSource(index));
 	QStyleOptionViewItem o = option;
 	initStyleOption(&o, index);
 	o.palette = QApplication::palette();
@@ -34,23 +34,23 @@ void UniqueLibraryItemDelegate::paint(QPainter *painter, const QStyleOptionViewI
 	switch (item->type()) {
 	case Miam::IT_Artist:
 		this->paintRect(painter, o);
-		this->drawArtist(painter, o, static_cast<ArtistItem*>(item));
+		this->drawArtist(painter, o, item->index());
 		break;
 	case Miam::IT_Album:
 		this->paintRect(painter, o);
-		this->drawAlbum(painter, o, static_cast<AlbumItem*>(item));
+		this->drawAlbum(painter, o, item->index());
 		break;
 	case Miam::IT_Disc:
 		//this->drawDisc(painter, o);
 		break;
 	case Miam::IT_Separator:
-		this->drawLetter(painter, o, static_cast<SeparatorItem*>(item));
+		this->drawLetter(painter, o, item->index());
 		break;
 	case Miam::IT_Track: {
 		int coverSize = settings->coverSize();
 		o.rect.adjust(coverSize, 0, 0, 0);
 		this->paintRect(painter, o);
-		this->drawTrack(painter, o, static_cast<TrackItem*>(item));
+		this->drawTrack(painter, o, item->index());
 		break;
 	}
 	default:
@@ -60,15 +60,15 @@ void UniqueLibraryItemDelegate::paint(QPainter *painter, const QStyleOptionViewI
 	painter->restore();
 }
 
-void UniqueLibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &option, AlbumItem *item) const
+void UniqueLibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const
 {
 	auto settings = SettingsPrivate::instance();
 	int coverSize = settings->coverSize();
 	option.rect.moveLeft(coverSize);
-	QString text = item->text();
-	QString year = item->data(Miam::DF_Year).toString();
+	QString text = index.data().toString();
+	QString year = index.data(Miam::DF_Year).toString();
 	if (!year.isEmpty() && (year.compare("0") != 0)) {
-		text.append(" [" + item->data(Miam::DF_Year).toString() + "]");
+		text.append(" [" + index.data(Miam::DF_Year).toString() + "]");
 	}
 	painter->drawText(option.rect, text);
 	QPoint c = option.rect.center();
@@ -76,39 +76,39 @@ void UniqueLibraryItemDelegate::drawAlbum(QPainter *painter, QStyleOptionViewIte
 	painter->drawLine(coverSize + textWidth + 5, c.y(), option.rect.right() - 5, c.y());
 
 	// Cover
-	QString coverPath = item->coverPath();
+	QString coverPath = index.data(Miam::DF_CoverPath).toString();
 	if (!coverPath.isEmpty()) {
 		//qDebug() << Q_FUNC_INFO << coverPath;
 	}
 }
 
-void UniqueLibraryItemDelegate::drawArtist(QPainter *painter, QStyleOptionViewItem &option, ArtistItem *item) const
+void UniqueLibraryItemDelegate::drawArtist(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const
 {
-	painter->drawText(option.rect, item->text());
+	painter->drawText(option.rect, index.data().toString());
 	QPoint c = option.rect.center();
-	int textWidth = painter->fontMetrics().width(item->text());
+	int textWidth = painter->fontMetrics().width(index.data().toString());
 	painter->drawLine(textWidth + 5, c.y(), option.rect.right() - 5, c.y());
 }
 
 #include <QDateTime>
 
-void UniqueLibraryItemDelegate::drawTrack(QPainter *p, QStyleOptionViewItem &option, TrackItem *track) const
+void UniqueLibraryItemDelegate::drawTrack(QPainter *p, QStyleOptionViewItem &option, const QModelIndex &track) const
 {
 	p->save();
-	int trackNumber = track->data(Miam::DF_TrackNumber).toInt();
+	int trackNumber = track.data(Miam::DF_TrackNumber).toInt();
 	if (trackNumber > 0) {
-		option.text = QString("%1").arg(trackNumber, 2, 10, QChar('0')).append(". ").append(track->text());
+		option.text = QString("%1").arg(trackNumber, 2, 10, QChar('0')).append(". ").append(track.data().toString());
 	} else {
-		option.text = track->text();
+		option.text = track.data().toString();
 	}
 	option.textElideMode = Qt::ElideRight;
 	QString s;
-	QString trackLength = QDateTime::fromTime_t(track->data(Miam::DF_TrackLength).toUInt()).toString("m:ss");
+	QString trackLength = QDateTime::fromTime_t(track.data(Miam::DF_TrackLength).toUInt()).toString("m:ss");
 
 	QFont f = SettingsPrivate::instance()->font(SettingsPrivate::FF_Library);
 	// Current track is being played
-	if (track->data(Miam::DF_Highlighted).toBool()) {
-		uint currentPos = track->data(Miam::DF_CurrentPosition).toUInt();
+	if (track.data(Miam::DF_Highlighted).toBool()) {
+		uint currentPos = track.data(Miam::DF_CurrentPosition).toUInt();
 		QString trackCurrentPos = QDateTime::fromTime_t(currentPos).toString("m:ss");
 		trackLength.prepend(trackCurrentPos + " / ");
 		f.setBold(true);
@@ -141,7 +141,7 @@ void UniqueLibraryItemDelegate::drawTrack(QPainter *p, QStyleOptionViewItem &opt
 				p->setPen(option.palette.highlightedText().color());
 			}
 		}
-		if (track->data(Miam::DF_Highlighted).toBool()) {
+		if (track.data(Miam::DF_Highlighted).toBool() || _proxy->isHighlighted(track)) {
 			QFont f = p->font();
 			f.setBold(true);
 			p->setFont(f);
@@ -20,17 +20,17 @@ private:
 	JumpToWidget *_jumpTo;
 
 public:
-	explicit UniqueLibraryItemDelegate(JumpToWidget *jumpTo, QSortFilterProxyModel *proxy);
+	explicit UniqueLibraryItemDelegate(JumpToWidget *jumpTo, MiamSortFilterProxyModel *proxy);
 
 	/** Redefined. */
 	virtual void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
 protected:
-	virtual void drawAlbum(QPainter *painter, QStyleOptionViewItem &option, AlbumItem *item) const override;
+	virtual void drawAlbum(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
-	virtual void drawArtist(QPainter *painter, QStyleOptionViewItem &option, ArtistItem *item) const override;
+	virtual void drawArtist(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
-	virtual void drawTrack(QPainter *painter, QStyleOptionViewItem &option, TrackItem *track) const override;
+	virtual void drawTrack(QPainter *painter, QStyleOptionViewItem &option, const QModelIndex &track) const override;
 };
 
 #endif // UNIQUELIBRARYITEMDELEGATE_H
@@ -37,58 +37,107 @@ MiamSortFilterProxyModel *UniqueLibraryItemModel::proxy() const
 	return _proxy;
 }
 
-/** Find and insert a node in the hierarchy of items. */
-void UniqueLibraryItemModel::insertNode(GenericDAO *node)
+/** Builds the row of a node: the node itself, then its album and its artist when they exist. */
+QList<QStandardItem*> UniqueLibraryItemModel::createRow(const LibraryNode &node) const
 {
-	if (!node) {
-		return;
-	}
-
 	QList<QStandardItem*> row;
 	QStandardItem *nodeItem = nullptr;
-	if (TrackDAO *dao = qobject_cast<TrackDAO*>(node)) {
-		nodeItem = new TrackItem(dao);
+	switch (node.type()) {
+	case Miam::IT_Track: {
+		nodeItem = new TrackItem(node);
 		row << nodeItem;
-		QString normalized = dao->disc() + "|" + dao->trackNumber(true) + "|" + dao->title();
-		AlbumDAO *album = static_cast<AlbumDAO*>(dao->parentNode());
-		if (album) {
-			normalized.prepend(album->year() + "|" + album->title() + "|");
-			row << new QStandardItem(album->title());
-			ArtistDAO *artist = static_cast<ArtistDAO*>(album->parentNode());
-			if (artist) {
-				normalized.prepend(artist->titleNormalized() + "|");
-				row << new QStandardItem(artist->title());
+		QString trackNumber = QString("%1").arg(QString::number(node.trackNumber()), 2, QChar('0'));
+		QString normalized = QString::number(node.disc()) + "|" + trackNumber + "|" + node.title();
+		LibraryNode album = node.parentNode();
+		if (album.isValid()) {
+			normalized.prepend(QString::number(album.year()) + "|" + album.title() + "|");
+			row << new QStandardItem(album.title());
+			LibraryNode artist = album.parentNode();
+			if (artist.isValid()) {
+				normalized.prepend(artist.titleNormalized() + "|");
+				row << new QStandardItem(artist.title());
 			}
 		}
 		nodeItem->setData(normalized, Miam::DF_NormalizedString);
-		if (_tracks.contains(dao->uri())) {
-			QStandardItem *rowToDelete = _tracks.value(dao->uri());
-			// Clean unused nodes
-			this->removeNode(rowToDelete->index());
-		}
-		_tracks.insert(dao->uri(), nodeItem);
-	} else if (AlbumDAO *dao = qobject_cast<AlbumDAO*>(node)) {
-		nodeItem = new AlbumItem(dao);
+		break;
+	}
+	case Miam::IT_Album: {
+		nodeItem = new AlbumItem(node);
 		row << nodeItem;
-		QString normalized = dao->year() + "|" + dao->title();
-		ArtistDAO *artist = static_cast<ArtistDAO*>(dao->parentNode());
-		if (artist) {
-			normalized.prepend(artist->titleNormalized() + "|");
-			row << new QStandardItem(artist->title());
+		QString normalized = QString::number(node.year()) + "|" + node.title();
+		LibraryNode artist = node.parentNode();
+		if (artist.isValid()) {
+			normalized.prepend(artist.titleNormalized() + "|");
+			row << new QStandardItem(artist.title());
 		}
 		nodeItem->setData(normalized, Miam::DF_NormalizedString);
-	} else if (ArtistDAO *dao = qobject_cast<ArtistDAO*>(node)) {
-		nodeItem = new ArtistItem(dao);
-		nodeItem->setData(dao->titleNormalized() + "|", Miam::DF_NormalizedString);
+		break;
+	}
+	case Miam::IT_Artist:
+		nodeItem = new ArtistItem(node);
+		nodeItem->setData(node.titleNormalized() + "|", Miam::DF_NormalizedString);
 		row << nodeItem;
+		break;
+	default:
+		break;
 	}
+	return row;
+}
+
+/** Find and insert nodes in the list. */
+void UniqueLibraryItemModel::insertNodes(const QVector<LibraryNode> &nodes)
+{
+	// Rows are appended with a single notification for the first column. Other columns are filled silently, then
+	// views and the proxy are told once that these rows have changed
+	QList<QList<QStandardItem*>> rows;
+	auto flush = [this, &rows] () {
+		if (rows.isEmpty()) {
+			return;
+		}
+		int first = rowCount();
+		QList<QStandardItem*> firstColumn;
+		firstColumn.reserve(rows.size());
+		for (const QList<QStandardItem*> &row : rows) {
+			firstColumn.append(row.first());
+		}
+		invisibleRootItem()->appendRows(firstColumn);
 
-	if (!row.isEmpty() && nodeItem){
-		invisibleRootItem()->appendRow(row);
-		if (nodeItem->type() == Miam::IT_Artist) {
-			if (SeparatorItem *separator = this->insertSeparator(nodeItem)) {
-				_topLevelItems.insert(separator, nodeItem->index());
+		bool wasBlocked = this->blockSignals(true);
+		for (int i = 0; i < rows.size(); i++) {
+			for (int column = 1; column < rows.at(i).size(); column++) {
+				setItem(first + i, column, rows.at(i).at(column));
+			}
+		}
+		this->blockSignals(wasBlocked);
+		emit dataChanged(index(first, 0), index(first + rows.size() - 1, columnCount() - 1));
+
+		for (QStandardItem *nodeItem : firstColumn) {
+			if (nodeItem->type() == Miam::IT_Artist) {
+				if (SeparatorItem *separator = this->insertSeparator(nodeItem)) {
+					_topLevelItems.insert(separator, nodeItem->index());
+				}
+			}
+		}
+		rows.clear();
+	};
+
+	for (const LibraryNode &node : nodes) {
+		if (!node.isValid()) {
+			continue;
+		}
+		QList<QStandardItem*> row = this->createRow(node);
+		if (row.isEmpty()) {
+			continue;
+		}
+		if (node.type() == Miam::IT_Track) {
+			if (QStandardItem *rowToDelete = _tracks.value(node.uri())) {
+				// Clean unused nodes
+				flush();
+				this->removeNode(rowToDelete->index());
 			}
+			_tracks.insert(node.uri(), row.first());
 		}
+		rows.append(row);
 	}
+	flush();
 }
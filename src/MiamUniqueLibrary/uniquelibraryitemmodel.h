@@ -25,8 +25,12 @@ public:
 
 	virtual MiamSortFilterProxyModel* proxy() const override;
 
+private:
+	/** Builds the row of a node: the node itself, then its album and its artist when they exist. */
+	QList<QStandardItem*> createRow(const LibraryNode &node) const;
+
 public slots:
-	virtual void insertNode(GenericDAO *node) override;
+	virtual void insertNodes(const QVector<LibraryNode> &nodes) override;
 };
 
 #endif // UNIQUELIBRARYITEMMODEL_H